@@ -0,0 +1,600 @@
+/*
+ * DMA_driver.c
+ *
+ *  Created on: Jan 20, 2026
+ *      Author: krisko
+ */
+
+#include "DMA_driver.h"
+
+/*
+ * helper functions for the driver, should not be called by user applications
+ */
+static void DMA_start_stream(DMA_Handle_t *p_DMA_Handle);
+static void DMA_report_event(DMA_Handle_t *p_DMA_Handle, uint8_t event);
+
+//first bit of each stream's flags in LISR/HISR (streams 0-3 in LISR, 4-7 in HISR)
+static const uint8_t DMA_flag_shift[4] = { 0, 6, 16, 22 };
+
+//all the flags of one stream, FEIF, DMEIF, TEIF, HTIF and TCIF
+#define DMA_STREAM_FLAGS	( (1 << DMA_ISR_FEIF) | (1 << DMA_ISR_DMEIF) | (1 << DMA_ISR_TEIF) | (1 << DMA_ISR_HTIF) |\
+							(1 << DMA_ISR_TCIF) )
+
+/*
+ * @func:			DMA_clock_control
+ *
+ * @brief:			This function enable/disable the clock for the given DMA controller
+ *
+ * @param[in]:		address of DMA controller
+ * @param[in]:		ENABLE or DISABLE
+ *
+ * @return:			none
+ */
+void DMA_clock_control(DMA_reg_t *p_DMAx, uint8_t enable)
+{
+	if(enable == ENABLE)
+	{
+		if(p_DMAx == DMA1)
+		{
+			DMA1_PCLK_EN();
+		}
+		else if(p_DMAx == DMA2)
+		{
+			DMA2_PCLK_EN();
+		}
+	}else
+	{
+		if(p_DMAx == DMA1)
+		{
+			DMA1_PCLK_DI();
+		}
+		else if(p_DMAx == DMA2)
+		{
+			DMA2_PCLK_DI();
+		}
+	}
+}
+
+/*
+ * @func:		DMA_init
+ *
+ * @brief:		This function configures the stream of the given DMA Handle with its configuration
+ *
+ * @param[in]:	address of DMA Handle
+ *
+ * @return:		none
+ *
+ * @note: 		this function enables the controller clock, a transfer still running on the stream is stopped
+ */
+void DMA_init(DMA_Handle_t *p_DMA_Handle)
+{
+	DMA_config_t *p_config = &p_DMA_Handle->DMA_config;
+	DMA_stream_reg_t *p_stream = &p_DMA_Handle->p_DMAx->S[p_config->DMA_stream];
+	uint32_t temp = 0;
+
+	//enable the controller clock
+	DMA_clock_control(p_DMA_Handle->p_DMAx, ENABLE);
+
+	//the stream registers can only be written while EN reads 0, the hardware finishes the current item first
+	p_stream->CR &= ~(1 << DMA_SxCR_EN);
+	while(p_stream->CR & (1 << DMA_SxCR_EN));
+
+	//configure channel, bursts and priority
+	temp |= ((uint32_t)p_config->DMA_channel << DMA_SxCR_CHSEL);
+	temp |= (p_config->DMA_mem_burst << DMA_SxCR_MBURST);
+	temp |= (p_config->DMA_periph_burst << DMA_SxCR_PBURST);
+	temp |= (p_config->DMA_priority << DMA_SxCR_PL);
+
+	//configure data sizes and address increment
+	temp |= (p_config->DMA_mem_size << DMA_SxCR_MSIZE);
+	temp |= (p_config->DMA_periph_size << DMA_SxCR_PSIZE);
+	if(p_config->DMA_mem_inc == ENABLE)
+	{
+		temp |= (1 << DMA_SxCR_MINC);
+	}
+	if(p_config->DMA_periph_inc == ENABLE)
+	{
+		temp |= (1 << DMA_SxCR_PINC);
+	}
+
+	//configure mode, double-buffer mode runs circular as well
+	if(p_config->DMA_mode == DMA_MODE_CIRCULAR)
+	{
+		temp |= (1 << DMA_SxCR_CIRC);
+	}
+	else if(p_config->DMA_mode == DMA_MODE_DOUBLE_BUFFER)
+	{
+		temp |= (1 << DMA_SxCR_CIRC) | (1 << DMA_SxCR_DBM);
+	}
+
+	//configure direction
+	temp |= (p_config->DMA_direction << DMA_SxCR_DIR);
+
+	p_stream->CR = temp;
+
+	//configure FIFO, direct mode leaves DMDIS cleared
+	temp = 0;
+	if(p_config->DMA_FIFO_mode == DMA_FIFO_MODE_FIFO)
+	{
+		temp |= (1 << DMA_SxFCR_DMDIS);
+		temp |= (p_config->DMA_FIFO_threshold << DMA_SxFCR_FTH);
+	}
+	p_stream->FCR = temp;
+
+	DMA_clear_flags(p_DMA_Handle->p_DMAx, p_config->DMA_stream);
+	p_DMA_Handle->state = DMA_STATE_READY;
+}
+
+/*
+ * @func:		DMA_deinit
+ *
+ * @brief:		This function resets all registers of the given DMA controller
+ *
+ * @param[in]:	address of the DMA controller
+ *
+ * @return:		none
+ */
+void DMA_deinit(DMA_reg_t *p_DMAx)
+{
+	if(p_DMAx == DMA1)
+	{
+		DMA1_REG_RESET();
+	}
+	else if(p_DMAx == DMA2)
+	{
+		DMA2_REG_RESET();
+	}
+}
+
+/*
+ * @func:			DMA_start_IT
+ *
+ * @brief:			This function starts a transfer of len items on the stream of the given DMA Handle
+ *
+ * @param[in]:		address of DMA Handle structure
+ * @param[in]:		peripheral address (the data register, or the source for memory-to-memory)
+ * @param[in]:		memory address
+ * @param[in]:		number of items (of the peripheral data size) to transfer, 1-65535
+ *
+ * @return: 		the state before the call, DMA_STATE_BUSY -> the stream is in use and nothing was started
+ *
+ * @note: 			this is a non-blocking call, completion is reported through the callback from DMA_IRQ_handler
+ */
+uint8_t DMA_start_IT(DMA_Handle_t *p_DMA_Handle, uint32_t periph_addr, uint32_t mem_addr, uint16_t len)
+{
+	uint8_t state = p_DMA_Handle->state;
+	DMA_stream_reg_t *p_stream = &p_DMA_Handle->p_DMAx->S[p_DMA_Handle->DMA_config.DMA_stream];
+
+	if(state != DMA_STATE_BUSY)
+	{
+		p_stream->PAR = periph_addr;
+		p_stream->M0AR = mem_addr;
+		p_stream->NDTR = len;
+		DMA_start_stream(p_DMA_Handle);
+	}
+	return state;
+}
+
+/*
+ * @func:			DMA_start_double_buffer_IT
+ *
+ * @brief:			This function starts a double-buffer transfer, the stream fills (or empties) mem0 then mem1
+ * 					then mem0 again until it is stopped
+ *
+ * @param[in]:		address of DMA Handle structure, configured with DMA_MODE_DOUBLE_BUFFER
+ * @param[in]:		peripheral address
+ * @param[in]:		memory 0 address
+ * @param[in]:		memory 1 address
+ * @param[in]:		number of items per buffer
+ *
+ * @return: 		the state before the call, DMA_STATE_BUSY -> the stream is in use and nothing was started
+ *
+ * @note: 			DMA_EVENT_TC is reported every time a buffer is done, DMA_get_current_target tells which buffer
+ * 					the stream is using now (the other one is free for the CPU)
+ */
+uint8_t DMA_start_double_buffer_IT(DMA_Handle_t *p_DMA_Handle, uint32_t periph_addr, uint32_t mem0_addr,
+		uint32_t mem1_addr, uint16_t len)
+{
+	uint8_t state = p_DMA_Handle->state;
+	DMA_stream_reg_t *p_stream = &p_DMA_Handle->p_DMAx->S[p_DMA_Handle->DMA_config.DMA_stream];
+
+	if(state != DMA_STATE_BUSY)
+	{
+		p_stream->PAR = periph_addr;
+		p_stream->M0AR = mem0_addr;
+		p_stream->M1AR = mem1_addr;
+		p_stream->NDTR = len;
+		//start with memory 0
+		p_stream->CR &= ~(1 << DMA_SxCR_CT);
+		DMA_start_stream(p_DMA_Handle);
+	}
+	return state;
+}
+
+/*
+ * @func:			DMA_stop
+ *
+ * @brief:			This function stops the transfer on the stream of the given DMA Handle
+ *
+ * @param[in]:		address of DMA Handle structure
+ *
+ * @return:			none
+ *
+ * @note:			waits for the current item to finish, DMA_get_remaining tells how many items were not moved
+ */
+void DMA_stop(DMA_Handle_t *p_DMA_Handle)
+{
+	DMA_stream_reg_t *p_stream = &p_DMA_Handle->p_DMAx->S[p_DMA_Handle->DMA_config.DMA_stream];
+
+	//disable the stream interrupts and the stream
+	p_stream->CR &= ~( (1 << DMA_SxCR_TCIE) | (1 << DMA_SxCR_HTIE) | (1 << DMA_SxCR_TEIE) | (1 << DMA_SxCR_DMEIE) );
+	p_stream->FCR &= ~(1 << DMA_SxFCR_FEIE);
+	p_stream->CR &= ~(1 << DMA_SxCR_EN);
+	while(p_stream->CR & (1 << DMA_SxCR_EN));
+
+	DMA_clear_flags(p_DMA_Handle->p_DMAx, p_DMA_Handle->DMA_config.DMA_stream);
+	p_DMA_Handle->state = DMA_STATE_READY;
+}
+
+/*
+ * @func:			DMA_get_remaining
+ *
+ * @brief:			This function returns the number of items the stream still has to transfer
+ *
+ * @param[in]:		address of DMA Handle structure
+ *
+ * @return:			NDTR, in circular mode it counts down from len again after every pass
+ */
+uint16_t DMA_get_remaining(DMA_Handle_t *p_DMA_Handle)
+{
+	return (uint16_t)p_DMA_Handle->p_DMAx->S[p_DMA_Handle->DMA_config.DMA_stream].NDTR;
+}
+
+/*
+ * @func:			DMA_get_current_target
+ *
+ * @brief:			This function returns the buffer a double-buffer stream is using now
+ *
+ * @param[in]:		address of DMA Handle structure
+ *
+ * @return:			0 -> memory 0, 1 -> memory 1
+ */
+uint8_t DMA_get_current_target(DMA_Handle_t *p_DMA_Handle)
+{
+	return ( (p_DMA_Handle->p_DMAx->S[p_DMA_Handle->DMA_config.DMA_stream].CR >> DMA_SxCR_CT) & 1 );
+}
+
+/*
+ * @func:			DMA_set_memory
+ *
+ * @brief:			This function changes one buffer address of a double-buffer stream while it runs
+ *
+ * @param[in]:		address of DMA Handle structure
+ * @param[in]:		0 -> memory 0, 1 -> memory 1
+ * @param[in]:		new buffer address
+ *
+ * @return:			none
+ *
+ * @note:			only the buffer that is not the current target may be changed, the hardware ignores the write
+ * 					(and disables the stream with a transfer error) otherwise
+ */
+void DMA_set_memory(DMA_Handle_t *p_DMA_Handle, uint8_t target, uint32_t mem_addr)
+{
+	DMA_stream_reg_t *p_stream = &p_DMA_Handle->p_DMAx->S[p_DMA_Handle->DMA_config.DMA_stream];
+
+	if(target == 0)
+	{
+		p_stream->M0AR = mem_addr;
+	}
+	else
+	{
+		p_stream->M1AR = mem_addr;
+	}
+}
+
+/*
+ * @func:			DMA_set_mem_inc
+ *
+ * @brief:			This function turns the memory address increment of a stream on or off
+ *
+ * @param[in]:		address of DMA Handle structure
+ * @param[in]:		ENABLE or DISABLE
+ *
+ * @return:			none
+ *
+ * @note:			only while the stream is not running, DISABLE moves every item from/to the same memory location
+ * 					(a fill pattern or a dummy), DMA_config.DMA_mem_inc is updated as well
+ */
+void DMA_set_mem_inc(DMA_Handle_t *p_DMA_Handle, uint8_t enable)
+{
+	DMA_stream_reg_t *p_stream = &p_DMA_Handle->p_DMAx->S[p_DMA_Handle->DMA_config.DMA_stream];
+
+	p_DMA_Handle->DMA_config.DMA_mem_inc = enable;
+	if(enable == ENABLE)
+	{
+		p_stream->CR |= (1 << DMA_SxCR_MINC);
+	}
+	else
+	{
+		p_stream->CR &= ~(1 << DMA_SxCR_MINC);
+	}
+}
+
+/*
+ * @func:			DMA_set_data_size
+ *
+ * @brief:			This function changes the peripheral and memory data sizes of a stream
+ *
+ * @param[in]:		address of DMA Handle structure
+ * @param[in]:		peripheral data size, from @DMA_DATA_SIZES
+ * @param[in]:		memory data size, from @DMA_DATA_SIZES
+ *
+ * @return:			none
+ *
+ * @note:			only while the stream is not running, pending flags are kept (unlike DMA_init)
+ * 					DMA_config is updated as well
+ */
+void DMA_set_data_size(DMA_Handle_t *p_DMA_Handle, uint8_t periph_size, uint8_t mem_size)
+{
+	DMA_stream_reg_t *p_stream = &p_DMA_Handle->p_DMAx->S[p_DMA_Handle->DMA_config.DMA_stream];
+	uint32_t temp = p_stream->CR;
+
+	p_DMA_Handle->DMA_config.DMA_periph_size = periph_size;
+	p_DMA_Handle->DMA_config.DMA_mem_size = mem_size;
+
+	temp &= ~( (0b11 << DMA_SxCR_PSIZE) | (0b11 << DMA_SxCR_MSIZE) );
+	temp |= (periph_size << DMA_SxCR_PSIZE) | (mem_size << DMA_SxCR_MSIZE);
+	p_stream->CR = temp;
+}
+
+/*
+ * @func:				DMA_IRQ_config
+ *
+ * @brief:				This function enable/disable interrupt for the given DMA stream
+ *
+ * @param[in]:			the IRQ number to enable/disable (IRQ_NO_DMAx_STREAMy)
+ * @param[in]:			ENABLE or DISABLE the IRQ
+ *
+ * @return: 			none
+ */
+void DMA_IRQ_config(uint8_t IRQ_num, uint8_t enable)
+{
+	//enable the IRQ
+	if(enable == ENABLE)
+	{
+		if(IRQ_num < 32)
+		{
+			//enable ISER0
+			*NVIC_ISER0 |= (1 << IRQ_num);
+		}else if(IRQ_num >= 32 && IRQ_num < 64)
+		{
+			//enable ISER1
+			*NVIC_ISER1 |= (1 << (IRQ_num % 32));
+		}else if(IRQ_num >= 64 && IRQ_num < 96){
+			//enable ISER2
+			*NVIC_ISER2 |= (1 << (IRQ_num % 64));
+		}
+		else if (IRQ_num >= 96 && IRQ_num < 128)
+		{
+			//enable ISER3
+			*NVIC_ISER3 |= (1 << (IRQ_num % 96));
+		}
+	}else{ //disable the IRQ
+		if(IRQ_num < 32)
+		{
+			//enable ICER0
+			*NVIC_ICER0 |= (1 << IRQ_num);
+		}else if(IRQ_num >= 32 && IRQ_num < 64)
+		{
+			//enable ICER1
+			*NVIC_ICER1 |= (1 << (IRQ_num % 32));
+		}else if(IRQ_num >= 64 && IRQ_num < 96){
+			//enable ICER2
+			*NVIC_ICER2 |= (1 << (IRQ_num % 64));
+		}
+		else if (IRQ_num >= 96 && IRQ_num < 128)
+		{
+			//enable ICER3
+			*NVIC_ICER3 |= (1 << (IRQ_num % 96));
+		}
+	}
+}
+
+/*
+ * @func:			DMA_set_priority
+ *
+ * @brief:			This function sets the priority of the given IRQ
+ *
+ * @param[in]:		IRQ number of the stream to set priority
+ * @param[in]:		priority value to set the IRQ to
+ *
+ * @return: 		none
+ */
+void DMA_set_priority(uint8_t IRQ_num, uint8_t IRQ_priority)
+{
+	//set priority
+	uint8_t iprx = IRQ_num / 4;						//which IRQ register, each IPR register only contain 4 interrupts (1 byte apart)
+	uint8_t iprx_section = IRQ_num % 4;				//which interrupt(byte) within the IPR register
+	uint8_t shift_amount = (8 * iprx_section) + 4; 	//add 4 because the upper 4 bits are the preemptive priority and the lower 4 are the subpriority
+
+	*(NVIC_IPR_BASEADDR + iprx) |= (IRQ_priority << shift_amount); //NVIC_IPR_BASEADDR is uin32_t pointer so adding the iprx will be 4 bytes apart
+}
+
+/*
+ * @func:			DMA_IRQ_handler
+ *
+ * @brief:			This function reads and clears the flags of the stream and reports each enabled one
+ *
+ * @param[in]:		DMA handle structure
+ *
+ * @return:			none
+ *
+ * @note:			call it from the DMAx_Streamy_IRQHandler of the stream, errors are reported before HT/TC
+ */
+void DMA_IRQ_handler(DMA_Handle_t *p_DMA_Handle)
+{
+	uint8_t stream = p_DMA_Handle->DMA_config.DMA_stream;
+	DMA_stream_reg_t *p_stream = &p_DMA_Handle->p_DMAx->S[stream];
+	uint8_t shift = DMA_flag_shift[stream % 4];
+	uint32_t flags, cr = p_stream->CR;
+
+	//read and clear the flags of this stream before the callbacks, a callback may start the next transfer
+	if(stream < 4)
+	{
+		flags = (p_DMA_Handle->p_DMAx->LISR >> shift) & DMA_STREAM_FLAGS;
+		p_DMA_Handle->p_DMAx->LIFCR = (flags << shift);
+	}
+	else
+	{
+		flags = (p_DMA_Handle->p_DMAx->HISR >> shift) & DMA_STREAM_FLAGS;
+		p_DMA_Handle->p_DMAx->HIFCR = (flags << shift);
+	}
+
+	//FIFO error
+	if( (flags & (1 << DMA_ISR_FEIF)) && (p_stream->FCR & (1 << DMA_SxFCR_FEIE)) )
+	{
+		DMA_report_event(p_DMA_Handle, DMA_EVENT_FE_ERR);
+	}
+
+	//direct mode error
+	if( (flags & (1 << DMA_ISR_DMEIF)) && (cr & (1 << DMA_SxCR_DMEIE)) )
+	{
+		DMA_report_event(p_DMA_Handle, DMA_EVENT_DME_ERR);
+	}
+
+	//transfer error, the hardware has disabled the stream
+	if( (flags & (1 << DMA_ISR_TEIF)) && (cr & (1 << DMA_SxCR_TEIE)) )
+	{
+		p_DMA_Handle->state = DMA_STATE_READY;
+		DMA_report_event(p_DMA_Handle, DMA_EVENT_TE_ERR);
+	}
+
+	//half transfer
+	if( (flags & (1 << DMA_ISR_HTIF)) && (cr & (1 << DMA_SxCR_HTIE)) )
+	{
+		DMA_report_event(p_DMA_Handle, DMA_EVENT_HT);
+	}
+
+	//transfer complete, a normal mode stream is disabled by the hardware and can be started again
+	if( (flags & (1 << DMA_ISR_TCIF)) && (cr & (1 << DMA_SxCR_TCIE)) )
+	{
+		if(p_DMA_Handle->DMA_config.DMA_mode == DMA_MODE_NORMAL)
+		{
+			p_DMA_Handle->state = DMA_STATE_READY;
+		}
+		DMA_report_event(p_DMA_Handle, DMA_EVENT_TC);
+	}
+}
+
+/*
+ * @func:		DMA_get_flag_status
+ *
+ * @brief:		This function returns the status of the given flag bit of a stream
+ *
+ * @param[in]:		address of the DMA controller
+ * @param[in]:		stream 0-7
+ * @param[in]:		the flag bit, DMA_ISR_xxx
+ *
+ * @return:		the status of the given flag bit
+ */
+uint8_t DMA_get_flag_status(DMA_reg_t *p_DMAx, uint8_t stream, uint8_t flag_bit)
+{
+	uint32_t isr = (stream < 4) ? p_DMAx->LISR : p_DMAx->HISR;
+
+	return ( (isr >> (DMA_flag_shift[stream % 4] + flag_bit)) & 1 );
+}
+
+/*
+ * @func:		DMA_clear_flags
+ *
+ * @brief:		This function clears all flags of a stream
+ *
+ * @param[in]:		address of the DMA controller
+ * @param[in]:		stream 0-7
+ *
+ * @return:		none
+ *
+ * @note:		flags left from the last transfer have to be cleared before the stream is enabled again
+ */
+void DMA_clear_flags(DMA_reg_t *p_DMAx, uint8_t stream)
+{
+	if(stream < 4)
+	{
+		p_DMAx->LIFCR = (DMA_STREAM_FLAGS << DMA_flag_shift[stream]);
+	}
+	else
+	{
+		p_DMAx->HIFCR = (DMA_STREAM_FLAGS << DMA_flag_shift[stream - 4]);
+	}
+}
+
+/*
+ * @func:			DMA_start_stream
+ *
+ * @brief:			This function clears the old flags, enables the stream interrupts and the stream
+ *
+ * @param[in]:		address of the DMA Handle structure
+ *
+ * @return:			none
+ *
+ * @note:			This function is called by DMA_start_IT and DMA_start_double_buffer_IT after the addresses are set
+ */
+static void DMA_start_stream(DMA_Handle_t *p_DMA_Handle)
+{
+	DMA_config_t *p_config = &p_DMA_Handle->DMA_config;
+	DMA_stream_reg_t *p_stream = &p_DMA_Handle->p_DMAx->S[p_config->DMA_stream];
+	uint32_t temp = (1 << DMA_SxCR_TCIE) | (1 << DMA_SxCR_TEIE) | (1 << DMA_SxCR_DMEIE);
+
+	DMA_clear_flags(p_DMA_Handle->p_DMAx, p_config->DMA_stream);
+
+	//half transfer only matters when the buffer is reused
+	if(p_config->DMA_mode != DMA_MODE_NORMAL)
+	{
+		temp |= (1 << DMA_SxCR_HTIE);
+	}
+	if(p_config->DMA_FIFO_mode == DMA_FIFO_MODE_FIFO)
+	{
+		p_stream->FCR |= (1 << DMA_SxFCR_FEIE);
+	}
+
+	p_DMA_Handle->state = DMA_STATE_BUSY;
+	p_stream->CR |= temp;
+	p_stream->CR |= (1 << DMA_SxCR_EN);
+}
+
+/*
+ * @func:			DMA_report_event
+ *
+ * @brief:			This function passes an event to the callback of the Handle, or to DMA_event_callback
+ *
+ * @param[in]:		address of the DMA Handle structure
+ * @param[in]:		event from @DMA_EVENTS
+ *
+ * @return:			none
+ */
+static void DMA_report_event(DMA_Handle_t *p_DMA_Handle, uint8_t event)
+{
+	if(p_DMA_Handle->p_callback)
+	{
+		p_DMA_Handle->p_callback(event, p_DMA_Handle->p_context);
+	}
+	else
+	{
+		DMA_event_callback(p_DMA_Handle, event);
+	}
+}
+
+/*
+ * @func:			DMA_event_callback
+ *
+ * @brief:			This is a weak implementation of the function and should be overridden by user application
+ *
+ * @param[in]:		address of the DMA Handle structure
+ * @param[in]:		event from @DMA_EVENTS
+ *
+ * @return:			none
+ */
+__attribute__((weak)) void DMA_event_callback(DMA_Handle_t *p_DMA_Handle, uint8_t event)
+{
+
+}
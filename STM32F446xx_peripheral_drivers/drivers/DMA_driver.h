@@ -0,0 +1,166 @@
+/*
+ * DMA_driver.h
+ *
+ *  Created on: Jan 20, 2026
+ *      Author: krisko
+ */
+
+#ifndef DRIVERS_DMA_DRIVER_H_
+#define DRIVERS_DMA_DRIVER_H_
+
+#include <stdint.h>
+#include "STM32F446xx.h"
+
+/*
+ * DMA event callback, event is from @DMA_EVENTS and p_context is the pointer set in the Handle
+ * (the SPI/I2C/USART drivers pass their own Handle here)
+ */
+typedef void (*DMA_callback_t)(uint8_t event, void *p_context);
+
+/*
+ * DMA stream configuration structure
+ */
+typedef struct
+{
+	uint8_t DMA_stream;				//!< 0-7, the stream the request is mapped to (reference manual DMA request mapping)
+	uint8_t DMA_channel;			//!< 0-7, the channel of the request on that stream
+	uint8_t DMA_direction;			//!< possible values from @DMA_DIRECTIONS
+	uint8_t DMA_mode;				//!< possible values from @DMA_MODES
+	uint8_t DMA_priority;			//!< possible values from @DMA_PRIORITIES
+	uint8_t DMA_periph_size;		//!< possible values from @DMA_DATA_SIZES
+	uint8_t DMA_mem_size;			//!< possible values from @DMA_DATA_SIZES
+	uint8_t DMA_periph_inc;			//!< ENABLE or DISABLE
+	uint8_t DMA_mem_inc;			//!< ENABLE or DISABLE
+	uint8_t DMA_FIFO_mode;			//!< possible values from @DMA_FIFO_MODES
+	uint8_t DMA_FIFO_threshold;		//!< possible values from @DMA_FIFO_THRESHOLDS
+	uint8_t DMA_periph_burst;		//!< possible values from @DMA_BURSTS
+	uint8_t DMA_mem_burst;			//!< possible values from @DMA_BURSTS
+}DMA_config_t;
+
+/*
+ * DMA stream Handle structure
+ */
+typedef struct
+{
+	DMA_reg_t 			*p_DMAx;
+	DMA_config_t 		DMA_config;
+	DMA_callback_t 		p_callback;		//called from DMA_IRQ_handler, NULL -> DMA_event_callback
+	void 				*p_context;
+	uint8_t 			state;			//possible values from @DMA_STATES
+}DMA_Handle_t;
+
+/*
+ * @DMA_DIRECTIONS
+ */
+#define DMA_DIR_PERIPH_TO_MEM	0
+#define DMA_DIR_MEM_TO_PERIPH	1
+#define DMA_DIR_MEM_TO_MEM		2		//DMA2 only, the peripheral address is the source
+
+/*
+ * @DMA_MODES
+ */
+#define DMA_MODE_NORMAL			0		//stops after len items, DMA_EVENT_TC
+#define DMA_MODE_CIRCULAR		1		//restarts at the buffer start, DMA_EVENT_HT and DMA_EVENT_TC every pass
+#define DMA_MODE_DOUBLE_BUFFER	2		//switches between two buffers, DMA_EVENT_TC every time a buffer is full
+
+/*
+ * @DMA_PRIORITIES
+ */
+#define DMA_PRIORITY_LOW		0
+#define DMA_PRIORITY_MEDIUM		1
+#define DMA_PRIORITY_HIGH		2
+#define DMA_PRIORITY_VERY_HIGH	3
+
+/*
+ * @DMA_DATA_SIZES
+ */
+#define DMA_SIZE_BYTE			0
+#define DMA_SIZE_HALF_WORD		1
+#define DMA_SIZE_WORD			2
+
+/*
+ * @DMA_FIFO_MODES
+ * note: memory-to-memory and bursts need the FIFO, direct mode moves every item as soon as the request comes
+ */
+#define DMA_FIFO_MODE_DIRECT	0
+#define DMA_FIFO_MODE_FIFO		1
+
+/*
+ * @DMA_FIFO_THRESHOLDS
+ */
+#define DMA_FIFO_THRESHOLD_1_4	0
+#define DMA_FIFO_THRESHOLD_1_2	1
+#define DMA_FIFO_THRESHOLD_3_4	2
+#define DMA_FIFO_THRESHOLD_FULL	3
+
+/*
+ * @DMA_BURSTS
+ * note: burst size * data size must fit the FIFO threshold, see the FIFO/burst table in the reference manual
+ */
+#define DMA_BURST_SINGLE		0
+#define DMA_BURST_INCR4			1
+#define DMA_BURST_INCR8			2
+#define DMA_BURST_INCR16		3
+
+/*
+ * @DMA_STATES
+ */
+#define DMA_STATE_READY			0
+#define DMA_STATE_BUSY			1
+
+/*
+ * @DMA_EVENTS
+ */
+#define DMA_EVENT_HT			0		//half transfer, first half of the buffer can be used
+#define DMA_EVENT_TC			1		//transfer complete (in circular/double-buffer mode: end of the buffer)
+#define DMA_EVENT_TE_ERR		2		//transfer error (bus error), the stream is disabled by hardware
+#define DMA_EVENT_DME_ERR		3		//direct mode error
+#define DMA_EVENT_FE_ERR		4		//FIFO error (underrun/overrun)
+
+
+/**************************APIs**************************/
+
+/*
+ * clock setup
+ */
+void DMA_clock_control(DMA_reg_t *p_DMAx, uint8_t enable);
+
+/*
+ * initialize and deinitialize
+ */
+void DMA_init(DMA_Handle_t *p_DMA_Handle);
+void DMA_deinit(DMA_reg_t *p_DMAx);
+
+/*
+ * start and stop transfers
+ */
+uint8_t DMA_start_IT(DMA_Handle_t *p_DMA_Handle, uint32_t periph_addr, uint32_t mem_addr, uint16_t len);
+uint8_t DMA_start_double_buffer_IT(DMA_Handle_t *p_DMA_Handle, uint32_t periph_addr, uint32_t mem0_addr,
+		uint32_t mem1_addr, uint16_t len);
+void DMA_stop(DMA_Handle_t *p_DMA_Handle);
+uint16_t DMA_get_remaining(DMA_Handle_t *p_DMA_Handle);
+uint8_t DMA_get_current_target(DMA_Handle_t *p_DMA_Handle);
+void DMA_set_memory(DMA_Handle_t *p_DMA_Handle, uint8_t target, uint32_t mem_addr);
+void DMA_set_mem_inc(DMA_Handle_t *p_DMA_Handle, uint8_t enable);
+void DMA_set_data_size(DMA_Handle_t *p_DMA_Handle, uint8_t periph_size, uint8_t mem_size);
+
+/*
+ * IQR configuration and handling
+ */
+void DMA_IRQ_config(uint8_t IRQ_num, uint8_t enable);
+void DMA_set_priority(uint8_t IRQ_num, uint8_t IRQ_priority);
+void DMA_IRQ_handler(DMA_Handle_t *p_DMA_Handle);
+
+/*
+ * other peripheral control APIs
+ */
+uint8_t DMA_get_flag_status(DMA_reg_t *p_DMAx, uint8_t stream, uint8_t flag_bit);
+void DMA_clear_flags(DMA_reg_t *p_DMAx, uint8_t stream);
+
+/*
+ * user application APIs
+ */
+__attribute__((weak)) void DMA_event_callback(DMA_Handle_t *p_DMA_Handle, uint8_t event);
+
+
+#endif /* DRIVERS_DMA_DRIVER_H_ */
@@ -12,6 +12,12 @@ static void I2C_execute_addr_phase(I2C_Handle_t *p_I2C_Handle, uint8_t target_ad
 static void I2C_clear_ADDR_flag(I2C_Handle_t *p_I2C_Handle);
 static void I2C_controller_RXNE_handler(I2C_Handle_t *p_I2C_Handle);
 static void I2C_controller_TXE_handler(I2C_Handle_t *p_I2C_Handle);
+static void I2C_set_timing(I2C_Handle_t *p_I2C_Handle);
+static void I2C_DMA_config(I2C_Handle_t *p_I2C_Handle, DMA_Handle_t *p_DMA_Handle, uint8_t direction);
+static void I2C_DMA_Tx_callback(uint8_t event, void *p_context);
+static void I2C_DMA_Rx_callback(uint8_t event, void *p_context);
+static void I2C_report_event(I2C_Handle_t *p_I2C_Handle, uint8_t event);
+static void I2C_clk_change_abort(I2C_Handle_t *p_I2C_Handle);
 
 /*
  * @func:			I2C_clock_control
@@ -65,25 +71,15 @@ void I2C_clock_control(I2C_reg_t *p_I2Cx, uint8_t enable)
  *
  * @return:			none
  *
- * @note:			for system clock source, only HSI and HSE are considered, PLL and PLLR are not considered
- * 					only 7 bit addresses are considered
+ * @note:			only 7 bit addresses are considered
  */
 void I2C_init(I2C_Handle_t *p_I2C_Handle)
 {
 	uint32_t temp;
-	uint32_t PCLK1_freq_hz = RCC_get_pclk1();
 
 	//enable peripheral clock
 	I2C_clock_control(p_I2C_Handle->p_I2Cx, ENABLE);
 
-
-	//configure clock frequency
-	uint32_t PCLK1_freq_Mhz = PCLK1_freq_hz / 1000000;	//FREQ only support Mhz
-	temp = p_I2C_Handle->p_I2Cx->CR2;
-	temp &= ~(0b11111 << I2C_CR2_FREQ);
-	temp |= (PCLK1_freq_Mhz << I2C_CR2_FREQ);
-	p_I2C_Handle->p_I2Cx->CR2 = temp;
-
 	//configure device address mode
 	temp = p_I2C_Handle->p_I2Cx->OAR1;
 	temp &= ~(1 << I2C_OAR_ADDMODE);		//7 bit address
@@ -95,57 +91,8 @@ void I2C_init(I2C_Handle_t *p_I2C_Handle)
 	temp |= (1 << 14);	//keep 14th bit of OAR 1, as required by data sheet
 	p_I2C_Handle->p_I2Cx->OAR1 = temp;
 
-	//configure clock control register
-	uint32_t CCR;
-	temp = p_I2C_Handle->p_I2Cx->CCR;
-	uint32_t clock_speed = p_I2C_Handle->I2Cx_config.I2C_CLK_speed;
-	if( clock_speed <= I2C_CLK_SPEED_SM)
-	{
-		//standard mode
-		temp &= ~(1 << I2C_CCR_FS);		//set mode to SM
-		//calculate CCR
-		CCR = PCLK1_freq_hz / (2 * clock_speed);
-	}
-	else
-	{
-		//fast mode
-		temp |= (1 << I2C_CCR_FS);		//set mode to FM
-		//set FR duty cycle
-		uint8_t duty = p_I2C_Handle->I2Cx_config.I2C_FM_duty_cycle;
-		if(duty)	//t(low)/t(high) = 16/9
-		{
-			//set DUTY to 1
-			temp |= (duty << I2C_CCR_DUTY);
-			//calculate CCR
-			CCR = PCLK1_freq_hz / (25 * clock_speed);
-		}
-		else		//t(low)/t(high) = 2
-		{
-			//set DUTY to 0
-			temp &= ~(1 << I2C_CCR_DUTY);
-			//calculate CCR
-			 CCR = PCLK1_freq_hz / (3 * clock_speed);
-
-		}
-	}
-	temp &= ~(0xFFF << I2C_CCR_CCR);
-	temp |= ((CCR & 0xFFF) << I2C_CCR_CCR);
-	p_I2C_Handle->p_I2Cx->CCR = temp;
-
-	//configure T(rise)
-	temp = p_I2C_Handle->p_I2Cx->TRISE;
-	temp &= ~(0x3F);
-	if(clock_speed <= I2C_CLK_SPEED_SM)
-	{
-		//standard mode, T(rise) max = 1000ns
-		temp |= (PCLK1_freq_hz / 1000000) + 1;		//add 1, as specified in data sheet
-	}
-	else
-	{
-		//fast mode, T(rise) max = 300ns
-		temp |= ((PCLK1_freq_hz * 300) / 1000000000) + 1;
-	}
-	p_I2C_Handle->p_I2Cx->TRISE = (temp & 0x3F);
+	//configure FREQ, CCR and T(rise) from PCLK1
+	I2C_set_timing(p_I2C_Handle);
 }
 
 
@@ -413,6 +360,159 @@ uint8_t I2C_controller_receive_IT(I2C_Handle_t *p_I2C_Handle, uint8_t *p_Rx_buff
 	return state;
 }
 
+/*
+ * @func:			I2C_DMA_init
+ *
+ * @brief:			This function sets up the DMA streams used by I2C_controller_send_DMA and I2C_controller_receive_DMA
+ *
+ * @param[in]:		address of I2C Handle for the peripheral, after I2C_init
+ * @param[in]:		address of the DMA Handle for transmit, NULL -> no DMA transmit
+ * @param[in]:		address of the DMA Handle for receive, NULL -> no DMA receive
+ *
+ * @return:			none
+ *
+ * @note:			a DMA Handle with p_DMAx NULL gets the default stream and channel of the I2C peripheral:
+ * 					I2C1 DMA1 Tx stream 7 ch 1, Rx stream 0 ch 1	I2C2 DMA1 Tx stream 7 ch 7, Rx stream 2 ch 7
+ * 					I2C3 DMA1 Tx stream 4 ch 3, Rx stream 2 ch 3
+ * 					DMA1 has too few streams for every default, these share a stream with another default:
+ * 					I2C1 Tx stream 7 = I2C2 Tx, SPI3 Tx, UART5 Tx	I2C1 Rx stream 0 = SPI3 Rx, UART5 Rx
+ * 					I2C2 Tx stream 7 = SPI3 Tx, UART5 Tx			I2C2 Rx stream 2 = I2C3 Rx, UART4 Rx
+ * 					I2C3 Tx stream 4 = SPI2 Tx, UART4 Tx			I2C3 Rx stream 2 = I2C2 Rx, UART4 Rx
+ * 					(I2C1 stays off streams 5/6 of USART2, the usual console), a Handle with p_DMAx set avoids them
+ * 					a Handle with p_DMAx set keeps its stream, channel and priority, the rest is set here
+ * 					the application enables the stream IRQ and calls DMA_IRQ_handler from the stream's IRQ handler
+ */
+void I2C_DMA_init(I2C_Handle_t *p_I2C_Handle, DMA_Handle_t *p_Tx_DMA, DMA_Handle_t *p_Rx_DMA)
+{
+	p_I2C_Handle->p_Tx_DMA = p_Tx_DMA;
+	p_I2C_Handle->p_Rx_DMA = p_Rx_DMA;
+
+	if(p_Tx_DMA != NULL)
+	{
+		I2C_DMA_config(p_I2C_Handle, p_Tx_DMA, DMA_DIR_MEM_TO_PERIPH);
+		p_Tx_DMA->p_callback = I2C_DMA_Tx_callback;
+		DMA_init(p_Tx_DMA);
+	}
+	if(p_Rx_DMA != NULL)
+	{
+		I2C_DMA_config(p_I2C_Handle, p_Rx_DMA, DMA_DIR_PERIPH_TO_MEM);
+		p_Rx_DMA->p_callback = I2C_DMA_Rx_callback;
+		DMA_init(p_Rx_DMA);
+	}
+}
+
+/*
+ * @func:			I2C_controller_send_DMA
+ *
+ * @brief:			This function starts sending to the target by DMA
+ *
+ * @param[in]:		address of I2C Handle for the peripheral, set up with I2C_DMA_init
+ * @param[in]:		address of the Tx buffer
+ * @param[in]:		how many bytes of data to send, 1 to 65535
+ * @param[in]:		target address
+ * @param[in]:		enable or disable repeated start (I2C_RS_enable or I2C_SR_DISABLE)
+ *
+ * @return:			the state of the I2C peripheral when entering the function, not updated if state is READY entered,
+ * 					or I2C_STATE_ERR (no Tx stream, len 0 or over 65535) without starting anything
+ *
+ * @note:			the START and address phase run in I2C_EV_IRQ_handling, the data goes by DMA without an interrupt
+ * 					per byte, BTF after the last byte generates STOP and sends I2C_EV_TX_CMPLT
+ * 					errors are reported by I2C_ER_IRQ_handling as with the interrupt based send, I2C_close_send
+ * 					also stops the DMA
+ */
+uint8_t I2C_controller_send_DMA(I2C_Handle_t *p_I2C_Handle, uint8_t *p_Tx_buffer, uint32_t len, uint8_t target_addr, uint8_t RS_enable)
+{
+	uint8_t state = p_I2C_Handle->TxRxstate;
+
+	//NDTR is 16 bits, a longer buffer is not cut short silently
+	if( (p_I2C_Handle->p_Tx_DMA == NULL) || (len == 0) || (len > 0xFFFFU) )
+	{
+		return I2C_STATE_ERR;
+	}
+
+	if((state != I2C_STATE_BUSY_RX) && (state != I2C_STATE_BUSY_TX))
+	{
+		//save the information to I2C handler, Tx_len drops to 0 when the DMA has moved every byte
+		p_I2C_Handle->p_Tx_buffer = p_Tx_buffer;
+		p_I2C_Handle->Tx_len = len;
+		p_I2C_Handle->TxRxstate = I2C_STATE_BUSY_TX;
+		p_I2C_Handle->repeated_start = RS_enable;
+		p_I2C_Handle->target_addr = target_addr;
+
+		//the stream waits for the TXE requests that start after the address phase
+		DMA_start_IT(p_I2C_Handle->p_Tx_DMA, (uint32_t)&p_I2C_Handle->p_I2Cx->DR, (uint32_t)p_Tx_buffer, (uint16_t)len);
+		p_I2C_Handle->p_I2Cx->CR2 |= (1 << I2C_CR2_DMAEN);
+
+		//generate start condition
+		I2C_generate_start(p_I2C_Handle);
+
+		//enable ITEVTEN(event interrupt enable), ITBUFEN stays off so TXE only raises DMA requests
+		p_I2C_Handle->p_I2Cx->CR2 |= (1 << I2C_CR2_ITEVTEN);
+		//enable ITERREN(error interrupt enable)
+		p_I2C_Handle->p_I2Cx->CR2 |= (1 << I2C_CR2_ITERREN);
+	}
+	return state;
+}
+
+/*
+ * @func:			I2C_controller_receive_DMA
+ *
+ * @brief:			This function starts receiving from the target by DMA
+ *
+ * @param[in]:		address of I2C Handle for the peripheral, set up with I2C_DMA_init
+ * @param[in]:		address of the Rx buffer
+ * @param[in]:		how many bytes of data to receive, 1 to 65535
+ * @param[in]:		target address
+ * @param[in]:		enable or disable repeated start (I2C_RS_enable or I2C_SR_DISABLE)
+ *
+ * @return:			the state of the I2C peripheral when entering the function, not updated if state is READY entered,
+ * 					or I2C_STATE_ERR (no Rx stream, len 0 or over 65535) without starting anything
+ *
+ * @note:			LAST is set so the hardware NACKs the last byte at the end of the DMA transfer, the DMA transfer
+ * 					complete interrupt then generates STOP and sends I2C_EV_RX_CMPLT
+ * 					a single byte is NACKed by clearing ACK before ADDR is cleared and STOP is programmed right after,
+ * 					in the ADDR event as for the interrupt based receive (RM0390 single byte reception)
+ */
+uint8_t I2C_controller_receive_DMA(I2C_Handle_t *p_I2C_Handle, uint8_t *p_Rx_buffer, uint32_t len, uint8_t target_addr, uint8_t RS_enable)
+{
+	uint8_t state = p_I2C_Handle->TxRxstate;
+
+	//NDTR is 16 bits, a longer buffer is not cut short silently
+	if( (p_I2C_Handle->p_Rx_DMA == NULL) || (len == 0) || (len > 0xFFFFU) )
+	{
+		return I2C_STATE_ERR;
+	}
+
+	if((state != I2C_STATE_BUSY_RX) && (state != I2C_STATE_BUSY_TX))
+	{
+		//save the information to I2C handler
+		p_I2C_Handle->p_Rx_buffer = p_Rx_buffer;
+		p_I2C_Handle->Rx_len = len;
+		p_I2C_Handle->Rx_size = len;
+		p_I2C_Handle->TxRxstate = I2C_STATE_BUSY_RX;
+		p_I2C_Handle->repeated_start = RS_enable;
+		p_I2C_Handle->target_addr = target_addr;
+
+		//ACK every byte but the last, NACK of the last byte comes from LAST
+		if(len > 1)
+		{
+			I2C_manage_acking(p_I2C_Handle, ENABLE);
+		}
+
+		DMA_start_IT(p_I2C_Handle->p_Rx_DMA, (uint32_t)&p_I2C_Handle->p_I2Cx->DR, (uint32_t)p_Rx_buffer, (uint16_t)len);
+		p_I2C_Handle->p_I2Cx->CR2 |= (1 << I2C_CR2_DMAEN) | (1 << I2C_CR2_LAST);
+
+		//generate start condition
+		I2C_generate_start(p_I2C_Handle);
+
+		//enable ITEVTEN(event interrupt enable), ITBUFEN stays off so RXNE only raises DMA requests
+		p_I2C_Handle->p_I2Cx->CR2 |= (1 << I2C_CR2_ITEVTEN);
+		//enable ITERREN(error interrupt enable)
+		p_I2C_Handle->p_I2Cx->CR2 |= (1 << I2C_CR2_ITERREN);
+	}
+	return state;
+}
+
 /*
  * @func:				I2C_IRQ_config
  *
@@ -516,21 +616,22 @@ void I2C_EV_IRQ_handling(I2C_Handle_t *p_I2C_Handle)
 	temp3 = ( (p_I2C_Handle->p_I2Cx->SR1 >> I2C_SR1_ADDR) & 1 );
 	if(temp2 && temp3)
 	{
-		//disable ACK first before clearing ADDR for controller receive
-		if( (p_I2C_Handle->p_I2Cx->SR2 >> I2C_SR2_MSL) & 1)	//device in controller mode
+		//single byte controller receive (only a controller receive sets BUSY_RX): ACK has to be off before ADDR is
+		//cleared, so this is decided before the MSL check reads SR2, and STOP is programmed right after clearing it
+		if( (p_I2C_Handle->TxRxstate == I2C_STATE_BUSY_RX) && (p_I2C_Handle->Rx_size == 1) )
 		{
-			if(p_I2C_Handle->TxRxstate == I2C_STATE_BUSY_RX)	//device is receiving
-			{
-				if(p_I2C_Handle->Rx_size == 1)
-				{
-					//disable ACK
-					p_I2C_Handle->p_I2Cx->CR1 &= ~(1 << I2C_CR1_ACK);
+			//disable ACK
+			p_I2C_Handle->p_I2Cx->CR1 &= ~(1 << I2C_CR1_ACK);
 
-					//clear the ADDR flag
-					I2C_clear_ADDR_flag(p_I2C_Handle);
-				}
-			}
-			else
+			//clear the ADDR flag
+			I2C_clear_ADDR_flag(p_I2C_Handle);
+
+			if(p_I2C_Handle->repeated_start == I2C_RS_DISABLE)
+				I2C_generate_stop(p_I2C_Handle);
+		}
+		else if( (p_I2C_Handle->p_I2Cx->SR2 >> I2C_SR2_MSL) & 1)	//device in controller mode, reading SR2 clears ADDR
+		{
+			if(p_I2C_Handle->TxRxstate != I2C_STATE_BUSY_RX)
 			{
 				//device is sending data, so address phase was successful sent and received,
 				//now clear ADDR flag so transmission continues
@@ -551,12 +652,19 @@ void I2C_EV_IRQ_handling(I2C_Handle_t *p_I2C_Handle)
 	{
 		if(p_I2C_Handle->TxRxstate == I2C_STATE_BUSY_TX)
 		{
-			if((p_I2C_Handle->p_I2Cx->SR1 >> I2C_SR1_TxE) & 1)
+			//DMA send, BTF after the stream moved the last byte (its TC interrupt may not have run yet)
+			if( ((p_I2C_Handle->p_I2Cx->CR2 >> I2C_CR2_DMAEN) & 1) && (DMA_get_remaining(p_I2C_Handle->p_Tx_DMA) == 0) )
+			{
+				p_I2C_Handle->Tx_len = 0;
+			}
+
+			//BTF with bytes left only means the TXE interrupt was late, the transfer is not done yet
+			if( ((p_I2C_Handle->p_I2Cx->SR1 >> I2C_SR1_TxE) & 1) && (p_I2C_Handle->Tx_len == 0) )
 			{
 				//both BTF = 1 and TXE = 1
 
-				//generate stop condition if all data was sent and repeated start disabled
-				if( (p_I2C_Handle->Tx_len == 0) && (p_I2C_Handle->repeated_start == I2C_RS_DISABLE)	)
+				//generate stop condition if repeated start disabled
+				if(p_I2C_Handle->repeated_start == I2C_RS_DISABLE)
 				{
 					I2C_generate_stop(p_I2C_Handle);
 				}
@@ -565,7 +673,7 @@ void I2C_EV_IRQ_handling(I2C_Handle_t *p_I2C_Handle)
 				I2C_close_send(p_I2C_Handle);
 
 				//notify user application that transmission completed
-				I2C_event_callback(p_I2C_Handle, I2C_EV_TX_CMPLT);
+				I2C_report_event(p_I2C_Handle, I2C_EV_TX_CMPLT);
 			}
 		}
 	}
@@ -580,7 +688,7 @@ void I2C_EV_IRQ_handling(I2C_Handle_t *p_I2C_Handle)
 		p_I2C_Handle->p_I2Cx->CR1 |= 0;	//a dummy write
 
 		//notify user application that stoop is detected
-		I2C_event_callback(p_I2C_Handle, I2C_EV_STOP);
+		I2C_report_event(p_I2C_Handle, I2C_EV_STOP);
 	}
 
 
@@ -602,7 +710,7 @@ void I2C_EV_IRQ_handling(I2C_Handle_t *p_I2C_Handle)
 			if( (p_I2C_Handle->p_I2Cx->SR2 >> I2C_SR2_TRA) & 1)	//ensure device is in transmitter mode
 			{
 				//notify user applicator
-				I2C_event_callback(p_I2C_Handle, I2C_EV_DATA_REQ);
+				I2C_report_event(p_I2C_Handle, I2C_EV_DATA_REQ);
 			}
 		}
 	}
@@ -624,7 +732,7 @@ void I2C_EV_IRQ_handling(I2C_Handle_t *p_I2C_Handle)
 			if( ((p_I2C_Handle->p_I2Cx->SR2 >> I2C_SR2_TRA) & 1) == 0)	//ensure device is in receiver mode
 			{
 				//notify user applicator
-				I2C_event_callback(p_I2C_Handle, I2C_EV_DATA_REC);
+				I2C_report_event(p_I2C_Handle, I2C_EV_DATA_REC);
 			}
 		}
 	}
@@ -642,7 +750,7 @@ void I2C_ER_IRQ_handling(I2C_Handle_t *p_I2C_Handle)
 		//clear BERR
 		p_I2C_Handle->p_I2Cx->SR1 &= ~(1 << I2C_SR1_BERR);
 		//notify user application
-		I2C_event_callback(p_I2C_Handle, I2C_ER_BERR);
+		I2C_report_event(p_I2C_Handle, I2C_ER_BERR);
 	}
 
 	//handle error generated by ARLO
@@ -652,7 +760,7 @@ void I2C_ER_IRQ_handling(I2C_Handle_t *p_I2C_Handle)
 		//clear ARLO
 		p_I2C_Handle->p_I2Cx->SR1 &= ~(1 << I2C_SR1_ARLO);
 		//notify user application
-		I2C_event_callback(p_I2C_Handle, I2C_ER_ARLO);
+		I2C_report_event(p_I2C_Handle, I2C_ER_ARLO);
 	}
 
 	//handle error generated by AF
@@ -662,7 +770,7 @@ void I2C_ER_IRQ_handling(I2C_Handle_t *p_I2C_Handle)
 		//clear BERR
 		p_I2C_Handle->p_I2Cx->SR1 &= ~(1 << I2C_SR1_AF);
 		//notify user application
-		I2C_event_callback(p_I2C_Handle, I2C_ER_AF);
+		I2C_report_event(p_I2C_Handle, I2C_ER_AF);
 	}
 
 	//handle error generated by OVR
@@ -672,7 +780,7 @@ void I2C_ER_IRQ_handling(I2C_Handle_t *p_I2C_Handle)
 		//clear BERR
 		p_I2C_Handle->p_I2Cx->SR1 &= ~(1 << I2C_SR1_OVR);
 		//notify user application
-		I2C_event_callback(p_I2C_Handle, I2C_ER_OVR);
+		I2C_report_event(p_I2C_Handle, I2C_ER_OVR);
 	}
 
 	//handle error generated by PECERR
@@ -682,7 +790,7 @@ void I2C_ER_IRQ_handling(I2C_Handle_t *p_I2C_Handle)
 		//clear BERR
 		p_I2C_Handle->p_I2Cx->SR1 &= ~(1 << I2C_SR1_PECERR);
 		//notify user application
-		I2C_event_callback(p_I2C_Handle, I2C_ER_PECERR);
+		I2C_report_event(p_I2C_Handle, I2C_ER_PECERR);
 	}
 
 	//handle error generated by TIMEOUT
@@ -692,7 +800,7 @@ void I2C_ER_IRQ_handling(I2C_Handle_t *p_I2C_Handle)
 		//clear BERR
 		p_I2C_Handle->p_I2Cx->SR1 &= ~(1 << I2C_SR1_TIMEOUT);
 		//notify user application
-		I2C_event_callback(p_I2C_Handle, I2C_ER_TIMEOUT);
+		I2C_report_event(p_I2C_Handle, I2C_ER_TIMEOUT);
 	}
 
 	//handle error generated by SMBALERT
@@ -702,7 +810,7 @@ void I2C_ER_IRQ_handling(I2C_Handle_t *p_I2C_Handle)
 		//clear BERR
 		p_I2C_Handle->p_I2Cx->SR1 &= ~(1 << I2C_SR1_SMBALERT);
 		//notify user application
-		I2C_event_callback(p_I2C_Handle, I2C_ER_SMBALERT);
+		I2C_report_event(p_I2C_Handle, I2C_ER_SMBALERT);
 	}
 
 }
@@ -741,19 +849,26 @@ static void I2C_controller_RXNE_handler(I2C_Handle_t *p_I2C_Handle)
 
 	if(p_I2C_Handle->Rx_len == 0)
 	{
-		//generate stop condition
-		if(p_I2C_Handle->repeated_start == I2C_RS_DISABLE)
+		//generate stop condition, for a single byte the ADDR event already did
+		if( (p_I2C_Handle->repeated_start == I2C_RS_DISABLE) && (p_I2C_Handle->Rx_size > 1) )
 			I2C_generate_stop(p_I2C_Handle);
 		//close the I2C rx
 		I2C_close_receive(p_I2C_Handle);
 		//notify user application
-		I2C_event_callback(p_I2C_Handle, I2C_EV_RX_CMPLT);
+		I2C_report_event(p_I2C_Handle, I2C_EV_RX_CMPLT);
 
 	}
 }
 
 void I2C_close_send(I2C_Handle_t *p_I2C_Handle)
 {
+	//stop the DMA of I2C_controller_send_DMA
+	if( (p_I2C_Handle->p_I2Cx->CR2 >> I2C_CR2_DMAEN) & 1 )
+	{
+		p_I2C_Handle->p_I2Cx->CR2 &= ~(1 << I2C_CR2_DMAEN);
+		DMA_stop(p_I2C_Handle->p_Tx_DMA);
+	}
+
 	//disable ITBUFEN(buffer interrupt enable)
 	p_I2C_Handle->p_I2Cx->CR2 &= ~(1 << I2C_CR2_ITBUFEN);
 	//disable ITEVTEN(event interrupt enable)
@@ -771,6 +886,15 @@ void I2C_close_send(I2C_Handle_t *p_I2C_Handle)
 
 void I2C_close_receive(I2C_Handle_t *p_I2C_Handle)
 {
+	//stop the DMA of I2C_controller_receive_DMA
+	if( (p_I2C_Handle->p_I2Cx->CR2 >> I2C_CR2_DMAEN) & 1 )
+	{
+		p_I2C_Handle->p_I2Cx->CR2 &= ~( (1 << I2C_CR2_DMAEN) | (1 << I2C_CR2_LAST) );
+		DMA_stop(p_I2C_Handle->p_Rx_DMA);
+		//I2C_controller_receive_DMA set ACK regardless of the configuration
+		I2C_manage_acking(p_I2C_Handle, DISABLE);
+	}
+
 	//disable ITBUFEN(buffer interrupt enable)
 	p_I2C_Handle->p_I2Cx->CR2 &= ~(1 << I2C_CR2_ITBUFEN);
 	//disable ITEVTEN(event interrupt enable)
@@ -863,6 +987,60 @@ void I2C_manage_acking(I2C_Handle_t *p_I2C_Handle, uint8_t enable)
 		p_I2C_Handle->p_I2Cx->CR1 &= ~(1 << I2C_CR1_ACK);
 	}
 }
+/*
+ * @func:			I2C_clk_change_handler
+ *
+ * @brief:			This function keeps the SCL timing of the given I2C correct across a clock change, it should
+ * 					be registered with RCC_register_clk_change(I2C_clk_change_handler, &I2C_Handle)
+ *
+ * @param[in]:		RCC_CLK_CHANGE_PRE or RCC_CLK_CHANGE_POST
+ * @param[in]:		address of I2C Handle for the peripheral
+ *
+ * @return:			none
+ *
+ * @note:			before the change the current transfer is let finish and the peripheral is disabled, as CCR
+ * 					and TRISE can only be written while PE is cleared, after the change FREQ/CCR/TRISE are
+ * 					recomputed and the peripheral is enabled again
+ * 					if the transfer or the bus is still busy after I2C_CLK_CHANGE_TIMEOUT loops (e.g. a target
+ * 					stretching SCL) the transfer is stopped and closed and I2C_ER_TIMEOUT is reported, so the
+ * 					clock change is not held up
+ */
+void I2C_clk_change_handler(uint8_t phase, void *p_context)
+{
+	I2C_Handle_t *p_I2C_Handle = (I2C_Handle_t*)p_context;
+	uint32_t i;
+
+	if(phase == RCC_CLK_CHANGE_PRE)
+	{
+		p_I2C_Handle->clk_change_PE = (p_I2C_Handle->p_I2Cx->CR1 >> I2C_CR1_PE) & 1;
+		if(p_I2C_Handle->clk_change_PE)
+		{
+			//wait for the interrupt based transfer to close and the STOP condition to be on the bus
+			for(i = 0; i < I2C_CLK_CHANGE_TIMEOUT; i++)
+			{
+				if( (p_I2C_Handle->TxRxstate == I2C_STATE_READY) &&
+					(I2C_get_flag_status(p_I2C_Handle->p_I2Cx, 2, I2C_SR2_BUSY) == 0) )
+					break;
+			}
+			if(i == I2C_CLK_CHANGE_TIMEOUT)
+			{
+				I2C_clk_change_abort(p_I2C_Handle);
+			}
+
+			p_I2C_Handle->p_I2Cx->CR1 &= ~(1 << I2C_CR1_PE);
+		}
+	}
+	else if(phase == RCC_CLK_CHANGE_POST)
+	{
+		I2C_set_timing(p_I2C_Handle);
+		if(p_I2C_Handle->clk_change_PE)
+		{
+			//also restores ACK, which is cleared with PE
+			I2C_periph_control(p_I2C_Handle, ENABLE);
+		}
+	}
+}
+
 /*
  * private helper functions
  */
@@ -901,3 +1079,200 @@ void I2C_generate_stop(I2C_Handle_t *p_I2C_Handle)
 {
 	p_I2C_Handle->p_I2Cx->CR1 |= (1 << I2C_CR1_STOP);
 }
+
+/*
+ * fills the DMA configuration for one direction of the I2C, called by I2C_DMA_init
+ */
+static void I2C_DMA_config(I2C_Handle_t *p_I2C_Handle, DMA_Handle_t *p_DMA_Handle, uint8_t direction)
+{
+	DMA_config_t *p_config = &p_DMA_Handle->DMA_config;
+	uint8_t tx = (direction == DMA_DIR_MEM_TO_PERIPH);
+
+	//default request mapping, all I2C requests are on DMA1, see I2C_DMA_init for the shared streams
+	if(p_DMA_Handle->p_DMAx == NULL)
+	{
+		p_DMA_Handle->p_DMAx = DMA1;
+		if(p_I2C_Handle->p_I2Cx == I2C1)
+		{
+			p_config->DMA_stream = tx ? 7 : 0;
+			p_config->DMA_channel = 1;
+		}
+		else if(p_I2C_Handle->p_I2Cx == I2C2)
+		{
+			p_config->DMA_stream = tx ? 7 : 2;
+			p_config->DMA_channel = 7;
+		}
+		else if(p_I2C_Handle->p_I2Cx == I2C3)
+		{
+			p_config->DMA_stream = tx ? 4 : 2;
+			p_config->DMA_channel = 3;
+		}
+		p_config->DMA_priority = DMA_PRIORITY_MEDIUM;
+	}
+
+	p_config->DMA_direction = direction;
+	p_config->DMA_mode = DMA_MODE_NORMAL;
+	p_config->DMA_periph_size = DMA_SIZE_BYTE;
+	p_config->DMA_mem_size = DMA_SIZE_BYTE;
+	p_config->DMA_periph_inc = DISABLE;
+	p_config->DMA_mem_inc = ENABLE;
+	p_config->DMA_FIFO_mode = DMA_FIFO_MODE_DIRECT;
+	p_config->DMA_periph_burst = DMA_BURST_SINGLE;
+	p_config->DMA_mem_burst = DMA_BURST_SINGLE;
+	p_DMA_Handle->p_context = p_I2C_Handle;
+}
+
+/*
+ * Tx stream events, the send completes on BTF in I2C_EV_IRQ_handling, only a transfer error is handled here
+ */
+static void I2C_DMA_Tx_callback(uint8_t event, void *p_context)
+{
+	I2C_Handle_t *p_I2C_Handle = (I2C_Handle_t*)p_context;
+
+	if(event == DMA_EVENT_TC)
+	{
+		p_I2C_Handle->Tx_len = 0;
+	}
+	else if(event == DMA_EVENT_TE_ERR)
+	{
+		I2C_generate_stop(p_I2C_Handle);
+		I2C_close_send(p_I2C_Handle);
+		I2C_report_event(p_I2C_Handle, I2C_ER_DMA);
+	}
+}
+
+/*
+ * Rx stream events, transfer complete means the last byte (NACKed through LAST) is in memory
+ */
+static void I2C_DMA_Rx_callback(uint8_t event, void *p_context)
+{
+	I2C_Handle_t *p_I2C_Handle = (I2C_Handle_t*)p_context;
+
+	if(event == DMA_EVENT_TC)
+	{
+		//generate stop condition, for a single byte the ADDR event already did
+		if( (p_I2C_Handle->repeated_start == I2C_RS_DISABLE) && (p_I2C_Handle->Rx_size > 1) )
+			I2C_generate_stop(p_I2C_Handle);
+		//close the I2C rx
+		I2C_close_receive(p_I2C_Handle);
+		//notify user application
+		I2C_report_event(p_I2C_Handle, I2C_EV_RX_CMPLT);
+	}
+	else if(event == DMA_EVENT_TE_ERR)
+	{
+		I2C_generate_stop(p_I2C_Handle);
+		I2C_close_receive(p_I2C_Handle);
+		I2C_report_event(p_I2C_Handle, I2C_ER_DMA);
+	}
+}
+
+/*
+ * passes an event to the callback of the Handle, or to I2C_event_callback
+ */
+static void I2C_report_event(I2C_Handle_t *p_I2C_Handle, uint8_t event)
+{
+	if(p_I2C_Handle->p_callback)
+	{
+		p_I2C_Handle->p_callback(event, p_I2C_Handle->p_context);
+	}
+	else
+	{
+		I2C_event_callback(p_I2C_Handle, event);
+	}
+}
+
+/*
+ * writes FREQ, CCR and TRISE from PCLK1 and the configured SCL speed, PE must be cleared
+ */
+static void I2C_set_timing(I2C_Handle_t *p_I2C_Handle)
+{
+	uint32_t temp;
+	uint32_t PCLK1_freq_hz = RCC_get_pclk1();
+
+	//configure clock frequency
+	uint32_t PCLK1_freq_Mhz = PCLK1_freq_hz / 1000000;	//FREQ only support Mhz
+	temp = p_I2C_Handle->p_I2Cx->CR2;
+	temp &= ~(0b111111 << I2C_CR2_FREQ);
+	temp |= (PCLK1_freq_Mhz << I2C_CR2_FREQ);
+	p_I2C_Handle->p_I2Cx->CR2 = temp;
+
+	//configure clock control register
+	uint32_t CCR;
+	temp = p_I2C_Handle->p_I2Cx->CCR;
+	uint32_t clock_speed = p_I2C_Handle->I2Cx_config.I2C_CLK_speed;
+	if( clock_speed <= I2C_CLK_SPEED_SM)
+	{
+		//standard mode
+		temp &= ~(1 << I2C_CCR_FS);		//set mode to SM
+		//calculate CCR
+		CCR = PCLK1_freq_hz / (2 * clock_speed);
+	}
+	else
+	{
+		//fast mode
+		temp |= (1 << I2C_CCR_FS);		//set mode to FM
+		//set FR duty cycle
+		uint8_t duty = p_I2C_Handle->I2Cx_config.I2C_FM_duty_cycle;
+		if(duty)	//t(low)/t(high) = 16/9
+		{
+			//set DUTY to 1
+			temp |= (duty << I2C_CCR_DUTY);
+			//calculate CCR
+			CCR = PCLK1_freq_hz / (25 * clock_speed);
+		}
+		else		//t(low)/t(high) = 2
+		{
+			//set DUTY to 0
+			temp &= ~(1 << I2C_CCR_DUTY);
+			//calculate CCR
+			 CCR = PCLK1_freq_hz / (3 * clock_speed);
+
+		}
+	}
+	temp &= ~(0xFFF << I2C_CCR_CCR);
+	temp |= ((CCR & 0xFFF) << I2C_CCR_CCR);
+	p_I2C_Handle->p_I2Cx->CCR = temp;
+
+	//configure T(rise)
+	temp = p_I2C_Handle->p_I2Cx->TRISE;
+	temp &= ~(0x3F);
+	if(clock_speed <= I2C_CLK_SPEED_SM)
+	{
+		//standard mode, T(rise) max = 1000ns
+		temp |= (PCLK1_freq_hz / 1000000) + 1;		//add 1, as specified in data sheet
+	}
+	else
+	{
+		//fast mode, T(rise) max = 300ns
+		temp |= (((PCLK1_freq_hz / 1000000U) * 300U) / 1000U) + 1;	//MHz first, PCLK1 * 300 overflows above 14.3MHz
+	}
+	p_I2C_Handle->p_I2Cx->TRISE = (temp & 0x3F);
+}
+
+/*
+ * the transfer or the bus did not go idle before a clock change, the transfer is stopped and closed, clearing PE
+ * afterwards releases SCL/SDA even if the bus is still held
+ */
+static void I2C_clk_change_abort(I2C_Handle_t *p_I2C_Handle)
+{
+	uint32_t primask;
+	uint8_t state;
+
+	IRQ_SAVE_DISABLE(primask);
+
+	state = p_I2C_Handle->TxRxstate;
+	if(state == I2C_STATE_BUSY_TX)
+	{
+		I2C_generate_stop(p_I2C_Handle);
+		I2C_close_send(p_I2C_Handle);
+	}
+	else if(state == I2C_STATE_BUSY_RX)
+	{
+		I2C_generate_stop(p_I2C_Handle);
+		I2C_close_receive(p_I2C_Handle);
+	}
+
+	IRQ_RESTORE(primask);
+
+	I2C_report_event(p_I2C_Handle, I2C_ER_TIMEOUT);
+}
@@ -10,6 +10,13 @@
 
 #include "STM32F446xx.h"
 #include "rcc.h"
+#include "DMA_driver.h"
+
+/*
+ * I2C event callback, event is from the I2C application event macros and p_context is the pointer set in the Handle
+ * (i2c_bus passes its bus here)
+ */
+typedef void (*I2C_callback_t)(uint8_t event, void *p_context);
 
 /*
  * I2C configuration structure
@@ -37,6 +44,11 @@ typedef struct
 	uint8_t 		target_addr;
 	uint32_t 		Rx_size;			//total bytes to receive
 	uint8_t 		repeated_start;
+	uint8_t			clk_change_PE;		//PE state saved by I2C_clk_change_handler
+	DMA_Handle_t	*p_Tx_DMA;			//set up by I2C_DMA_init, NULL -> no DMA
+	DMA_Handle_t	*p_Rx_DMA;
+	I2C_callback_t	p_callback;			//NULL -> I2C_event_callback
+	void			*p_context;
 }I2C_Handle_t;
 
 /*
@@ -65,6 +77,7 @@ typedef struct
 #define I2C_STATE_READY		0
 #define I2C_STATE_BUSY_TX	1
 #define I2C_STATE_BUSY_RX	2
+#define I2C_STATE_ERR		3		//returned by the DMA calls for a missing stream or a length they cannot program
 
 /*
  * possible repeated start(RS) values
@@ -83,10 +96,13 @@ typedef struct
 #define I2C_ER_AF			5
 #define I2C_ER_OVR			6
 #define I2C_ER_PECERR		7
-#define I2C_ER_TIMEOUT		8
+#define I2C_ER_TIMEOUT		8		//SMBus timeout, or I2C_clk_change_handler closed a transfer that did not finish
 #define I2C_ER_SMBALERT		9
 #define I2C_EV_DATA_REQ		10
 #define I2C_EV_DATA_REC		11
+#define I2C_ER_DMA			12		//DMA transfer error, the transfer was closed
+
+#define I2C_CLK_CHANGE_TIMEOUT	2000000U	//loops I2C_clk_change_handler waits for the transfer and the bus to go idle
 
 
 
@@ -118,6 +134,13 @@ uint8_t I2C_target_receive(I2C_reg_t *p_I2Cx);
 uint8_t I2C_controller_send_IT(I2C_Handle_t *p_I2C_Handle, uint8_t *p_Tx_buffer, uint32_t len, uint8_t target_addr, uint8_t RS_enable);
 uint8_t I2C_controller_receive_IT(I2C_Handle_t *p_I2C_Handle, uint8_t *p_Rx_buffer, uint32_t len, uint8_t target_addr, uint8_t RS_enable);
 
+/*
+ * DMA based send and receive
+ */
+void I2C_DMA_init(I2C_Handle_t *p_I2C_Handle, DMA_Handle_t *p_Tx_DMA, DMA_Handle_t *p_Rx_DMA);
+uint8_t I2C_controller_send_DMA(I2C_Handle_t *p_I2C_Handle, uint8_t *p_Tx_buffer, uint32_t len, uint8_t target_addr, uint8_t RS_enable);
+uint8_t I2C_controller_receive_DMA(I2C_Handle_t *p_I2C_Handle, uint8_t *p_Rx_buffer, uint32_t len, uint8_t target_addr, uint8_t RS_enable);
+
 /*
  * IQR configuration and handling
  */
@@ -135,6 +158,7 @@ void I2C_manage_acking(I2C_Handle_t *p_I2C_Handle, uint8_t enable);
 void I2C_close_send(I2C_Handle_t *p_I2C_Handle);
 void I2C_close_receive(I2C_Handle_t *p_I2C_Handle);
 void I2C_generate_stop(I2C_Handle_t *p_I2C_Handle);
+void I2C_clk_change_handler(uint8_t phase, void *p_context);
 
 /*
  * user application APIs
@@ -13,6 +13,22 @@
 void static SPI_TXEIE_Handle(SPI_Handle_t *p_SPI_Handle);
 void static SPI_RXNEIE_Handle(SPI_Handle_t *p_SPI_Handle);
 void static SPI_OVR_Handle(SPI_Handle_t *p_SPI_Handle);
+static void SPI_DMA_config(SPI_Handle_t *p_SPI_Handle, DMA_Handle_t *p_DMA_Handle, uint8_t direction);
+static void SPI_DMA_Tx_callback(uint8_t event, void *p_context);
+static void SPI_DMA_Rx_callback(uint8_t event, void *p_context);
+static void SPI_report_event(SPI_Handle_t *p_SPI_Handle, uint8_t event);
+static void SPI_DMA_start_transfer(SPI_Handle_t *p_SPI_Handle, uint8_t *p_Tx_buffer, uint8_t *p_Rx_buffer, uint32_t len);
+static uint8_t SPI_seg_DFF(SPI_Handle_t *p_SPI_Handle, const SPI_segment_t *p_seg);
+static uint8_t SPI_seg_check(SPI_Handle_t *p_SPI_Handle, const SPI_segment_t *p_seg, uint8_t seg_count, uint32_t max_frames);
+static uint8_t SPI_seg_pause(SPI_Handle_t *p_SPI_Handle, uint8_t seg);
+static void SPI_seg_set_DFF(SPI_Handle_t *p_SPI_Handle, uint8_t DFF);
+static void SPI_seg_load_Tx(SPI_Handle_t *p_SPI_Handle);
+static void SPI_seg_load_Rx(SPI_Handle_t *p_SPI_Handle);
+static uint8_t SPI_seg_next(SPI_Handle_t *p_SPI_Handle);
+
+//Tx source of SPI_transfer_DMA without a Tx buffer and Rx target without an Rx buffer, in SRAM for the DMA
+static uint16_t SPI_DMA_fill = SPI_FILL_PATTERN;
+static uint16_t SPI_DMA_discard;
 /*
  * @func:			SPI_clock_control
  *
@@ -267,6 +283,72 @@ void SPI_recieve(SPI_reg_t *p_SPIx, uint8_t *p_Rx_buffer, uint32_t len){
 	}
 }
 
+/*
+ * @func:			SPI_transfer
+ *
+ * @brief:			This function sends and receives len bytes at the same time (full-duplex)
+ *
+ * @param[in]:		address of SPI device
+ * @param[in]:		address of the Tx buffer, NULL -> SPI_FILL_PATTERN is sent
+ * @param[in]:		address of the Rx buffer (may be the Tx buffer), NULL -> the received data is dropped
+ * @param[in]:		the length of byte to transfer
+ *
+ * @return: 		none
+ *
+ * @note: 			this is a blocking call, the next frame is written while the current one is shifted, so the master
+ * 					clocks without a gap between frames, at most two frames are in flight so RXNE can not overrun
+ * 					a frame left in DR by an earlier SPI_send (and OVR) is cleared first
+ */
+void SPI_transfer(SPI_reg_t *p_SPIx, uint8_t *p_Tx_buffer, uint8_t *p_Rx_buffer, uint32_t len)
+{
+	uint8_t dff_16 = (p_SPIx->CR1 >> SPI_CR1_DFF) & 1;
+	uint32_t tx_frames = dff_16 ? (len / 2) : len;
+	uint32_t rx_frames = tx_frames;
+	uint16_t data;
+
+	//drop stale received data, reading DR then SR also clears OVR
+	if(SPI_get_flag_status(p_SPIx, SPI_SR_RXNE))
+	{
+		data = p_SPIx->DR;
+		data = p_SPIx->SR;
+	}
+
+	while(rx_frames > 0)
+	{
+		//one frame in the shift register and one in the Tx buffer at most
+		if( (tx_frames > 0) && ((rx_frames - tx_frames) < 2) && SPI_get_flag_status(p_SPIx, SPI_SR_TXE) )
+		{
+			data = SPI_FILL_PATTERN;
+			if(p_Tx_buffer != NULL)
+			{
+				data = dff_16 ? *((uint16_t*)p_Tx_buffer) : *p_Tx_buffer;
+				p_Tx_buffer += dff_16 ? 2 : 1;
+			}
+			p_SPIx->DR = data;
+			tx_frames--;
+		}
+
+		if(SPI_get_flag_status(p_SPIx, SPI_SR_RXNE))
+		{
+			data = p_SPIx->DR;
+			if(p_Rx_buffer != NULL)
+			{
+				if(dff_16)
+				{
+					*((uint16_t*)p_Rx_buffer) = data;
+					p_Rx_buffer += 2;
+				}
+				else
+				{
+					*p_Rx_buffer = (uint8_t)data;
+					p_Rx_buffer++;
+				}
+			}
+			rx_frames--;
+		}
+	}
+}
+
 /*
  * @func:			SPI_send_IT
  *
@@ -333,6 +415,326 @@ uint8_t SPI_recieve_IT(SPI_Handle_t *p_SPI_Handle, uint8_t *p_Rx_buffer, uint32_
 	return state;
 }
 
+/*
+ * @func:			SPI_transfer_IT
+ *
+ * @brief:			This function starts a full-duplex SPI transfer using interrupt mode, len bytes are sent and received
+ *
+ * @param[in]:		address of SPI Handle structure
+ * @param[in]:		address of the Tx buffer, NULL -> SPI_FILL_PATTERN is sent
+ * @param[in]:		address of the Rx buffer (may be the Tx buffer), NULL -> the received data is dropped
+ * @param[in]:		the length of byte to transfer
+ *
+ * @return: 		SPI_STATE_READY if the transfer started, otherwise the busy state
+ *
+ * @note: 			this is a non-blocking call, SPI_EVENT_TX_CMPLT and SPI_EVENT_RX_CMPLT are sent, the transfer is
+ * 					done at SPI_EVENT_RX_CMPLT
+ */
+uint8_t SPI_transfer_IT(SPI_Handle_t *p_SPI_Handle, uint8_t *p_Tx_buffer, uint8_t *p_Rx_buffer, uint32_t len)
+{
+	if(p_SPI_Handle->Tx_state == SPI_STATE_BUSY_IN_TX)
+	{
+		return p_SPI_Handle->Tx_state;
+	}
+	if(p_SPI_Handle->Rx_state == SPI_STATE_BUSY_IN_RX)
+	{
+		return p_SPI_Handle->Rx_state;
+	}
+
+	//a stale frame would be taken as the first received one
+	if(SPI_get_flag_status(p_SPI_Handle->p_SPIx, SPI_SR_RXNE))
+	{
+		SPI_clear_OVR_flag(p_SPI_Handle);
+	}
+
+	p_SPI_Handle->xfer_flags = 0;
+	if(p_Tx_buffer == NULL)
+	{
+		p_SPI_Handle->xfer_flags |= SPI_XFER_TX_FILL;
+	}
+	if(p_Rx_buffer == NULL)
+	{
+		p_SPI_Handle->xfer_flags |= SPI_XFER_RX_DISCARD;
+	}
+
+	p_SPI_Handle->p_Tx_buffer = p_Tx_buffer;
+	p_SPI_Handle->Tx_len = len;
+	p_SPI_Handle->Tx_state = SPI_STATE_BUSY_IN_TX;
+	p_SPI_Handle->p_Rx_buffer = p_Rx_buffer;
+	p_SPI_Handle->Rx_len = len;
+	p_SPI_Handle->Rx_state = SPI_STATE_BUSY_IN_RX;
+
+	//receive side first so the first frame is not missed
+	p_SPI_Handle->p_SPIx->CR2 |= (1 << SPI_CR2_RXNEIE);
+	p_SPI_Handle->p_SPIx->CR2 |= (1 << SPI_CR2_TXEIE);
+
+	return SPI_STATE_READY;
+}
+
+/*
+ * @func:			SPI_transfer_sg_IT
+ *
+ * @brief:			This function starts a full-duplex SPI transfer of a list of segments using interrupt mode
+ *
+ * @param[in]:		address of SPI Handle structure
+ * @param[in]:		address of the segment array, it has to stay valid until SPI_EVENT_RX_CMPLT
+ * @param[in]:		number of segments, each with len > 0
+ *
+ * @return: 		SPI_STATE_READY if the transfer started, the busy state, or SPI_STATE_ERR (no segments,
+ * 					a segment of length 0 or an odd length with 16-bit frames)
+ *
+ * @note: 			this is a non-blocking call, the interrupts go from one segment to the next without stopping the
+ * 					clock, e.g. a command header and a payload in separate buffers are sent as one burst
+ * 					the clock only stops after a segment with SPI_SEG_CS_TOGGLE (SPI_EVENT_SEG_CMPLT is sent) or
+ * 					before a segment with another frame format, DFF is set back to SPI_config.SPI_DFF at the end
+ * 					SPI_EVENT_TX_CMPLT and SPI_EVENT_RX_CMPLT are sent once, the transfer is done at SPI_EVENT_RX_CMPLT
+ */
+uint8_t SPI_transfer_sg_IT(SPI_Handle_t *p_SPI_Handle, const SPI_segment_t *p_seg, uint8_t seg_count)
+{
+	if(SPI_seg_check(p_SPI_Handle, p_seg, seg_count, 0xFFFFFFFFU) == 0)
+	{
+		return SPI_STATE_ERR;
+	}
+	if(p_SPI_Handle->Tx_state == SPI_STATE_BUSY_IN_TX)
+	{
+		return p_SPI_Handle->Tx_state;
+	}
+	if(p_SPI_Handle->Rx_state == SPI_STATE_BUSY_IN_RX)
+	{
+		return p_SPI_Handle->Rx_state;
+	}
+
+	p_SPI_Handle->p_seg = p_seg;
+	p_SPI_Handle->seg_count = seg_count;
+	p_SPI_Handle->Tx_seg = 0;
+	p_SPI_Handle->Rx_seg = 0;
+
+	SPI_seg_set_DFF(p_SPI_Handle, SPI_seg_DFF(p_SPI_Handle, &p_seg[0]));
+
+	return SPI_transfer_IT(p_SPI_Handle, p_seg[0].p_Tx_buffer, p_seg[0].p_Rx_buffer, p_seg[0].len);
+}
+
+/*
+ * @func:			SPI_DMA_init
+ *
+ * @brief:			This function sets up the DMA streams used by SPI_send_DMA, SPI_receive_DMA and SPI_transfer_DMA
+ *
+ * @param[in]:		address of SPI Handle structure, after SPI_init
+ * @param[in]:		address of the DMA Handle for transmit, NULL -> no DMA transmit
+ * @param[in]:		address of the DMA Handle for receive, NULL -> no DMA receive
+ *
+ * @return: 		none
+ *
+ * @note: 			a DMA Handle with p_DMAx NULL gets the default stream and channel of the SPI peripheral:
+ * 					SPI1 DMA2 Tx stream 3 ch 3, Rx stream 2 ch 3	SPI2 DMA1 Tx stream 4 ch 0, Rx stream 3 ch 0
+ * 					SPI3 DMA1 Tx stream 7 ch 0, Rx stream 0 ch 0	SPI4 DMA2 Tx stream 4 ch 5, Rx stream 0 ch 4
+ * 					a Handle with p_DMAx set keeps its stream, channel and priority, the rest is set here
+ * 					the application enables the stream IRQ and calls DMA_IRQ_handler from the stream's IRQ handler
+ */
+void SPI_DMA_init(SPI_Handle_t *p_SPI_Handle, DMA_Handle_t *p_Tx_DMA, DMA_Handle_t *p_Rx_DMA)
+{
+	p_SPI_Handle->p_Tx_DMA = p_Tx_DMA;
+	p_SPI_Handle->p_Rx_DMA = p_Rx_DMA;
+
+	if(p_Tx_DMA != NULL)
+	{
+		SPI_DMA_config(p_SPI_Handle, p_Tx_DMA, DMA_DIR_MEM_TO_PERIPH);
+		p_Tx_DMA->p_callback = SPI_DMA_Tx_callback;
+		DMA_init(p_Tx_DMA);
+	}
+	if(p_Rx_DMA != NULL)
+	{
+		SPI_DMA_config(p_SPI_Handle, p_Rx_DMA, DMA_DIR_PERIPH_TO_MEM);
+		p_Rx_DMA->p_callback = SPI_DMA_Rx_callback;
+		DMA_init(p_Rx_DMA);
+	}
+}
+
+/*
+ * @func:			SPI_send_DMA
+ *
+ * @brief:			This function starts SPI data transmission by DMA
+ *
+ * @param[in]:		address of SPI Handle structure, set up with SPI_DMA_init
+ * @param[in]:		address of the Tx buffer that stores data to send
+ * @param[in]:		the length of byte to send, up to 65535 frames
+ *
+ * @return: 		SPI_STATE_READY if the transmission started, the busy state, or SPI_STATE_ERR (no Tx stream,
+ * 					len 0 or over 65535 frames)
+ *
+ * @note: 			this is a non-blocking call, SPI_EVENT_TX_CMPLT is sent when the last frame has been shifted out
+ * 					in full-duplex mode the received data is not read, clear OVR afterwards or use SPI_transfer_DMA
+ */
+uint8_t SPI_send_DMA(SPI_Handle_t *p_SPI_Handle, uint8_t *p_Tx_buffer, uint32_t len)
+{
+	uint8_t state = p_SPI_Handle->Tx_state;
+	uint32_t frames = (p_SPI_Handle->p_SPIx->CR1 & (1 << SPI_CR1_DFF)) ? (len / 2) : len;
+
+	//NDTR is 16 bits, a longer buffer is not cut short silently
+	if( (p_SPI_Handle->p_Tx_DMA == NULL) || (frames == 0) || (frames > 0xFFFFU) )
+	{
+		return SPI_STATE_ERR;
+	}
+
+	//only send the data why peripheral is not in the process of sending data
+	if (state != SPI_STATE_BUSY_IN_TX)
+	{
+		//save the Tx buffer address and len to SPI_Handle
+		p_SPI_Handle->p_Tx_buffer = p_Tx_buffer;
+		p_SPI_Handle->Tx_len = len;
+
+		//mark the SPI peripheral state as busy in transmission
+		p_SPI_Handle->Tx_state = SPI_STATE_BUSY_IN_TX;
+
+		//the stream moves the buffer to DR, TXDMAEN makes TXE raise the DMA request instead of an interrupt
+		DMA_set_mem_inc(p_SPI_Handle->p_Tx_DMA, ENABLE);
+		DMA_start_IT(p_SPI_Handle->p_Tx_DMA, (uint32_t)&p_SPI_Handle->p_SPIx->DR, (uint32_t)p_Tx_buffer, (uint16_t)frames);
+		p_SPI_Handle->p_SPIx->CR2 |= (1 << SPI_CR2_TXDMAEN);
+	}
+	return state;
+}
+
+/*
+ * @func:			SPI_receive_DMA
+ *
+ * @brief:			This function starts SPI data receive by DMA
+ *
+ * @param[in]:		address of SPI Handle structure, set up with SPI_DMA_init
+ * @param[in]:		address of the Rx buffer that stores the received data
+ * @param[in]:		the length of byte to receive, up to 65535 frames
+ *
+ * @return: 		SPI_STATE_READY if the reception started, the busy state, or SPI_STATE_ERR (no Rx stream,
+ * 					len 0 or over 65535 frames)
+ *
+ * @note: 			this is a non-blocking call, SPI_EVENT_RX_CMPLT is sent when the buffer is full
+ * 					a full-duplex master has to send to get clocks, SPI_FILL_PATTERN is sent (SPI_transfer_DMA without
+ * 					a Tx buffer)
+ */
+uint8_t SPI_receive_DMA(SPI_Handle_t *p_SPI_Handle, uint8_t *p_Rx_buffer, uint32_t len)
+{
+	uint8_t state = p_SPI_Handle->Rx_state;
+	uint32_t frames = (p_SPI_Handle->p_SPIx->CR1 & (1 << SPI_CR1_DFF)) ? (len / 2) : len;
+
+	if( (p_SPI_Handle->SPI_config.SPI_device_mode == SPI_DEVICE_MODE_MASTER) &&
+			(p_SPI_Handle->SPI_config.SPI_bus_config != SPI_BUS_CONFIG_S_RXONLY) )
+	{
+		return SPI_transfer_DMA(p_SPI_Handle, NULL, p_Rx_buffer, len);
+	}
+
+	//NDTR is 16 bits, a longer buffer is not cut short silently
+	if( (p_SPI_Handle->p_Rx_DMA == NULL) || (frames == 0) || (frames > 0xFFFFU) )
+	{
+		return SPI_STATE_ERR;
+	}
+
+	//only read the data why peripheral is not in the process of reading data
+	if (state != SPI_STATE_BUSY_IN_RX)
+	{
+		//save the Rx buffer address and len to SPI_Handle
+		p_SPI_Handle->p_Rx_buffer = p_Rx_buffer;
+		p_SPI_Handle->Rx_len = len;
+
+		//mark the SPI peripheral state as busy in reception
+		p_SPI_Handle->Rx_state = SPI_STATE_BUSY_IN_RX;
+
+		DMA_set_mem_inc(p_SPI_Handle->p_Rx_DMA, ENABLE);
+		DMA_start_IT(p_SPI_Handle->p_Rx_DMA, (uint32_t)&p_SPI_Handle->p_SPIx->DR, (uint32_t)p_Rx_buffer, (uint16_t)frames);
+		p_SPI_Handle->p_SPIx->CR2 |= (1 << SPI_CR2_RXDMAEN);
+	}
+	return state;
+}
+
+/*
+ * @func:			SPI_transfer_DMA
+ *
+ * @brief:			This function starts a full-duplex SPI transfer by DMA, len bytes are sent and received
+ *
+ * @param[in]:		address of SPI Handle structure, set up with SPI_DMA_init
+ * @param[in]:		address of the Tx buffer that stores data to send, NULL -> SPI_FILL_PATTERN is sent
+ * @param[in]:		address of the Rx buffer (may be the Tx buffer), NULL -> the received data is dropped
+ * @param[in]:		the length of byte to transfer, up to 65535 frames
+ *
+ * @return: 		SPI_STATE_READY if the transfer started, the busy state, or SPI_STATE_ERR (a stream missing,
+ * 					len 0 or over 65535 frames)
+ *
+ * @note: 			this is a non-blocking call, SPI_EVENT_TX_CMPLT and SPI_EVENT_RX_CMPLT are sent, the transfer is
+ * 					done at SPI_EVENT_RX_CMPLT
+ */
+uint8_t SPI_transfer_DMA(SPI_Handle_t *p_SPI_Handle, uint8_t *p_Tx_buffer, uint8_t *p_Rx_buffer, uint32_t len)
+{
+	uint32_t frames = (p_SPI_Handle->p_SPIx->CR1 & (1 << SPI_CR1_DFF)) ? (len / 2) : len;
+
+	//NDTR is 16 bits, a longer buffer is not cut short silently
+	if( (p_SPI_Handle->p_Tx_DMA == NULL) || (p_SPI_Handle->p_Rx_DMA == NULL) || (frames == 0) || (frames > 0xFFFFU) )
+	{
+		return SPI_STATE_ERR;
+	}
+
+	if(p_SPI_Handle->Tx_state == SPI_STATE_BUSY_IN_TX)
+	{
+		return p_SPI_Handle->Tx_state;
+	}
+	if(p_SPI_Handle->Rx_state == SPI_STATE_BUSY_IN_RX)
+	{
+		return p_SPI_Handle->Rx_state;
+	}
+
+	p_SPI_Handle->p_Tx_buffer = p_Tx_buffer;
+	p_SPI_Handle->Tx_len = len;
+	p_SPI_Handle->Tx_state = SPI_STATE_BUSY_IN_TX;
+	p_SPI_Handle->p_Rx_buffer = p_Rx_buffer;
+	p_SPI_Handle->Rx_len = len;
+	p_SPI_Handle->Rx_state = SPI_STATE_BUSY_IN_RX;
+
+	SPI_DMA_start_transfer(p_SPI_Handle, p_Tx_buffer, p_Rx_buffer, len);
+
+	return SPI_STATE_READY;
+}
+
+/*
+ * @func:			SPI_transfer_sg_DMA
+ *
+ * @brief:			This function starts a full-duplex SPI transfer of a list of segments by DMA
+ *
+ * @param[in]:		address of SPI Handle structure, set up with SPI_DMA_init
+ * @param[in]:		address of the segment array, it has to stay valid until SPI_EVENT_RX_CMPLT
+ * @param[in]:		number of segments, each with len > 0 and up to 65535 frames
+ *
+ * @return: 		SPI_STATE_READY if the transfer started, the busy state, or SPI_STATE_ERR (no segments, a
+ * 					stream missing, a segment of length 0, over 65535 frames or odd with 16-bit frames)
+ *
+ * @note: 			this is a non-blocking call, the Rx stream interrupt of a segment starts both streams on the next
+ * 					one, so the data is not copied into one buffer but the clock stops for the interrupt latency
+ * 					SPI_SEG_CS_TOGGLE and the frame format work as in SPI_transfer_sg_IT
+ * 					SPI_EVENT_TX_CMPLT and SPI_EVENT_RX_CMPLT are sent once, the transfer is done at SPI_EVENT_RX_CMPLT
+ */
+uint8_t SPI_transfer_sg_DMA(SPI_Handle_t *p_SPI_Handle, const SPI_segment_t *p_seg, uint8_t seg_count)
+{
+	//checked up front, a segment refused in the middle of the list would leave the transfer hanging
+	if( (p_SPI_Handle->p_Tx_DMA == NULL) || (p_SPI_Handle->p_Rx_DMA == NULL) ||
+			(SPI_seg_check(p_SPI_Handle, p_seg, seg_count, 0xFFFFU) == 0) )
+	{
+		return SPI_STATE_ERR;
+	}
+	if(p_SPI_Handle->Tx_state == SPI_STATE_BUSY_IN_TX)
+	{
+		return p_SPI_Handle->Tx_state;
+	}
+	if(p_SPI_Handle->Rx_state == SPI_STATE_BUSY_IN_RX)
+	{
+		return p_SPI_Handle->Rx_state;
+	}
+
+	p_SPI_Handle->p_seg = p_seg;
+	p_SPI_Handle->seg_count = seg_count;
+	p_SPI_Handle->Tx_seg = 0;
+	p_SPI_Handle->Rx_seg = 0;
+
+	SPI_seg_set_DFF(p_SPI_Handle, SPI_seg_DFF(p_SPI_Handle, &p_seg[0]));
+
+	return SPI_transfer_DMA(p_SPI_Handle, p_seg[0].p_Tx_buffer, p_seg[0].p_Rx_buffer, p_seg[0].len);
+}
+
 /*
  * @func:				SPI_IRQ_config
  *
@@ -425,7 +827,7 @@ void SPI_IRQ_handler(SPI_Handle_t *p_SPI_Handle){
 
 	//check if interrupt is TXEIE and RXNE is set, ie triggering interrupt when Tx buffer is empty
 	temp1 = ( (p_SPI_Handle->p_SPIx->SR >> SPI_SR_TXE) & 1);
-	temp2 = ( (p_SPI_Handle->p_SPIx->SR >> SPI_CR2_TXEIE) & 1);
+	temp2 = ( (p_SPI_Handle->p_SPIx->CR2 >> SPI_CR2_TXEIE) & 1);
 
 	if(temp1 & temp2)
 	{
@@ -434,7 +836,7 @@ void SPI_IRQ_handler(SPI_Handle_t *p_SPI_Handle){
 
 	//check if interrupt is RXNEIE and RXNE is set, ie triggering interrupt when Rx buffer is not empty
 	temp1 = ( (p_SPI_Handle->p_SPIx->SR >> SPI_SR_RXNE) & 1);
-	temp2 = ( (p_SPI_Handle->p_SPIx->SR >> SPI_CR2_RXNEIE) & 1);
+	temp2 = ( (p_SPI_Handle->p_SPIx->CR2 >> SPI_CR2_RXNEIE) & 1);
 
 	if(temp1 & temp2)
 	{
@@ -443,7 +845,7 @@ void SPI_IRQ_handler(SPI_Handle_t *p_SPI_Handle){
 
 	//check if interrupt is ERRIE and OVR
 	temp1 = ( (p_SPI_Handle->p_SPIx->SR >> SPI_SR_OVR) & 1);
-	temp2 = ( (p_SPI_Handle->p_SPIx->SR >> SPI_CR2_ERRIE) & 1);
+	temp2 = ( (p_SPI_Handle->p_SPIx->CR2 >> SPI_CR2_ERRIE) & 1);
 
 	if(temp1 & temp2)
 	{
@@ -526,8 +928,14 @@ void SPI_SSOE_config(SPI_reg_t *p_SPIx, uint8_t enable)
  */
 void static SPI_TXEIE_Handle(SPI_Handle_t *p_SPI_Handle)
 {
+	//SPI_transfer_IT without a Tx buffer
+	if(p_SPI_Handle->xfer_flags & SPI_XFER_TX_FILL)
+	{
+		p_SPI_Handle->p_SPIx->DR = SPI_FILL_PATTERN;
+		p_SPI_Handle->Tx_len -= (p_SPI_Handle->p_SPIx->CR1 & (1 << SPI_CR1_DFF)) ? 2 : 1;
+	}
 	//check DFF bit
-	if(p_SPI_Handle->p_SPIx->CR1 & (1 << SPI_CR1_DFF)) //DFF bit is set, 16-bit
+	else if(p_SPI_Handle->p_SPIx->CR1 & (1 << SPI_CR1_DFF)) //DFF bit is set, 16-bit
 	{
 		//write to data register(DR)
 		p_SPI_Handle->p_SPIx->DR = *( (uint16_t*)p_SPI_Handle->p_Tx_buffer );  //cast to uint16_t then dereference to write 16 bits
@@ -544,11 +952,27 @@ void static SPI_TXEIE_Handle(SPI_Handle_t *p_SPI_Handle)
 	//and inform use application that transmission is over
 	if(p_SPI_Handle->Tx_len == 0)
 	{
+		//scatter-gather, go on with the next segment unless the clock has to stop after this one
+		if( (p_SPI_Handle->p_seg != NULL) && ((p_SPI_Handle->Tx_seg + 1) < p_SPI_Handle->seg_count) )
+		{
+			if(SPI_seg_pause(p_SPI_Handle, p_SPI_Handle->Tx_seg))
+			{
+				//the Rx side restarts the transmission after the last frame of the segment is in
+				p_SPI_Handle->p_SPIx->CR2 &= ~(1 << SPI_CR2_TXEIE);
+			}
+			else
+			{
+				p_SPI_Handle->Tx_seg++;
+				SPI_seg_load_Tx(p_SPI_Handle);
+			}
+			return;
+		}
+
 		//close transmission
 		SPI_close_transmission(p_SPI_Handle);
 
 		//inform user application
-		SPI_event_callback(p_SPI_Handle, SPI_EVENT_TX_CMPLT);
+		SPI_report_event(p_SPI_Handle, SPI_EVENT_TX_CMPLT);
 	}
 
 }
@@ -567,8 +991,17 @@ void static SPI_TXEIE_Handle(SPI_Handle_t *p_SPI_Handle)
  */
 void static SPI_RXNEIE_Handle(SPI_Handle_t *p_SPI_Handle)
 {
+	uint16_t dummy;
+
+	//SPI_transfer_IT without an Rx buffer
+	if(p_SPI_Handle->xfer_flags & SPI_XFER_RX_DISCARD)
+	{
+		dummy = p_SPI_Handle->p_SPIx->DR;
+		(void)dummy;
+		p_SPI_Handle->Rx_len -= (p_SPI_Handle->p_SPIx->CR1 & (1 << SPI_CR1_DFF)) ? 2 : 1;
+	}
 	//check DFF bit
-	if(p_SPI_Handle->p_SPIx->CR1 & (1 << SPI_CR1_DFF)) //DFF bit is set, 16-bit
+	else if(p_SPI_Handle->p_SPIx->CR1 & (1 << SPI_CR1_DFF)) //DFF bit is set, 16-bit
 	{
 		//read data register(DR)
 		*( (uint16_t*)p_SPI_Handle->p_Rx_buffer ) = p_SPI_Handle->p_SPIx->DR;  //cast to uint16_t then dereference to read 16 bits
@@ -585,11 +1018,17 @@ void static SPI_RXNEIE_Handle(SPI_Handle_t *p_SPI_Handle)
 	//and inform use application that transmission is over
 	if(p_SPI_Handle->Rx_len == 0)
 	{
+		//scatter-gather, more segments to go
+		if(SPI_seg_next(p_SPI_Handle))
+		{
+			return;
+		}
+
 		//close reception
 		SPI_close_reception(p_SPI_Handle);
 
 		//inform user application
-		SPI_event_callback(p_SPI_Handle, SPI_EVENT_RX_CMPLT);
+		SPI_report_event(p_SPI_Handle, SPI_EVENT_RX_CMPLT);
 	}
 }
 
@@ -615,7 +1054,7 @@ void static SPI_OVR_Handle(SPI_Handle_t *p_SPI_Handle)
 		SPI_clear_OVR_flag(p_SPI_Handle);
 	}
 	//inform user application, should resend the data and clear OVR flag
-	SPI_event_callback(p_SPI_Handle, SPI_EVENT_OVR_ERR);
+	SPI_report_event(p_SPI_Handle, SPI_EVENT_OVR_ERR);
 }
 
 /*
@@ -650,7 +1089,15 @@ void SPI_close_transmission(SPI_Handle_t *p_SPI_Handle)
 	//reset TXEIE (disable tx buffer empty interrupt)
 	p_SPI_Handle->p_SPIx->CR2 &= ~(1 << SPI_CR2_TXEIE);
 
+	//stop the DMA stream if the transmission was started by SPI_send_DMA/SPI_transfer_DMA
+	if(p_SPI_Handle->p_SPIx->CR2 & (1 << SPI_CR2_TXDMAEN))
+	{
+		p_SPI_Handle->p_SPIx->CR2 &= ~(1 << SPI_CR2_TXDMAEN);
+		DMA_stop(p_SPI_Handle->p_Tx_DMA);
+	}
+
 	//reset SPI Handler values
+	p_SPI_Handle->xfer_flags &= ~SPI_XFER_TX_FILL;
 	p_SPI_Handle->p_Tx_buffer = NULL;
 	p_SPI_Handle->Tx_len = 0;
 	p_SPI_Handle->Tx_state = SPI_STATE_READY;
@@ -670,12 +1117,395 @@ void SPI_close_reception(SPI_Handle_t *p_SPI_Handle)
 	//reset RXNEIE (disable Rx buffer not  empty interrupt)
 	p_SPI_Handle->p_SPIx->CR2 &= ~(1 << SPI_CR2_RXNEIE);
 
+	//stop the DMA stream if the reception was started by SPI_receive_DMA/SPI_transfer_DMA
+	if(p_SPI_Handle->p_SPIx->CR2 & (1 << SPI_CR2_RXDMAEN))
+	{
+		p_SPI_Handle->p_SPIx->CR2 &= ~(1 << SPI_CR2_RXDMAEN);
+		DMA_stop(p_SPI_Handle->p_Rx_DMA);
+	}
+
 	//reset SPI Handler values
+	p_SPI_Handle->xfer_flags &= ~SPI_XFER_RX_DISCARD;
+	p_SPI_Handle->p_seg = NULL;
 	p_SPI_Handle->p_Rx_buffer = NULL;
 	p_SPI_Handle->Rx_len = 0;
 	p_SPI_Handle->Rx_state = SPI_STATE_READY;
 }
 
+/*
+ * @func:			SPI_DMA_config
+ *
+ * @brief:			This function fills the DMA configuration for one direction of the SPI peripheral
+ *
+ * @param[in]:		address of the SPI Handle structure
+ * @param[in]:		address of the DMA Handle structure
+ * @param[in]:		DMA_DIR_MEM_TO_PERIPH or DMA_DIR_PERIPH_TO_MEM
+ *
+ * @return:			none
+ *
+ * @note:			This function is called by SPI_DMA_init
+ */
+static void SPI_DMA_config(SPI_Handle_t *p_SPI_Handle, DMA_Handle_t *p_DMA_Handle, uint8_t direction)
+{
+	DMA_config_t *p_config = &p_DMA_Handle->DMA_config;
+	SPI_reg_t *p_SPIx = p_SPI_Handle->p_SPIx;
+	uint8_t tx = (direction == DMA_DIR_MEM_TO_PERIPH);
+
+	//default request mapping, the streams are picked so the SPI peripherals do not share one
+	if(p_DMA_Handle->p_DMAx == NULL)
+	{
+		if(p_SPIx == SPI1)
+		{
+			p_DMA_Handle->p_DMAx = DMA2;
+			p_config->DMA_stream = tx ? 3 : 2;
+			p_config->DMA_channel = 3;
+		}
+		else if(p_SPIx == SPI2)
+		{
+			p_DMA_Handle->p_DMAx = DMA1;
+			p_config->DMA_stream = tx ? 4 : 3;
+			p_config->DMA_channel = 0;
+		}
+		else if(p_SPIx == SPI3)
+		{
+			p_DMA_Handle->p_DMAx = DMA1;
+			p_config->DMA_stream = tx ? 7 : 0;
+			p_config->DMA_channel = 0;
+		}
+		else if(p_SPIx == SPI4)
+		{
+			p_DMA_Handle->p_DMAx = DMA2;
+			p_config->DMA_stream = tx ? 4 : 0;
+			p_config->DMA_channel = tx ? 5 : 4;
+		}
+		p_config->DMA_priority = DMA_PRIORITY_HIGH;
+	}
+
+	//one frame per request to/from DR, direct mode
+	p_config->DMA_direction = direction;
+	p_config->DMA_mode = DMA_MODE_NORMAL;
+	p_config->DMA_periph_size = (p_SPI_Handle->SPI_config.SPI_DFF == SPI_DFF_16BITS) ? DMA_SIZE_HALF_WORD : DMA_SIZE_BYTE;
+	p_config->DMA_mem_size = p_config->DMA_periph_size;
+	p_config->DMA_periph_inc = DISABLE;
+	p_config->DMA_mem_inc = ENABLE;
+	p_config->DMA_FIFO_mode = DMA_FIFO_MODE_DIRECT;
+	p_config->DMA_periph_burst = DMA_BURST_SINGLE;
+	p_config->DMA_mem_burst = DMA_BURST_SINGLE;
+	p_DMA_Handle->p_context = p_SPI_Handle;
+}
+
+/*
+ * @func:			SPI_DMA_Tx_callback
+ *
+ * @brief:			This function closes the transmission when the Tx stream is done and informs the user application
+ *
+ * @param[in]:		event from @DMA_EVENTS
+ * @param[in]:		address of the SPI Handle structure
+ *
+ * @return:			none
+ *
+ * @note:			This function is called by DMA_IRQ_handler of the Tx stream
+ */
+static void SPI_DMA_Tx_callback(uint8_t event, void *p_context)
+{
+	SPI_Handle_t *p_SPI_Handle = (SPI_Handle_t*)p_context;
+
+	if(event == DMA_EVENT_TC)
+	{
+		//scatter-gather, the Rx stream interrupt starts the next segment
+		if( (p_SPI_Handle->p_seg != NULL) && ((p_SPI_Handle->Tx_seg + 1) < p_SPI_Handle->seg_count) )
+		{
+			return;
+		}
+
+		//the stream is done when the last frame is written to DR, wait until it is shifted out
+		while(SPI_get_flag_status(p_SPI_Handle->p_SPIx, SPI_SR_TXE) == 0);
+		if(p_SPI_Handle->SPI_config.SPI_device_mode == SPI_DEVICE_MODE_MASTER)
+		{
+			while(SPI_get_flag_status(p_SPI_Handle->p_SPIx, SPI_SR_BSY));
+		}
+		SPI_close_transmission(p_SPI_Handle);
+		SPI_report_event(p_SPI_Handle, SPI_EVENT_TX_CMPLT);
+	}
+	else if(event == DMA_EVENT_TE_ERR)
+	{
+		SPI_close_transmission(p_SPI_Handle);
+		SPI_report_event(p_SPI_Handle, SPI_EVENT_DMA_ERR);
+	}
+}
+
+/*
+ * @func:			SPI_DMA_Rx_callback
+ *
+ * @brief:			This function closes the reception when the Rx stream is done and informs the user application
+ *
+ * @param[in]:		event from @DMA_EVENTS
+ * @param[in]:		address of the SPI Handle structure
+ *
+ * @return:			none
+ *
+ * @note:			This function is called by DMA_IRQ_handler of the Rx stream
+ */
+static void SPI_DMA_Rx_callback(uint8_t event, void *p_context)
+{
+	SPI_Handle_t *p_SPI_Handle = (SPI_Handle_t*)p_context;
+
+	if(event == DMA_EVENT_TC)
+	{
+		//scatter-gather, more segments to go
+		if(SPI_seg_next(p_SPI_Handle))
+		{
+			return;
+		}
+
+		SPI_close_reception(p_SPI_Handle);
+		SPI_report_event(p_SPI_Handle, SPI_EVENT_RX_CMPLT);
+	}
+	else if(event == DMA_EVENT_TE_ERR)
+	{
+		SPI_close_reception(p_SPI_Handle);
+		SPI_report_event(p_SPI_Handle, SPI_EVENT_DMA_ERR);
+	}
+}
+
+/*
+ * @func:			SPI_report_event
+ *
+ * @brief:			This function passes an event to the callback of the Handle, or to SPI_event_callback
+ *
+ * @param[in]:		address of the SPI Handle structure
+ * @param[in]:		event from the SPI application events
+ *
+ * @return:			none
+ */
+static void SPI_report_event(SPI_Handle_t *p_SPI_Handle, uint8_t event)
+{
+	if(p_SPI_Handle->p_callback)
+	{
+		p_SPI_Handle->p_callback(event, p_SPI_Handle->p_context);
+	}
+	else
+	{
+		SPI_event_callback(p_SPI_Handle, event);
+	}
+}
+
+/*
+ * @func:			SPI_DMA_start_transfer
+ *
+ * @brief:			This function starts both DMA streams of a full-duplex transfer
+ *
+ * @param[in]:		address of the SPI Handle structure
+ * @param[in]:		address of the Tx buffer, NULL -> SPI_FILL_PATTERN is sent
+ * @param[in]:		address of the Rx buffer, NULL -> the received data is dropped
+ * @param[in]:		the length of byte to transfer, up to 65535 frames
+ *
+ * @return:			none
+ *
+ * @note:			This function is called by SPI_transfer_DMA and for each segment of SPI_transfer_sg_DMA
+ */
+static void SPI_DMA_start_transfer(SPI_Handle_t *p_SPI_Handle, uint8_t *p_Tx_buffer, uint8_t *p_Rx_buffer, uint32_t len)
+{
+	uint32_t frames = (p_SPI_Handle->p_SPIx->CR1 & (1 << SPI_CR1_DFF)) ? (len / 2) : len;
+	uint32_t tx_addr, rx_addr;
+
+	//without a buffer the stream stays on the fill/discard word
+	DMA_set_mem_inc(p_SPI_Handle->p_Rx_DMA, (p_Rx_buffer != NULL) ? ENABLE : DISABLE);
+	DMA_set_mem_inc(p_SPI_Handle->p_Tx_DMA, (p_Tx_buffer != NULL) ? ENABLE : DISABLE);
+	rx_addr = (p_Rx_buffer != NULL) ? (uint32_t)p_Rx_buffer : (uint32_t)&SPI_DMA_discard;
+	tx_addr = (p_Tx_buffer != NULL) ? (uint32_t)p_Tx_buffer : (uint32_t)&SPI_DMA_fill;
+
+	//receive side first so the first frame can not overrun
+	DMA_start_IT(p_SPI_Handle->p_Rx_DMA, (uint32_t)&p_SPI_Handle->p_SPIx->DR, rx_addr, (uint16_t)frames);
+	p_SPI_Handle->p_SPIx->CR2 |= (1 << SPI_CR2_RXDMAEN);
+	DMA_start_IT(p_SPI_Handle->p_Tx_DMA, (uint32_t)&p_SPI_Handle->p_SPIx->DR, tx_addr, (uint16_t)frames);
+	p_SPI_Handle->p_SPIx->CR2 |= (1 << SPI_CR2_TXDMAEN);
+}
+
+/*
+ * frame format of a scatter-gather segment, SPI_DFF_8BITS or SPI_DFF_16BITS
+ */
+static uint8_t SPI_seg_DFF(SPI_Handle_t *p_SPI_Handle, const SPI_segment_t *p_seg)
+{
+	if(p_seg->flags & SPI_SEG_DFF_16)
+	{
+		return SPI_DFF_16BITS;
+	}
+	if(p_seg->flags & SPI_SEG_DFF_8)
+	{
+		return SPI_DFF_8BITS;
+	}
+	return p_SPI_Handle->SPI_config.SPI_DFF;
+}
+
+/*
+ * 1 -> the segment list can be started: not empty, every segment whole frames, 1 to max_frames of them
+ */
+static uint8_t SPI_seg_check(SPI_Handle_t *p_SPI_Handle, const SPI_segment_t *p_seg, uint8_t seg_count, uint32_t max_frames)
+{
+	uint32_t frames;
+
+	if( (p_seg == NULL) || (seg_count == 0) )
+	{
+		return 0;
+	}
+
+	for(uint8_t i = 0; i < seg_count; i++)
+	{
+		frames = p_seg[i].len;
+		if(SPI_seg_DFF(p_SPI_Handle, &p_seg[i]) == SPI_DFF_16BITS)
+		{
+			if(p_seg[i].len & 1)
+			{
+				return 0;
+			}
+			frames /= 2;
+		}
+		if( (frames == 0) || (frames > max_frames) )
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*
+ * 1 -> the clock has to stop between segment seg and the next one (chip select toggle or DFF change)
+ */
+static uint8_t SPI_seg_pause(SPI_Handle_t *p_SPI_Handle, uint8_t seg)
+{
+	return ( (p_SPI_Handle->p_seg[seg].flags & SPI_SEG_CS_TOGGLE) ||
+			(SPI_seg_DFF(p_SPI_Handle, &p_SPI_Handle->p_seg[seg]) != SPI_seg_DFF(p_SPI_Handle, &p_SPI_Handle->p_seg[seg + 1])) );
+}
+
+/*
+ * switches CR1 DFF (and the DMA data sizes) if needed, DFF is only written with SPE cleared and the bus idle
+ * SPI_config.SPI_DFF is not changed, it stays the format of the device
+ */
+static void SPI_seg_set_DFF(SPI_Handle_t *p_SPI_Handle, uint8_t DFF)
+{
+	SPI_reg_t *p_SPIx = p_SPI_Handle->p_SPIx;
+	uint8_t size = (DFF == SPI_DFF_16BITS) ? DMA_SIZE_HALF_WORD : DMA_SIZE_BYTE;
+	uint8_t enabled;
+
+	if( ((p_SPIx->CR1 >> SPI_CR1_DFF) & 1) == DFF )
+	{
+		return;
+	}
+
+	enabled = (p_SPIx->CR1 >> SPI_CR1_SPE) & 1;
+	while(SPI_get_flag_status(p_SPIx, SPI_SR_BSY));
+	SPI_periph_control(p_SPIx, DISABLE);
+
+	p_SPIx->CR1 = (p_SPIx->CR1 & ~(1 << SPI_CR1_DFF)) | (DFF << SPI_CR1_DFF);
+
+	if(enabled)
+	{
+		SPI_periph_control(p_SPIx, ENABLE);
+	}
+
+	//the streams are stopped here, a pending Tx complete interrupt is kept
+	if(p_SPI_Handle->p_Tx_DMA != NULL)
+	{
+		DMA_set_data_size(p_SPI_Handle->p_Tx_DMA, size, size);
+	}
+	if(p_SPI_Handle->p_Rx_DMA != NULL)
+	{
+		DMA_set_data_size(p_SPI_Handle->p_Rx_DMA, size, size);
+	}
+}
+
+/*
+ * loads segment Tx_seg into the Tx side of the interrupt transfer
+ */
+static void SPI_seg_load_Tx(SPI_Handle_t *p_SPI_Handle)
+{
+	const SPI_segment_t *p_seg = &p_SPI_Handle->p_seg[p_SPI_Handle->Tx_seg];
+
+	p_SPI_Handle->p_Tx_buffer = p_seg->p_Tx_buffer;
+	p_SPI_Handle->Tx_len = p_seg->len;
+	if(p_seg->p_Tx_buffer == NULL)
+	{
+		p_SPI_Handle->xfer_flags |= SPI_XFER_TX_FILL;
+	}
+	else
+	{
+		p_SPI_Handle->xfer_flags &= ~SPI_XFER_TX_FILL;
+	}
+}
+
+/*
+ * loads segment Rx_seg into the Rx side of the interrupt transfer
+ */
+static void SPI_seg_load_Rx(SPI_Handle_t *p_SPI_Handle)
+{
+	const SPI_segment_t *p_seg = &p_SPI_Handle->p_seg[p_SPI_Handle->Rx_seg];
+
+	p_SPI_Handle->p_Rx_buffer = p_seg->p_Rx_buffer;
+	p_SPI_Handle->Rx_len = p_seg->len;
+	if(p_seg->p_Rx_buffer == NULL)
+	{
+		p_SPI_Handle->xfer_flags |= SPI_XFER_RX_DISCARD;
+	}
+	else
+	{
+		p_SPI_Handle->xfer_flags &= ~SPI_XFER_RX_DISCARD;
+	}
+}
+
+/*
+ * called when the Rx side finished segment Rx_seg (RXNE interrupt or Rx stream complete)
+ * 1 -> the transfer goes on with the next segment, 0 -> it was the last one (or no scatter-gather), DFF is set back
+ */
+static uint8_t SPI_seg_next(SPI_Handle_t *p_SPI_Handle)
+{
+	uint8_t pause;
+
+	if(p_SPI_Handle->p_seg == NULL)
+	{
+		return 0;
+	}
+
+	if( (p_SPI_Handle->Rx_seg + 1) >= p_SPI_Handle->seg_count )
+	{
+		SPI_seg_set_DFF(p_SPI_Handle, p_SPI_Handle->SPI_config.SPI_DFF);
+		return 0;
+	}
+
+	pause = SPI_seg_pause(p_SPI_Handle, p_SPI_Handle->Rx_seg);
+	if(pause)
+	{
+		//the clock is stopped, e.g. spi_bus toggles the chip select
+		if(p_SPI_Handle->p_seg[p_SPI_Handle->Rx_seg].flags & SPI_SEG_CS_TOGGLE)
+		{
+			SPI_report_event(p_SPI_Handle, SPI_EVENT_SEG_CMPLT);
+		}
+		SPI_seg_set_DFF(p_SPI_Handle, SPI_seg_DFF(p_SPI_Handle, &p_SPI_Handle->p_seg[p_SPI_Handle->Rx_seg + 1]));
+	}
+	p_SPI_Handle->Rx_seg++;
+
+	if(p_SPI_Handle->p_SPIx->CR2 & (1 << SPI_CR2_RXDMAEN))
+	{
+		//a Tx complete interrupt still pending would close the transmission, the stream is already done
+		p_SPI_Handle->Tx_seg = p_SPI_Handle->Rx_seg;
+		DMA_stop(p_SPI_Handle->p_Tx_DMA);
+		SPI_DMA_start_transfer(p_SPI_Handle, p_SPI_Handle->p_seg[p_SPI_Handle->Rx_seg].p_Tx_buffer,
+				p_SPI_Handle->p_seg[p_SPI_Handle->Rx_seg].p_Rx_buffer, p_SPI_Handle->p_seg[p_SPI_Handle->Rx_seg].len);
+	}
+	else
+	{
+		SPI_seg_load_Rx(p_SPI_Handle);
+		if(pause)
+		{
+			//the Tx side waits at the end of the finished segment
+			p_SPI_Handle->Tx_seg = p_SPI_Handle->Rx_seg;
+			SPI_seg_load_Tx(p_SPI_Handle);
+			p_SPI_Handle->p_SPIx->CR2 |= (1 << SPI_CR2_TXEIE);
+		}
+	}
+	return 1;
+}
+
 /*
  * @func:			SPI_event_callback
  *
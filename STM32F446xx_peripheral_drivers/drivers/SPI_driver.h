@@ -10,6 +10,13 @@
 
 #include <stdint.h>
 #include "STM32F446xx.h"
+#include "DMA_driver.h"
+
+/*
+ * SPI event callback, event is from the SPI application events and p_context is the pointer set in the Handle
+ * (spi_bus passes its bus here)
+ */
+typedef void (*SPI_callback_t)(uint8_t event, void *p_context);
 
 /*
  * SPI device configuration structure
@@ -25,6 +32,17 @@ typedef struct
 	uint8_t SPI_SSM;			//!< possible values from @SPI_SSM
 }SPI_config_t;
 
+/*
+ * one segment of a scatter-gather transfer (SPI_transfer_sg_IT, SPI_transfer_sg_DMA)
+ */
+typedef struct
+{
+	uint8_t		*p_Tx_buffer;		//NULL -> SPI_FILL_PATTERN is sent
+	uint8_t		*p_Rx_buffer;		//NULL -> the received data is dropped
+	uint32_t	len;				//bytes, up to 65535 frames with DMA
+	uint8_t		flags;				//!< possible values from @SPI_SEG_FLAGS
+}SPI_segment_t;
+
 /*
  * SPI device Handle structure
  */
@@ -38,6 +56,15 @@ typedef struct
 	uint32_t 		Rx_len;
 	uint8_t 		Rx_state;
 	uint8_t 		Tx_state;
+	DMA_Handle_t	*p_Tx_DMA;		//set up by SPI_DMA_init, NULL -> no DMA
+	DMA_Handle_t	*p_Rx_DMA;
+	uint8_t			xfer_flags;		//SPI_transfer_IT, possible values from @SPI_XFER_FLAGS
+	SPI_callback_t	p_callback;		//NULL -> SPI_event_callback
+	void			*p_context;
+	const SPI_segment_t	*p_seg;		//scatter-gather transfer, NULL -> single buffer
+	uint8_t			seg_count;
+	uint8_t			Tx_seg;			//segment the Tx side is in
+	uint8_t			Rx_seg;			//segment the Rx side is in
 }SPI_Handle_t;
 
 
@@ -91,12 +118,33 @@ typedef struct
 #define SPI_SSM_DI	0		//disable
 #define SPI_SSM_EN	1		//enable
 
+/*
+ * frame sent by SPI_transfer, SPI_transfer_IT and SPI_transfer_DMA when there is no Tx buffer
+ */
+#ifndef SPI_FILL_PATTERN
+#define SPI_FILL_PATTERN	0xFFFFU
+#endif
+
+/*
+ * @SPI_XFER_FLAGS
+ */
+#define SPI_XFER_TX_FILL		(1 << 0)	//no Tx buffer, SPI_FILL_PATTERN is sent
+#define SPI_XFER_RX_DISCARD		(1 << 1)	//no Rx buffer, the received frames are dropped
+
+/*
+ * @SPI_SEG_FLAGS
+ */
+#define SPI_SEG_CS_TOGGLE		(1 << 0)	//pause after this segment and send SPI_EVENT_SEG_CMPLT (spi_bus toggles chip select)
+#define SPI_SEG_DFF_8			(1 << 1)	//8-bit frames in this segment, neither DFF flag -> SPI_config.SPI_DFF
+#define SPI_SEG_DFF_16			(1 << 2)	//16-bit frames in this segment
+
 /*
  * SPI peripheral states
  */
 #define SPI_STATE_READY		0
 #define SPI_STATE_BUSY_IN_RX		1
 #define SPI_STATE_BUSY_IN_TX		2
+#define SPI_STATE_ERR			3		//returned by the DMA functions, no DMA set up or bad length, nothing started
 
 /*
  * possible SPI application events
@@ -104,6 +152,8 @@ typedef struct
 #define SPI_EVENT_TX_CMPLT		0
 #define SPI_EVENT_RX_CMPLT		1
 #define SPI_EVENT_OVR_ERR		2
+#define SPI_EVENT_DMA_ERR		3		//DMA transfer error, the transfer was stopped
+#define SPI_EVENT_SEG_CMPLT		4		//scatter-gather pause after segment Rx_seg, the transfer goes on when the callback returns
 
 
 /**************************APIs**************************/
@@ -127,12 +177,24 @@ void SPI_deinit(SPI_reg_t *p_SPIx);
  */
 void SPI_send(SPI_reg_t *p_SPIx, uint8_t *p_Tx_buffer, uint32_t len);
 void SPI_recieve(SPI_reg_t *p_SPIx, uint8_t *p_Rx_buffer, uint32_t len);
+void SPI_transfer(SPI_reg_t *p_SPIx, uint8_t *p_Tx_buffer, uint8_t *p_Rx_buffer, uint32_t len);
 
 /*
  * interrupt based send and receive
  */
 uint8_t SPI_send_IT(SPI_Handle_t *p_SPI_Handle, uint8_t *p_Tx_buffer, uint32_t len);
 uint8_t SPI_recieve_IT(SPI_Handle_t *p_SPI_Handle, uint8_t *p_Rx_buffer, uint32_t len);
+uint8_t SPI_transfer_IT(SPI_Handle_t *p_SPI_Handle, uint8_t *p_Tx_buffer, uint8_t *p_Rx_buffer, uint32_t len);
+uint8_t SPI_transfer_sg_IT(SPI_Handle_t *p_SPI_Handle, const SPI_segment_t *p_seg, uint8_t seg_count);
+
+/*
+ * DMA based send and receive
+ */
+void SPI_DMA_init(SPI_Handle_t *p_SPI_Handle, DMA_Handle_t *p_Tx_DMA, DMA_Handle_t *p_Rx_DMA);
+uint8_t SPI_send_DMA(SPI_Handle_t *p_SPI_Handle, uint8_t *p_Tx_buffer, uint32_t len);
+uint8_t SPI_receive_DMA(SPI_Handle_t *p_SPI_Handle, uint8_t *p_Rx_buffer, uint32_t len);
+uint8_t SPI_transfer_DMA(SPI_Handle_t *p_SPI_Handle, uint8_t *p_Tx_buffer, uint8_t *p_Rx_buffer, uint32_t len);
+uint8_t SPI_transfer_sg_DMA(SPI_Handle_t *p_SPI_Handle, const SPI_segment_t *p_seg, uint8_t seg_count);
 
 /*
  * IQR configuration and handling
@@ -25,6 +25,10 @@
 
 #define NVIC_IPR_BASEADDR 		(volatile uint32_t*)0xE000E400
 
+//short critical sections shared with interrupt handlers, state is a uint32_t holding the old PRIMASK
+#define IRQ_SAVE_DISABLE(state)	do{ __asm volatile("MRS %0, PRIMASK\n\tCPSID i" : "=r"(state) : : "memory"); }while(0)
+#define IRQ_RESTORE(state)		do{ __asm volatile("MSR PRIMASK, %0" : : "r"(state) : "memory"); }while(0)
+
 
 
 //base address of FLASH and SRAM
@@ -55,8 +59,14 @@
 #define GPIOH_BASEADDR 	(AHB1_BASEADDR + 0xC000)
 
 #define RCC_BASEADDR 	(AHB1_BASEADDR + 0x3800)
+#define FLASH_INTF_BASEADDR	(AHB1_BASEADDR + 0x3C00)
+
+#define DMA1_BASEADDR	(AHB1_BASEADDR + 0x6000)
+#define DMA2_BASEADDR	(AHB1_BASEADDR + 0x6400)
 
 //base address of peripherals on APB1
+#define PWR_BASEADDR	(APB1_BASEADDR + 0x7000)
+
 #define SPI2_BASEADDR	(APB1_BASEADDR + 0x3800)
 #define SPI3_BASEADDR 	(APB1_BASEADDR + 0x3C00)
 
@@ -172,6 +182,30 @@ typedef struct
 #define USART6	((USART_reg_t*)USART6_BASEADDR)
 
 
+//DMA stream register structure, 8 of them follow the DMA interrupt registers 0x18 bytes apart
+typedef struct
+{
+	volatile uint32_t CR;		//DMA stream x configuration register
+	volatile uint32_t NDTR;		//DMA stream x number of data register
+	volatile uint32_t PAR;		//DMA stream x peripheral address register
+	volatile uint32_t M0AR;		//DMA stream x memory 0 address register
+	volatile uint32_t M1AR;		//DMA stream x memory 1 address register
+	volatile uint32_t FCR;		//DMA stream x FIFO control register
+}DMA_stream_reg_t;
+
+//DMA register structure
+typedef struct
+{
+	volatile uint32_t LISR;		//DMA low interrupt status register (streams 0-3)
+	volatile uint32_t HISR;		//DMA high interrupt status register (streams 4-7)
+	volatile uint32_t LIFCR;	//DMA low interrupt flag clear register
+	volatile uint32_t HIFCR;	//DMA high interrupt flag clear register
+	DMA_stream_reg_t S[8];		//stream 0-7 registers
+}DMA_reg_t;
+
+#define DMA1	((DMA_reg_t*)DMA1_BASEADDR)
+#define DMA2	((DMA_reg_t*)DMA2_BASEADDR)
+
 //RCC register structure
 typedef struct
 {
@@ -213,6 +247,28 @@ typedef struct
 
 #define RCC ((RCC_reg_t*) RCC_BASEADDR)
 
+//FLASH interface register structure
+typedef struct
+{
+	volatile uint32_t ACR;			//Flash access control register
+	volatile uint32_t KEYR;			//Flash key register
+	volatile uint32_t OPTKEYR;		//Flash option key register
+	volatile uint32_t SR;			//Flash status register
+	volatile uint32_t CR;			//Flash control register
+	volatile uint32_t OPTCR;		//Flash option control register
+}FLASH_reg_t;
+
+#define FLASH_INTF ((FLASH_reg_t*) FLASH_INTF_BASEADDR)
+
+//PWR register structure
+typedef struct
+{
+	volatile uint32_t CR;			//PWR power control register
+	volatile uint32_t CSR;			//PWR power control/status register
+}PWR_reg_t;
+
+#define PWR ((PWR_reg_t*) PWR_BASEADDR)
+
 //EXTI register structure
 typedef struct
 {
@@ -249,6 +305,12 @@ typedef struct
 #define GPIOG_PCLK_EN() ( RCC->AHB1ENR |= (1 << 6) )
 #define GPIOH_PCLK_EN() ( RCC->AHB1ENR |= (1 << 7) )
 
+/*
+ * clock enable macros for DMA controllers
+ */
+#define DMA1_PCLK_EN()	( RCC->AHB1ENR |= (1 << 21) )
+#define DMA2_PCLK_EN()	( RCC->AHB1ENR |= (1 << 22) )
+
 /*
  * clock enable macros for I2C peripherals
  */
@@ -279,6 +341,11 @@ typedef struct
  */
 #define SYSCFG_PCLK_EN()	( RCC->APB2ENR |= (1 << 14) )
 
+/*
+ * clock enable macros for PWR
+ */
+#define PWR_PCLK_EN()		( RCC->APB1ENR |= (1 << 28) )
+
 /*
  * clock disable macros for GPIO peripherals
  */
@@ -291,6 +358,12 @@ typedef struct
 #define GPIOG_PCLK_DI() ( RCC->AHB1ENR &= ~(1 << 6) )
 #define GPIOH_PCLK_DI() ( RCC->AHB1ENR &= ~(1 << 7) )
 
+/*
+ * clock disable macros for DMA controllers
+ */
+#define DMA1_PCLK_DI()	( RCC->AHB1ENR &= ~(1 << 21) )
+#define DMA2_PCLK_DI()	( RCC->AHB1ENR &= ~(1 << 22) )
+
 /*
  * clock disable macros for I2C peripherals
  */
@@ -329,6 +402,12 @@ typedef struct
 #define GPIOG_REG_RESET()		do{ RCC->AHB1RSTR |= (1 << 6); RCC->AHB1RSTR &= ~(1 << 6);}while(0)
 #define GPIOH_REG_RESET()		do{ RCC->AHB1RSTR |= (1 << 7); RCC->AHB1RSTR &= ~(1 << 7);}while(0)
 
+/*
+ * macros to reset DMA controller registers
+ */
+#define DMA1_REG_RESET()		do{ RCC->AHB1RSTR |= (1 << 21); RCC->AHB1RSTR &= ~(1 << 21);}while(0)
+#define DMA2_REG_RESET()		do{ RCC->AHB1RSTR |= (1 << 22); RCC->AHB1RSTR &= ~(1 << 22);}while(0)
+
 /*
  * macros to reset SPI peripheral registers
  */
@@ -366,7 +445,7 @@ typedef struct
 									(x == GPIOG) ? 6 :\
 									(x == GPIOH) ? 7 :0 )
 /*
- * IRQ numbers for GPIO, SPI, I2C and USART interrupts
+ * IRQ numbers for GPIO, SPI, I2C, USART and DMA interrupts
  */
 #define IRQ_NO_EXTI0		6
 #define IRQ_NO_EXTI1    	7
@@ -388,6 +467,30 @@ typedef struct
 #define IRQ_NO_I2C3_EV		72
 #define IRQ_NO_I2C3_ER		73
 
+#define IRQ_NO_USART1		37
+#define IRQ_NO_USART2		38
+#define IRQ_NO_USART3		39
+#define IRQ_NO_UART4		52
+#define IRQ_NO_UART5		53
+#define IRQ_NO_USART6		71
+
+#define IRQ_NO_DMA1_STREAM0	11
+#define IRQ_NO_DMA1_STREAM1	12
+#define IRQ_NO_DMA1_STREAM2	13
+#define IRQ_NO_DMA1_STREAM3	14
+#define IRQ_NO_DMA1_STREAM4	15
+#define IRQ_NO_DMA1_STREAM5	16
+#define IRQ_NO_DMA1_STREAM6	17
+#define IRQ_NO_DMA1_STREAM7	47
+#define IRQ_NO_DMA2_STREAM0	56
+#define IRQ_NO_DMA2_STREAM1	57
+#define IRQ_NO_DMA2_STREAM2	58
+#define IRQ_NO_DMA2_STREAM3	59
+#define IRQ_NO_DMA2_STREAM4	60
+#define IRQ_NO_DMA2_STREAM5	68
+#define IRQ_NO_DMA2_STREAM6	69
+#define IRQ_NO_DMA2_STREAM7	70
+
 
 /*
  * bit position macros for SPI registers
@@ -490,6 +593,60 @@ typedef struct
 #define I2C_CCR_DUTY		14
 #define I2C_CCR_FS			15
 
+/*
+ * bit position macros for RCC registers
+ */
+
+//CR
+#define RCC_CR_HSION		0
+#define RCC_CR_HSIRDY		1
+#define RCC_CR_HSEON		16
+#define RCC_CR_HSERDY		17
+#define RCC_CR_HSEBYP		18
+#define RCC_CR_PLLON		24
+#define RCC_CR_PLLRDY		25
+
+//PLLCFGR
+#define RCC_PLLCFGR_PLLM	0
+#define RCC_PLLCFGR_PLLN	6
+#define RCC_PLLCFGR_PLLP	16
+#define RCC_PLLCFGR_PLLSRC	22
+#define RCC_PLLCFGR_PLLQ	24
+#define RCC_PLLCFGR_PLLR	28
+
+//CFGR
+#define RCC_CFGR_SW			0
+#define RCC_CFGR_SWS		2
+#define RCC_CFGR_HPRE		4
+#define RCC_CFGR_PPRE1		10
+#define RCC_CFGR_PPRE2		13
+
+/*
+ * bit position macros for FLASH interface registers
+ */
+
+//ACR
+#define FLASH_ACR_LATENCY	0
+#define FLASH_ACR_PRFTEN	8
+#define FLASH_ACR_ICEN		9
+#define FLASH_ACR_DCEN		10
+#define FLASH_ACR_ICRST		11
+#define FLASH_ACR_DCRST		12
+
+/*
+ * bit position macros for PWR registers
+ */
+
+//CR
+#define PWR_CR_VOS			14
+#define PWR_CR_ODEN			16
+#define PWR_CR_ODSWEN		17
+
+//CSR
+#define PWR_CSR_VOSRDY		14
+#define PWR_CSR_ODRDY		16
+#define PWR_CSR_ODSWRDY		17
+
 /*
  * bit pposition macros for USART registers
  */
@@ -554,6 +711,44 @@ typedef struct
 
 
 
+/*
+ * bit position macros for DMA registers
+ */
+
+//SxCR
+#define DMA_SxCR_EN			0
+#define DMA_SxCR_DMEIE		1
+#define DMA_SxCR_TEIE		2
+#define DMA_SxCR_HTIE		3
+#define DMA_SxCR_TCIE		4
+#define DMA_SxCR_PFCTRL		5
+#define DMA_SxCR_DIR		6
+#define DMA_SxCR_CIRC		8
+#define DMA_SxCR_PINC		9
+#define DMA_SxCR_MINC		10
+#define DMA_SxCR_PSIZE		11
+#define DMA_SxCR_MSIZE		13
+#define DMA_SxCR_PINCOS		15
+#define DMA_SxCR_PL			16
+#define DMA_SxCR_DBM		18
+#define DMA_SxCR_CT			19
+#define DMA_SxCR_PBURST		21
+#define DMA_SxCR_MBURST		23
+#define DMA_SxCR_CHSEL		25
+
+//SxFCR
+#define DMA_SxFCR_FTH		0
+#define DMA_SxFCR_DMDIS		2
+#define DMA_SxFCR_FS		3
+#define DMA_SxFCR_FEIE		7
+
+//LISR/HISR flags, relative to the first bit of the stream (0, 6, 16, 22 for stream 0-3 and 4-7)
+#define DMA_ISR_FEIF		0
+#define DMA_ISR_DMEIF		2
+#define DMA_ISR_TEIF		3
+#define DMA_ISR_HTIF		4
+#define DMA_ISR_TCIF		5
+
 //some generic macros
 #define ENABLE 		1
 #define DISABLE 	0
@@ -563,4 +758,7 @@ typedef struct
 #define READ 		1
 #define WRITE		0
 
+//place a variable in .noinit so it is not zeroed at startup (large DMA buffers don't need clearing)
+#define NOINIT		__attribute__((section(".noinit")))
+
 #endif /* DRIVERS_STM32F446XX_H_ */
@@ -7,6 +7,18 @@
 
 #include "USART_driver.h"
 
+static void USART_set_baud_rate(USART_Handle_t *p_USART_Handle);
+static void USART_DMA_config(USART_Handle_t *p_USART_Handle, DMA_Handle_t *p_DMA_Handle, uint8_t direction);
+static void USART_DMA_Rx_callback(uint8_t event, void *p_context);
+static void USART_DMA_Rx_process(USART_Handle_t *p_USART_Handle);
+static void USART_DMA_Tx_callback(uint8_t event, void *p_context);
+static void USART_DMA_Tx_next(USART_Handle_t *p_USART_Handle);
+static void USART_FIFO_Tx(USART_Handle_t *p_USART_Handle);
+static void USART_FIFO_Rx(USART_Handle_t *p_USART_Handle);
+static uint32_t USART_FIFO_count(uint32_t head, uint32_t tail, uint32_t size);
+static uint32_t USART_frame_bytes(USART_Handle_t *p_USART_Handle);
+static void USART_clk_change_abort(USART_Handle_t *p_USART_Handle);
+
 /*
  * @func:			USART_clock_control
  *
@@ -192,54 +204,7 @@ void USART_init(USART_Handle_t *p_USART_Handle)
 	/*
 	 * configure BRR(baud rate)
 	 */
-	uint32_t brr_val = 0;
-
-	uint32_t pclkx_val, usartdiv, M_part,F_part;
-	if(p_USART_Handle->p_USARTx == USART1 || p_USART_Handle->p_USARTx == USART6)
-	{
-		//USART1 and USART6 are on APB2 bus
-		pclkx_val = RCC_get_pclk2();
-	}
-	else
-	{
-		//USART2, USART3, UART4, UART5 are on APB1 bus
-		pclkx_val = RCC_get_pclk1();
-	}
-
-	//check for OVER8 configuration
-	uint8_t over8_config = ( (p_USART_Handle->p_USARTx->CR1 >> USART_CR1_OVER8) & 1 );
-	if(over8_config)
-	{
-		//over sampling by 8
-		usartdiv = 100 * (pclkx_val) / (8 * p_USART_Handle->USARTx_config.USART_baud);
-	}
-	else
-	{
-		//over sampling by 16
-		usartdiv = 100 * (pclkx_val) / (16 * p_USART_Handle->USARTx_config.USART_baud);
-	}
-
-	//configure matissa part of BRR
-	M_part = usartdiv / 100;
-	brr_val |= M_part << 4;
-
-	//calculate fraction part of BRR
-	F_part = usartdiv % 100;
-	if(over8_config)
-	{
-		//over sampling by 8
-		F_part = ( ((F_part * 8) + 50) / 100 ) & ((uint8_t)0x07);	//0x07 b/c for OVER8=1, the [3] bit is not considered and must be kept cleared
-	}
-	else
-	{
-		//over sampling by 16
-		F_part = ( ((F_part * 16) + 50) / 100 ) & ((uint8_t)0x0F);
-	}
-	brr_val |= F_part;
-
-	p_USART_Handle->p_USARTx->BRR = brr_val;
-
-
+	USART_set_baud_rate(p_USART_Handle);
 }
 
 /*
@@ -446,6 +411,342 @@ uint8_t USART_receive_IT(USART_Handle_t *p_USART_Handle, uint8_t *p_Rx_buffer, u
 	return rx_state;
 }
 
+/*
+ * @func:				USART_DMA_init
+ *
+ * @brief:				This function sets up the DMA streams of the given USART peripheral
+ *
+ * @param[in]:			address of the Handle structure of the USART peripheral, after USART_init
+ * @param[in]:			address of the DMA Handle for transmit, NULL -> no DMA transmit
+ * @param[in]:			address of the DMA Handle for receive, NULL -> no DMA receive
+ *
+ * @return: 			none
+ *
+ * @note:				a DMA Handle with p_DMAx NULL gets the default stream and channel of the USART peripheral:
+ * 						USART1 DMA2 Tx stream 7 ch 4, Rx stream 5 ch 4	USART2 DMA1 Tx stream 6 ch 4, Rx stream 5 ch 4
+ * 						USART3 DMA1 Tx stream 3 ch 4, Rx stream 1 ch 4	UART4 DMA1 Tx stream 4 ch 4, Rx stream 2 ch 4
+ * 						UART5 DMA1 Tx stream 7 ch 4, Rx stream 0 ch 4	USART6 DMA2 Tx stream 6 ch 5, Rx stream 1 ch 5
+ * 						DMA1 has too few streams for every default, these share a stream with the SPI defaults:
+ * 						USART3 Tx DMA1 stream 3 = SPI2 Rx				UART4 Tx DMA1 stream 4 = SPI2 Tx
+ * 						UART5 Tx DMA1 stream 7 = SPI3 Tx				UART5 Rx DMA1 stream 0 = SPI3 Rx
+ * 						(the only other USART3 Tx stream, DMA1 stream 4 ch 7, is SPI2 Tx too, UART4/UART5 have no other)
+ * 						using both defaults of a pair steals the stream, give one of them its own p_DMAx/stream
+ * 						a Handle with p_DMAx set keeps its stream, channel and priority, the rest is set here
+ * 						the application enables the stream IRQ and calls DMA_IRQ_handler from the stream's IRQ handler
+ */
+void USART_DMA_init(USART_Handle_t *p_USART_Handle, DMA_Handle_t *p_Tx_DMA, DMA_Handle_t *p_Rx_DMA)
+{
+	p_USART_Handle->p_Tx_DMA = p_Tx_DMA;
+	p_USART_Handle->p_Rx_DMA = p_Rx_DMA;
+
+	if(p_Tx_DMA != NULL)
+	{
+		USART_DMA_config(p_USART_Handle, p_Tx_DMA, DMA_DIR_MEM_TO_PERIPH);
+		p_Tx_DMA->p_callback = USART_DMA_Tx_callback;
+		DMA_init(p_Tx_DMA);
+	}
+	if(p_Rx_DMA != NULL)
+	{
+		USART_DMA_config(p_USART_Handle, p_Rx_DMA, DMA_DIR_PERIPH_TO_MEM);
+		p_Rx_DMA->p_callback = USART_DMA_Rx_callback;
+		DMA_init(p_Rx_DMA);
+	}
+}
+
+/*
+ * @func:				USART_receive_DMA
+ *
+ * @brief:				This function starts continuous reception by DMA into a circular buffer
+ *
+ * @param[in]:			address of the Handle structure, set up with USART_DMA_init
+ * @param[in]:			address of the circular buffer
+ * @param[in]:			size of the buffer in bytes, a whole number of frames, 1 to 65535 frames
+ *
+ * @return: 			the Rx state before the call, USART_STATE_BUSY_RX -> nothing was started, or USART_STATE_ERR (no Rx
+ * 						stream, len 0, over 65535 frames or not a whole number of frames) without starting anything
+ *
+ * @note:				the reception never ends, new data is reported with USART_EV_RX_DATA when the line goes idle
+ * 						after a packet and when the buffer is half and completely full, p_Rx_data and Rx_data_len in
+ * 						the Handle point into the buffer (no copy), a wrap is reported as two regions
+ * 						the data has to be used before the DMA comes around to it again, size the buffer for that
+ * 						with parity enabled the parity bit is in the data (bit 7 for 8-bit words), mask it
+ * 						the USART IRQ and the Rx stream IRQ should have the same priority
+ */
+uint8_t USART_receive_DMA(USART_Handle_t *p_USART_Handle, uint8_t *p_Rx_buffer, uint32_t len)
+{
+	uint8_t rx_state = p_USART_Handle->Rx_state;
+	uint32_t unit, frames;
+
+	if(p_USART_Handle->p_Rx_DMA == NULL)
+	{
+		return USART_STATE_ERR;
+	}
+	unit = (p_USART_Handle->p_Rx_DMA->DMA_config.DMA_periph_size == DMA_SIZE_HALF_WORD) ? 2 : 1;
+	frames = len / unit;
+
+	//NDTR is 16 bits and counts frames, the ring has to be exactly what the stream cycles through
+	if( (frames == 0) || (frames > 0xFFFFU) || (len % unit) )
+	{
+		return USART_STATE_ERR;
+	}
+
+	if(rx_state == USART_STATE_READY)
+	{
+		p_USART_Handle->p_Rx_buffer = p_Rx_buffer;
+		//ring size in bytes as programmed into NDTR, USART_DMA_Rx_process computes the head from it
+		p_USART_Handle->Rx_len = frames * unit;
+		p_USART_Handle->Rx_DMA_pos = 0;
+		p_USART_Handle->Rx_state = USART_STATE_BUSY_RX;
+
+		DMA_start_IT(p_USART_Handle->p_Rx_DMA, (uint32_t)&p_USART_Handle->p_USARTx->DR, (uint32_t)p_Rx_buffer,
+				(uint16_t)frames);
+
+		//DMAR makes RXNE raise the DMA request, EIE reports an overrun since RXNEIE is not used
+		p_USART_Handle->p_USARTx->CR3 |= (1 << USART_CR3_DMAR) | (1 << USART_CR3_EIE);
+
+		//enable IDLEIE (idle line interrupt), marks the end of a packet
+		p_USART_Handle->p_USARTx->CR1 |= (1 << USART_CR1_IDLEIE);
+	}
+
+	return rx_state;
+}
+
+/*
+ * @func:				USART_stop_receive_DMA
+ *
+ * @brief:				This function stops the reception started by USART_receive_DMA
+ *
+ * @param[in]:			address of the Handle structure
+ *
+ * @return: 			none
+ *
+ * @note:				data received since the last USART_EV_RX_DATA is reported before the stream is stopped
+ */
+void USART_stop_receive_DMA(USART_Handle_t *p_USART_Handle)
+{
+	if(p_USART_Handle->p_USARTx->CR3 & (1 << USART_CR3_DMAR))
+	{
+		p_USART_Handle->p_USARTx->CR1 &= ~(1 << USART_CR1_IDLEIE);
+		p_USART_Handle->p_USARTx->CR3 &= ~( (1 << USART_CR3_DMAR) | (1 << USART_CR3_EIE) );
+		DMA_stop(p_USART_Handle->p_Rx_DMA);
+		USART_DMA_Rx_process(p_USART_Handle);
+
+		p_USART_Handle->p_Rx_buffer = NULL;
+		p_USART_Handle->Rx_len = 0;
+		p_USART_Handle->Rx_state = USART_STATE_READY;
+	}
+}
+
+/*
+ * @func:				USART_send_DMA
+ *
+ * @brief:				This function queues a message for transmission by DMA, queued messages are sent back to back
+ *
+ * @param[in]:			address of the Handle structure, set up with USART_DMA_init
+ * @param[in]:			address of the data to send, it must stay valid until USART_EV_TX_DONE reports it
+ * @param[in]:			length of data to send in bytes
+ * @param[in]:			application pointer handed back in Tx_done, e.g. the buffer to free
+ *
+ * @return: 			1 -> queued, 0 -> the queue is full (or there is no Tx stream, or len is below one frame) and the
+ * 						buffer still belongs to the caller
+ *
+ * @note:				callable from several tasks and from interrupt handlers, it never waits
+ * 						the next message is started from the DMA transfer complete interrupt, the USART does not
+ * 						stop between messages, then USART_EV_TX_DONE reports the finished one
+ * 						Tx_state is USART_STATE_BUSY_TX while the queue is not empty, USART_send_IT returns busy
+ * 						with 9 data bits and no parity every frame takes two bytes, len should be even
+ */
+uint8_t USART_send_DMA(USART_Handle_t *p_USART_Handle, const uint8_t *p_data, uint32_t len, void *p_tag)
+{
+	uint32_t primask;
+	uint8_t queued = 0;
+	USART_Tx_desc_t *p_desc;
+	uint32_t unit;
+
+	//a Handle without USART_DMA_init Tx has no stream to look at
+	if( (p_USART_Handle->p_Tx_DMA == NULL) || (len == 0) )
+	{
+		return 0;
+	}
+	unit = (p_USART_Handle->p_Tx_DMA->DMA_config.DMA_periph_size == DMA_SIZE_HALF_WORD) ? 2 : 1;
+
+	IRQ_SAVE_DISABLE(primask);
+
+	if( (len >= unit) && (p_USART_Handle->Tx_q_count < USART_TX_QUEUE_LEN) &&
+			( (p_USART_Handle->Tx_q_count > 0) || (p_USART_Handle->Tx_state == USART_STATE_READY) ) )
+	{
+		p_desc = &p_USART_Handle->Tx_queue[(p_USART_Handle->Tx_q_head + p_USART_Handle->Tx_q_count) % USART_TX_QUEUE_LEN];
+		p_desc->p_data = p_data;
+		p_desc->len = len;
+		p_desc->p_tag = p_tag;
+		p_USART_Handle->Tx_q_count++;
+		queued = 1;
+
+		//queue was empty, start the DMA
+		if(p_USART_Handle->Tx_q_count == 1)
+		{
+			p_USART_Handle->Tx_state = USART_STATE_BUSY_TX;
+			p_USART_Handle->Tx_q_sent = 0;
+			USART_DMA_Tx_next(p_USART_Handle);
+		}
+	}
+
+	IRQ_RESTORE(primask);
+
+	return queued;
+}
+
+/*
+ * @func:				USART_get_Tx_queue_free
+ *
+ * @brief:				This function returns how many more messages USART_send_DMA can queue
+ *
+ * @param[in]:			address of the Handle structure
+ *
+ * @return: 			number of free queue entries
+ *
+ * @note:				none
+ */
+uint8_t USART_get_Tx_queue_free(USART_Handle_t *p_USART_Handle)
+{
+	return USART_TX_QUEUE_LEN - p_USART_Handle->Tx_q_count;
+}
+
+/*
+ * @func:				USART_FIFO_init
+ *
+ * @brief:				This function sets up the software FIFOs of the given USART and starts the reception into the Rx FIFO
+ *
+ * @param[in]:			address of the Handle structure of the USART peripheral, after USART_init
+ * @param[in]:			address of the Tx FIFO storage, NULL -> no Tx FIFO
+ * @param[in]:			size of the Tx FIFO in bytes, it holds size - 1 bytes
+ * @param[in]:			address of the Rx FIFO storage, NULL -> no Rx FIFO
+ * @param[in]:			size of the Rx FIFO in bytes, it holds size - 1 bytes
+ *
+ * @return: 			none
+ *
+ * @note:				RXNE stays enabled, every received frame goes to the Rx FIFO until USART_close_receive, TXE is only
+ * 						enabled while the Tx FIFO has data, so sending and receiving never wait for each other
+ * 						the FIFOs take the place of USART_send_IT/USART_receive_IT, the application enables the USART IRQ
+ * 						with 9 data bits and no parity a frame takes two bytes (low byte first) in the FIFOs
+ */
+void USART_FIFO_init(USART_Handle_t *p_USART_Handle, uint8_t *p_Tx_fifo, uint32_t Tx_size, uint8_t *p_Rx_fifo, uint32_t Rx_size)
+{
+	p_USART_Handle->p_Tx_fifo = p_Tx_fifo;
+	p_USART_Handle->Tx_fifo_size = Tx_size;
+	p_USART_Handle->Tx_fifo_head = 0;
+	p_USART_Handle->Tx_fifo_tail = 0;
+
+	p_USART_Handle->p_Rx_fifo = p_Rx_fifo;
+	p_USART_Handle->Rx_fifo_size = Rx_size;
+	p_USART_Handle->Rx_fifo_head = 0;
+	p_USART_Handle->Rx_fifo_tail = 0;
+
+	if(p_Rx_fifo != NULL)
+	{
+		p_USART_Handle->p_USARTx->CR1 |= (1 << USART_CR1_RXNEIE);
+	}
+}
+
+/*
+ * @func:				USART_write
+ *
+ * @brief:				This function copies data into the Tx FIFO and starts sending it
+ *
+ * @param[in]:			address of the Handle structure of the USART peripheral, set up with USART_FIFO_init
+ * @param[in]:			address of the data to send
+ * @param[in]:			length of data to send
+ *
+ * @return: 			number of bytes taken, less than len when the Tx FIFO is full, whole frames only
+ *
+ * @note:				this is a non-blocking call, one writer per USART (task or interrupt)
+ */
+uint32_t USART_write(USART_Handle_t *p_USART_Handle, const uint8_t *p_data, uint32_t len)
+{
+	uint32_t size = p_USART_Handle->Tx_fifo_size;
+	uint32_t head = p_USART_Handle->Tx_fifo_head;
+	uint32_t unit = USART_frame_bytes(p_USART_Handle);
+	uint32_t space;
+	uint32_t primask;
+
+	//no Tx FIFO set up, size - 1 would wrap
+	if( (p_USART_Handle->p_Tx_fifo == NULL) || (size == 0) )
+	{
+		return 0;
+	}
+	space = size - 1 - USART_FIFO_count(head, p_USART_Handle->Tx_fifo_tail, size);
+
+	if(len > space)
+	{
+		len = space;
+	}
+	len -= len % unit;
+
+	for(uint32_t i = 0; i < len; i++)
+	{
+		p_USART_Handle->p_Tx_fifo[head] = p_data[i];
+		head = (head + 1 == size) ? 0 : (head + 1);
+	}
+
+	if(len > 0)
+	{
+		//publish the data before TXE is enabled, the interrupt disables TXEIE when it finds the FIFO empty
+		//the compiler must not move the FIFO stores after the head update
+		__asm volatile("" ::: "memory");
+		p_USART_Handle->Tx_fifo_head = head;
+
+		IRQ_SAVE_DISABLE(primask);
+		p_USART_Handle->p_USARTx->CR1 |= (1 << USART_CR1_TXEIE);
+		IRQ_RESTORE(primask);
+	}
+
+	return len;
+}
+
+/*
+ * @func:				USART_read
+ *
+ * @brief:				This function takes received data out of the Rx FIFO
+ *
+ * @param[in]:			address of the Handle structure of the USART peripheral, set up with USART_FIFO_init
+ * @param[in]:			address of the buffer for the data
+ * @param[in]:			size of the buffer
+ *
+ * @return: 			number of bytes copied, 0 -> nothing received, whole frames only
+ *
+ * @note:				this is a non-blocking call, one reader per USART (task or interrupt)
+ */
+uint32_t USART_read(USART_Handle_t *p_USART_Handle, uint8_t *p_data, uint32_t len)
+{
+	uint32_t size = p_USART_Handle->Rx_fifo_size;
+	uint32_t tail = p_USART_Handle->Rx_fifo_tail;
+	uint32_t count;
+
+	if( (p_USART_Handle->p_Rx_fifo == NULL) || (size == 0) )
+	{
+		return 0;
+	}
+	count = USART_FIFO_count(p_USART_Handle->Rx_fifo_head, tail, size);
+
+	if(len > count)
+	{
+		len = count;
+	}
+	len -= len % USART_frame_bytes(p_USART_Handle);
+
+	for(uint32_t i = 0; i < len; i++)
+	{
+		p_data[i] = p_USART_Handle->p_Rx_fifo[tail];
+		tail = (tail + 1 == size) ? 0 : (tail + 1);
+	}
+
+	//the FIFO loads must be done before the interrupt may reuse the bytes
+	__asm volatile("" ::: "memory");
+	p_USART_Handle->Rx_fifo_tail = tail;
+
+	return len;
+}
+
 /*
  * @func:				USART_IRQ_config
  *
@@ -544,13 +845,8 @@ void USART_IRQ_handling(USART_Handle_t *p_USART_Handle)
 			//clear TC flag
 			p_USART_Handle->p_USARTx->SR &= ~(1 << USART_SR_TC);
 
-			//close TCIE(tranmission complete interrupt)
-			p_USART_Handle->p_USARTx->CR1 &= ~(1 << USART_CR1_TCIE);
-
-			//reset USART Handle tx variables
-			p_USART_Handle->Tx_state = USART_STATE_READY;
-			p_USART_Handle->p_Tx_buffer = NULL;
-			p_USART_Handle->Tx_len = 0;
+			//close TCIE(tranmission complete interrupt) and reset USART Handle tx variables
+			USART_close_send(p_USART_Handle);
 
 			//notify user application
 			USART_event_callback(p_USART_Handle, USART_EV_TX_CMPLT);
@@ -614,6 +910,11 @@ void USART_IRQ_handling(USART_Handle_t *p_USART_Handle)
 				p_USART_Handle->p_USARTx->CR1 &= ~(1 <<  USART_CR1_TXEIE);
 			}
 		}
+		else if(p_USART_Handle->p_Tx_fifo != NULL)
+		{
+			//USART_write data
+			USART_FIFO_Tx(p_USART_Handle);
+		}
 	}
 
 	/*
@@ -666,13 +967,17 @@ void USART_IRQ_handling(USART_Handle_t *p_USART_Handle)
 				if(p_USART_Handle->Rx_len == 0)
 				{
 					//disable RXNE(Rx buffer not empty interrupt)
-					p_USART_Handle->p_USARTx->CR1 &= ~(1 << USART_CR1_RXNEIE);
-					p_USART_Handle->Rx_state = USART_STATE_READY;
+					USART_close_receive(p_USART_Handle);
 					//notify user application
 					USART_event_callback(p_USART_Handle, USART_EV_RX_CMPLT);
 				}
 			}
 		}
+		else if(p_USART_Handle->p_Rx_fifo != NULL)
+		{
+			//continuous reception into the Rx FIFO
+			USART_FIFO_Rx(p_USART_Handle);
+		}
 	}
 
 	/*
@@ -706,6 +1011,12 @@ void USART_IRQ_handling(USART_Handle_t *p_USART_Handle)
 		dummy_byte = p_USART_Handle->p_USARTx->SR;
 		dummy_byte = p_USART_Handle->p_USARTx->DR;
 
+		//report what the DMA received up to the idle line first, so the packet is complete at USART_EV_IDLE
+		if(p_USART_Handle->p_USARTx->CR3 & (1 << USART_CR3_DMAR))
+		{
+			USART_DMA_Rx_process(p_USART_Handle);
+		}
+
 		//notify user application
 		USART_event_callback(p_USART_Handle, USART_EV_IDLE);
 	}
@@ -714,7 +1025,7 @@ void USART_IRQ_handling(USART_Handle_t *p_USART_Handle)
 	 * check for ORE flag
 	 */
 	temp1 = (p_USART_Handle->p_USARTx->SR >> USART_SR_ORE) & 1;
-	temp2 = (p_USART_Handle->p_USARTx->CR1 >> USART_CR1_RXNEIE) & 1;
+	temp2 = ((p_USART_Handle->p_USARTx->CR1 >> USART_CR1_RXNEIE) & 1) | ((p_USART_Handle->p_USARTx->CR3 >> USART_CR3_DMAR) & 1);
 	if(temp1 && temp2)
 	{
 		//the interrupt is caused by ORE
@@ -799,3 +1110,504 @@ uint8_t USART_get_flag_status(USART_reg_t *p_USARTx, uint8_t flag_bit)
 {
 	return ( (p_USARTx->SR >> flag_bit) & 1 );
 }
+
+/*
+ * @func:				USART_close_send
+ *
+ * @brief:				This function stops an interrupt based send and resets the Tx variables of the Handle
+ *
+ * @param[in]:			address of the Handle structure of the USART peripheral
+ *
+ * @return: 			none
+ *
+ * @note:				data in the Tx FIFO is kept, the next USART_write starts sending it again
+ */
+void USART_close_send(USART_Handle_t *p_USART_Handle)
+{
+	//disable TXEIE and TCIE
+	p_USART_Handle->p_USARTx->CR1 &= ~( (1 << USART_CR1_TXEIE) | (1 << USART_CR1_TCIE) );
+
+	p_USART_Handle->Tx_state = USART_STATE_READY;
+	p_USART_Handle->p_Tx_buffer = NULL;
+	p_USART_Handle->Tx_len = 0;
+}
+
+/*
+ * @func:				USART_close_receive
+ *
+ * @brief:				This function stops an interrupt based receive and resets the Rx variables of the Handle
+ *
+ * @param[in]:			address of the Handle structure of the USART peripheral
+ *
+ * @return: 			none
+ *
+ * @note:				also stops the reception into the Rx FIFO, USART_FIFO_init starts it again
+ */
+void USART_close_receive(USART_Handle_t *p_USART_Handle)
+{
+	//disable RXNEIE
+	p_USART_Handle->p_USARTx->CR1 &= ~(1 << USART_CR1_RXNEIE);
+
+	p_USART_Handle->Rx_state = USART_STATE_READY;
+	p_USART_Handle->p_Rx_buffer = NULL;
+	p_USART_Handle->Rx_len = 0;
+}
+
+/*
+ * @func:				USART_clk_change_handler
+ *
+ * @brief:				This function keeps the baud rate of the given USART correct across a clock change, it should
+ * 						be registered with RCC_register_clk_change(USART_clk_change_handler, &USART_Handle)
+ *
+ * @param[in]:			RCC_CLK_CHANGE_PRE or RCC_CLK_CHANGE_POST
+ * @param[in]:			address of the Handle structure of the USART peripheral
+ *
+ * @return: 			none
+ *
+ * @note:				before the change an interrupt based send is paused and the frame being shifted out is let
+ * 						finish, after the change BRR is recomputed from the new bus clock and the send resumes
+ * 						if TC does not come within USART_CLK_CHANGE_TIMEOUT loops (e.g. CTS held off) the send is
+ * 						closed and USART_ER_TIMEOUT is reported instead of holding up the clock change
+ * 						a frame being received while the clock switches can still be corrupted
+ */
+void USART_clk_change_handler(uint8_t phase, void *p_context)
+{
+	USART_Handle_t *p_USART_Handle = (USART_Handle_t*)p_context;
+	uint32_t tx_IE = (1 << USART_CR1_TXEIE) | (1 << USART_CR1_TCIE);
+	uint32_t i;
+
+	if(phase == RCC_CLK_CHANGE_PRE)
+	{
+		//stop the interrupt handler from starting a new frame at the old baud rate
+		p_USART_Handle->clk_change_IE = p_USART_Handle->p_USARTx->CR1 & tx_IE;
+		p_USART_Handle->p_USARTx->CR1 &= ~tx_IE;
+
+		//same for the DMA, the stream waits for the request until the send resumes
+		p_USART_Handle->clk_change_DMAT = p_USART_Handle->p_USARTx->CR3 & (1 << USART_CR3_DMAT);
+		p_USART_Handle->p_USARTx->CR3 &= ~(1 << USART_CR3_DMAT);
+
+		//wait for the data register and the shift register to be empty
+		if( ((p_USART_Handle->p_USARTx->CR1 >> USART_CR1_UE) & 1) && ((p_USART_Handle->p_USARTx->CR1 >> USART_CR1_TE) & 1) )
+		{
+			for(i = 0; i < USART_CLK_CHANGE_TIMEOUT; i++)
+			{
+				if(USART_get_flag_status(p_USART_Handle->p_USARTx, USART_SR_TC))
+					break;
+			}
+			if(i == USART_CLK_CHANGE_TIMEOUT)
+			{
+				USART_clk_change_abort(p_USART_Handle);
+			}
+		}
+	}
+	else if(phase == RCC_CLK_CHANGE_POST)
+	{
+		USART_set_baud_rate(p_USART_Handle);
+
+		//resume the interrupt based send
+		p_USART_Handle->p_USARTx->CR1 |= p_USART_Handle->clk_change_IE;
+		p_USART_Handle->clk_change_IE = 0;
+		p_USART_Handle->p_USARTx->CR3 |= p_USART_Handle->clk_change_DMAT;
+		p_USART_Handle->clk_change_DMAT = 0;
+	}
+}
+
+/*
+ * private helper functions
+ */
+
+/*
+ * fills the DMA configuration for one direction of the USART, called by USART_DMA_init
+ */
+static void USART_DMA_config(USART_Handle_t *p_USART_Handle, DMA_Handle_t *p_DMA_Handle, uint8_t direction)
+{
+	DMA_config_t *p_config = &p_DMA_Handle->DMA_config;
+	USART_reg_t *p_USARTx = p_USART_Handle->p_USARTx;
+	uint8_t tx = (direction == DMA_DIR_MEM_TO_PERIPH);
+
+	//default request mapping, see USART_DMA_init for the streams shared with the SPI defaults
+	if(p_DMA_Handle->p_DMAx == NULL)
+	{
+		if(p_USARTx == USART1)
+		{
+			p_DMA_Handle->p_DMAx = DMA2;
+			p_config->DMA_stream = tx ? 7 : 5;
+			p_config->DMA_channel = 4;
+		}
+		else if(p_USARTx == USART2)
+		{
+			p_DMA_Handle->p_DMAx = DMA1;
+			p_config->DMA_stream = tx ? 6 : 5;
+			p_config->DMA_channel = 4;
+		}
+		else if(p_USARTx == USART3)
+		{
+			p_DMA_Handle->p_DMAx = DMA1;
+			p_config->DMA_stream = tx ? 3 : 1;
+			p_config->DMA_channel = 4;
+		}
+		else if(p_USARTx == UART4)
+		{
+			p_DMA_Handle->p_DMAx = DMA1;
+			p_config->DMA_stream = tx ? 4 : 2;
+			p_config->DMA_channel = 4;
+		}
+		else if(p_USARTx == UART5)
+		{
+			p_DMA_Handle->p_DMAx = DMA1;
+			p_config->DMA_stream = tx ? 7 : 0;
+			p_config->DMA_channel = 4;
+		}
+		else if(p_USARTx == USART6)
+		{
+			p_DMA_Handle->p_DMAx = DMA2;
+			p_config->DMA_stream = tx ? 6 : 1;
+			p_config->DMA_channel = 5;
+		}
+		p_config->DMA_priority = DMA_PRIORITY_HIGH;
+	}
+
+	//9 data bits without parity move as half words, everything else as bytes
+	p_config->DMA_periph_size = DMA_SIZE_BYTE;
+	if( (p_USART_Handle->USARTx_config.USART_word_len == USART_WORD_LEN_9BITS) &&
+			(p_USART_Handle->USARTx_config.USART_parity == USART_PARITY_DISABLE) )
+	{
+		p_config->DMA_periph_size = DMA_SIZE_HALF_WORD;
+	}
+	p_config->DMA_mem_size = p_config->DMA_periph_size;
+
+	//reception runs forever into a circular buffer
+	p_config->DMA_direction = direction;
+	p_config->DMA_mode = tx ? DMA_MODE_NORMAL : DMA_MODE_CIRCULAR;
+	p_config->DMA_periph_inc = DISABLE;
+	p_config->DMA_mem_inc = ENABLE;
+	p_config->DMA_FIFO_mode = DMA_FIFO_MODE_DIRECT;
+	p_config->DMA_periph_burst = DMA_BURST_SINGLE;
+	p_config->DMA_mem_burst = DMA_BURST_SINGLE;
+	p_DMA_Handle->p_context = p_USART_Handle;
+}
+
+/*
+ * Rx stream events, half and full buffer report the new data, a transfer error stops the reception
+ */
+static void USART_DMA_Rx_callback(uint8_t event, void *p_context)
+{
+	USART_Handle_t *p_USART_Handle = (USART_Handle_t*)p_context;
+
+	if( (event == DMA_EVENT_HT) || (event == DMA_EVENT_TC) )
+	{
+		USART_DMA_Rx_process(p_USART_Handle);
+	}
+	else if(event == DMA_EVENT_TE_ERR)
+	{
+		USART_stop_receive_DMA(p_USART_Handle);
+		USART_event_callback(p_USART_Handle, USART_ER_DMA);
+	}
+}
+
+/*
+ * reports the bytes the DMA wrote since the last report with USART_EV_RX_DATA, one region, or two when the
+ * write position wrapped around the end of the buffer
+ */
+static void USART_DMA_Rx_process(USART_Handle_t *p_USART_Handle)
+{
+	uint32_t unit = (p_USART_Handle->p_Rx_DMA->DMA_config.DMA_periph_size == DMA_SIZE_HALF_WORD) ? 2 : 1;
+	uint32_t size = p_USART_Handle->Rx_len;
+	uint32_t head = size - (DMA_get_remaining(p_USART_Handle->p_Rx_DMA) * unit);
+	uint32_t pos = p_USART_Handle->Rx_DMA_pos;
+
+	//NDTR is reloaded with the full count at the end of the buffer, so head == size never shows up
+	if(head == pos)
+	{
+		return;
+	}
+
+	if(head < pos)
+	{
+		//wrapped, the end of the buffer first
+		p_USART_Handle->p_Rx_data = p_USART_Handle->p_Rx_buffer + pos;
+		p_USART_Handle->Rx_data_len = size - pos;
+		USART_event_callback(p_USART_Handle, USART_EV_RX_DATA);
+		pos = 0;
+	}
+	if(head > pos)
+	{
+		p_USART_Handle->p_Rx_data = p_USART_Handle->p_Rx_buffer + pos;
+		p_USART_Handle->Rx_data_len = head - pos;
+		USART_event_callback(p_USART_Handle, USART_EV_RX_DATA);
+	}
+	p_USART_Handle->Rx_DMA_pos = head;
+}
+
+/*
+ * computes BRR from the current bus clock, the configured baud rate and OVER8
+ */
+static void USART_set_baud_rate(USART_Handle_t *p_USART_Handle)
+{
+	uint32_t brr_val = 0;
+
+	uint32_t pclkx_val, usartdiv;
+	uint32_t baud = p_USART_Handle->USARTx_config.USART_baud;
+	if(p_USART_Handle->p_USARTx == USART1 || p_USART_Handle->p_USARTx == USART6)
+	{
+		//USART1 and USART6 are on APB2 bus
+		pclkx_val = RCC_get_pclk2();
+	}
+	else
+	{
+		//USART2, USART3, UART4, UART5 are on APB1 bus
+		pclkx_val = RCC_get_pclk1();
+	}
+
+	//check for OVER8 configuration
+	uint8_t over8_config = ( (p_USART_Handle->p_USARTx->CR1 >> USART_CR1_OVER8) & 1 );
+	//USARTDIV in 1/16 steps, rounded, integer only (100 * PCLK overflows 32 bits above 42.9MHz)
+	if(over8_config)
+	{
+		//over sampling by 8, USARTDIV = PCLK / (8 * baud)
+		usartdiv = ((2 * pclkx_val) + (baud / 2)) / baud;
+
+		//mantissa in [15:4], the 3 bit fraction in [2:0], the [3] bit must be kept cleared
+		brr_val = (usartdiv & 0xFFF0) | ((usartdiv & 0x0F) >> 1);
+	}
+	else
+	{
+		//over sampling by 16, USARTDIV = PCLK / (16 * baud), mantissa in [15:4] and fraction in [3:0]
+		usartdiv = (pclkx_val + (baud / 2)) / baud;
+		brr_val = usartdiv & 0xFFFF;
+	}
+
+	p_USART_Handle->p_USARTx->BRR = brr_val;
+}
+
+/*
+ * Tx stream events, transfer complete starts the next chunk or message before the finished message is released,
+ * so the USART keeps sending while the application handles USART_EV_TX_DONE
+ */
+static void USART_DMA_Tx_callback(uint8_t event, void *p_context)
+{
+	USART_Handle_t *p_USART_Handle = (USART_Handle_t*)p_context;
+	uint8_t done_event;
+	uint32_t unit = (p_USART_Handle->p_Tx_DMA->DMA_config.DMA_periph_size == DMA_SIZE_HALF_WORD) ? 2 : 1;
+
+	if(event == DMA_EVENT_TC)
+	{
+		p_USART_Handle->Tx_q_sent += p_USART_Handle->Tx_q_chunk;
+		if( (p_USART_Handle->Tx_queue[p_USART_Handle->Tx_q_head].len - p_USART_Handle->Tx_q_sent) >= unit )
+		{
+			//message longer than one DMA transfer
+			USART_DMA_Tx_next(p_USART_Handle);
+			return;
+		}
+		done_event = USART_EV_TX_DONE;
+	}
+	else if(event == DMA_EVENT_TE_ERR)
+	{
+		//the stream is disabled by hardware, drop the rest of the message and carry on with the next one
+		done_event = USART_ER_DMA;
+	}
+	else
+	{
+		return;
+	}
+
+	p_USART_Handle->Tx_done = p_USART_Handle->Tx_queue[p_USART_Handle->Tx_q_head];
+	p_USART_Handle->Tx_q_head = (p_USART_Handle->Tx_q_head + 1) % USART_TX_QUEUE_LEN;
+	p_USART_Handle->Tx_q_count--;
+	p_USART_Handle->Tx_q_sent = 0;
+
+	if(p_USART_Handle->Tx_q_count > 0)
+	{
+		USART_DMA_Tx_next(p_USART_Handle);
+	}
+	else
+	{
+		p_USART_Handle->p_USARTx->CR3 &= ~(1 << USART_CR3_DMAT);
+		p_USART_Handle->Tx_state = USART_STATE_READY;
+	}
+
+	USART_event_callback(p_USART_Handle, done_event);
+}
+
+/*
+ * starts the DMA on the unsent part of Tx_queue[Tx_q_head], at most 65535 frames at a time (NDTR is 16 bits),
+ * called with the USART and Tx stream interrupts unable to run
+ */
+static void USART_DMA_Tx_next(USART_Handle_t *p_USART_Handle)
+{
+	USART_Tx_desc_t *p_desc = &p_USART_Handle->Tx_queue[p_USART_Handle->Tx_q_head];
+	uint32_t unit = (p_USART_Handle->p_Tx_DMA->DMA_config.DMA_periph_size == DMA_SIZE_HALF_WORD) ? 2 : 1;
+	uint32_t chunk = p_desc->len - p_USART_Handle->Tx_q_sent;
+
+	if(chunk > (0xFFFFU * unit))
+	{
+		chunk = 0xFFFFU * unit;
+	}
+	p_USART_Handle->Tx_q_chunk = chunk;
+
+	DMA_start_IT(p_USART_Handle->p_Tx_DMA, (uint32_t)&p_USART_Handle->p_USARTx->DR,
+			(uint32_t)(p_desc->p_data + p_USART_Handle->Tx_q_sent), (uint16_t)(chunk / unit));
+
+	//DMAT stays set from message to message, the stream takes the next request as soon as it is enabled
+	p_USART_Handle->p_USARTx->CR3 |= (1 << USART_CR3_DMAT);
+}
+
+/*
+ * TXE with the Tx FIFO in use, sends one frame, TXEIE is turned off once the FIFO is empty
+ */
+static void USART_FIFO_Tx(USART_Handle_t *p_USART_Handle)
+{
+	uint32_t size = p_USART_Handle->Tx_fifo_size;
+	uint32_t tail = p_USART_Handle->Tx_fifo_tail;
+	uint32_t count = USART_FIFO_count(p_USART_Handle->Tx_fifo_head, tail, size);
+	uint32_t unit = USART_frame_bytes(p_USART_Handle);
+	uint16_t data;
+
+	if(count < unit)
+	{
+		p_USART_Handle->p_USARTx->CR1 &= ~(1 << USART_CR1_TXEIE);
+		return;
+	}
+
+	data = p_USART_Handle->p_Tx_fifo[tail];
+	tail = (tail + 1 == size) ? 0 : (tail + 1);
+	if(unit == 2)
+	{
+		data |= (uint16_t)(p_USART_Handle->p_Tx_fifo[tail] << 8);
+		tail = (tail + 1 == size) ? 0 : (tail + 1);
+		p_USART_Handle->p_USARTx->DR = (data & (uint16_t)0x01ff);
+	}
+	else if( (p_USART_Handle->USARTx_config.USART_word_len == USART_WORD_LEN_8BITS) &&
+			(p_USART_Handle->USARTx_config.USART_parity != USART_PARITY_DISABLE) )
+	{
+		//only 7 bits are data, parity is enabled
+		p_USART_Handle->p_USARTx->DR = (data & 0x7F);
+	}
+	else
+	{
+		p_USART_Handle->p_USARTx->DR = data;
+	}
+	__asm volatile("" ::: "memory");	//the FIFO loads before the tail that frees the bytes
+	p_USART_Handle->Tx_fifo_tail = tail;
+
+	if( (count - unit) < unit )
+	{
+		p_USART_Handle->p_USARTx->CR1 &= ~(1 << USART_CR1_TXEIE);
+	}
+}
+
+/*
+ * RXNE with the Rx FIFO in use, DR is always read (clears RXNE), the frame is dropped when the FIFO is full
+ */
+static void USART_FIFO_Rx(USART_Handle_t *p_USART_Handle)
+{
+	uint32_t size = p_USART_Handle->Rx_fifo_size;
+	uint32_t head = p_USART_Handle->Rx_fifo_head;
+	uint32_t unit = USART_frame_bytes(p_USART_Handle);
+	uint16_t data = p_USART_Handle->p_USARTx->DR;
+
+	if(unit == 2)
+	{
+		data &= (uint16_t)0x01ff;
+	}
+	else if( (p_USART_Handle->USARTx_config.USART_word_len == USART_WORD_LEN_8BITS) &&
+			(p_USART_Handle->USARTx_config.USART_parity != USART_PARITY_DISABLE) )
+	{
+		//parity is used, so only 7 bits are data and 1 is parity
+		data &= (uint16_t)0x7f;
+	}
+	else
+	{
+		data &= (uint16_t)0xff;
+	}
+
+	if( (size - 1 - USART_FIFO_count(head, p_USART_Handle->Rx_fifo_tail, size)) < unit )
+	{
+		USART_event_callback(p_USART_Handle, USART_ER_RX_FIFO);
+		return;
+	}
+
+	p_USART_Handle->p_Rx_fifo[head] = (uint8_t)data;
+	head = (head + 1 == size) ? 0 : (head + 1);
+	if(unit == 2)
+	{
+		p_USART_Handle->p_Rx_fifo[head] = (uint8_t)(data >> 8);
+		head = (head + 1 == size) ? 0 : (head + 1);
+	}
+	__asm volatile("" ::: "memory");	//the byte stores before the head that publishes them
+	p_USART_Handle->Rx_fifo_head = head;
+}
+
+/*
+ * bytes between tail and head of a ring buffer
+ */
+static uint32_t USART_FIFO_count(uint32_t head, uint32_t tail, uint32_t size)
+{
+	return (head >= tail) ? (head - tail) : (size - tail + head);
+}
+
+/*
+ * bytes per frame in the FIFOs, two with 9 data bits (no parity)
+ */
+static uint32_t USART_frame_bytes(USART_Handle_t *p_USART_Handle)
+{
+	return ( (p_USART_Handle->USARTx_config.USART_word_len == USART_WORD_LEN_9BITS) &&
+			(p_USART_Handle->USARTx_config.USART_parity == USART_PARITY_DISABLE) ) ? 2 : 1;
+}
+
+/*
+ * @func:			USART_event_callback
+ *
+ * @brief:			This is a weak implementation of the function and should be overridden by user application
+ *
+ * @param[in]:		address of the Handle structure of the USART peripheral
+ * @param[in]:		event from the USART application events
+ *
+ * @return:			none
+ */
+__attribute__((weak)) void USART_event_callback(USART_Handle_t *p_USART_Handle, uint8_t event)
+{
+
+}
+
+/*
+ * the transmitter did not finish before a clock change, the paused interrupt based send is closed, a DMA send gives
+ * its current message back in Tx_done and the rest of the queue waits for DMAT to come back after the change
+ */
+static void USART_clk_change_abort(USART_Handle_t *p_USART_Handle)
+{
+	uint32_t primask;
+
+	IRQ_SAVE_DISABLE(primask);
+
+	if(p_USART_Handle->clk_change_IE)
+	{
+		USART_close_send(p_USART_Handle);
+		p_USART_Handle->clk_change_IE = 0;
+	}
+
+	if(p_USART_Handle->clk_change_DMAT && (p_USART_Handle->Tx_q_count > 0))
+	{
+		DMA_stop(p_USART_Handle->p_Tx_DMA);
+		p_USART_Handle->Tx_done = p_USART_Handle->Tx_queue[p_USART_Handle->Tx_q_head];
+		p_USART_Handle->Tx_q_head = (p_USART_Handle->Tx_q_head + 1) % USART_TX_QUEUE_LEN;
+		p_USART_Handle->Tx_q_count--;
+		p_USART_Handle->Tx_q_sent = 0;
+
+		if(p_USART_Handle->Tx_q_count > 0)
+		{
+			//the stream is armed for the next message, its requests start when the POST phase sets DMAT again
+			USART_DMA_Tx_next(p_USART_Handle);
+			p_USART_Handle->p_USARTx->CR3 &= ~(1 << USART_CR3_DMAT);
+		}
+		else
+		{
+			p_USART_Handle->clk_change_DMAT = 0;
+			p_USART_Handle->Tx_state = USART_STATE_READY;
+		}
+	}
+
+	IRQ_RESTORE(primask);
+
+	USART_event_callback(p_USART_Handle, USART_ER_TIMEOUT);
+}
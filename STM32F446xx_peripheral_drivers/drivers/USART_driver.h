@@ -10,6 +10,7 @@
 
 #include "STM32F446xx.h"
 #include "rcc.h"
+#include "DMA_driver.h"
 
 typedef struct
 {
@@ -21,6 +22,23 @@ typedef struct
 	uint8_t 	USART_HW_flow_ctrl;			//!< possible values from @USART_HW_FLOW_CTRL
 }USART_config_t;
 
+/*
+ * number of messages USART_send_DMA can queue per USART
+ */
+#ifndef USART_TX_QUEUE_LEN
+#define USART_TX_QUEUE_LEN		8U
+#endif
+
+/*
+ * queued message of USART_send_DMA, the buffer belongs to the driver until USART_EV_TX_DONE reports it
+ */
+typedef struct
+{
+	const uint8_t	*p_data;
+	uint32_t		len;				//bytes, two per frame with 9 data bits and no parity
+	void			*p_tag;				//application pointer, handed back with USART_EV_TX_DONE
+}USART_Tx_desc_t;
+
 typedef struct
 {
 	USART_reg_t 	*p_USARTx;
@@ -31,6 +49,27 @@ typedef struct
 	uint32_t 		Rx_len;
 	uint8_t 		Tx_state;
 	uint8_t 		Rx_state;
+	uint32_t		clk_change_IE;		//Tx interrupt enables paused by USART_clk_change_handler
+	DMA_Handle_t	*p_Tx_DMA;			//set up by USART_DMA_init, NULL -> no DMA
+	DMA_Handle_t	*p_Rx_DMA;
+	uint32_t		Rx_DMA_pos;			//USART_receive_DMA, first byte of the circular buffer not reported yet
+	uint8_t			*p_Rx_data;			//USART_EV_RX_DATA, new data in the circular buffer
+	uint32_t		Rx_data_len;
+	USART_Tx_desc_t	Tx_queue[USART_TX_QUEUE_LEN];	//USART_send_DMA, Tx_queue[Tx_q_head] is being sent
+	uint8_t			Tx_q_head;
+	uint8_t			Tx_q_count;
+	uint32_t		Tx_q_sent;			//bytes of Tx_queue[Tx_q_head] handed to the DMA so far
+	uint32_t		Tx_q_chunk;			//bytes of the running DMA transfer
+	USART_Tx_desc_t	Tx_done;			//USART_EV_TX_DONE, the message whose buffer is released
+	uint32_t		clk_change_DMAT;	//DMA transmit request paused by USART_clk_change_handler
+	uint8_t			*p_Tx_fifo;			//USART_FIFO_init, NULL -> USART_write not used
+	uint32_t		Tx_fifo_size;
+	volatile uint32_t Tx_fifo_head;		//next free byte, written by USART_write
+	volatile uint32_t Tx_fifo_tail;		//next byte to send, written by the interrupt
+	uint8_t			*p_Rx_fifo;			//USART_FIFO_init, NULL -> USART_read not used
+	uint32_t		Rx_fifo_size;
+	volatile uint32_t Rx_fifo_head;		//next free byte, written by the interrupt
+	volatile uint32_t Rx_fifo_tail;		//next byte to read, written by USART_read
 }USART_Handle_t;
 
 /*
@@ -92,6 +131,7 @@ typedef struct
 #define USART_STATE_READY		0
 #define USART_STATE_BUSY_TX		1
 #define USART_STATE_BUSY_RX		2
+#define USART_STATE_ERR			3		//returned by USART_receive_DMA for a missing stream or a bad length, nothing started
 
 /*
  * possible user application callback events
@@ -103,6 +143,13 @@ typedef struct
 #define USART_EV_ORE			4
 #define USART_ER_NF				5
 #define USART_ER_FE				6
+#define USART_EV_RX_DATA		7		//USART_receive_DMA, p_Rx_data/Rx_data_len in the Handle hold new data
+#define USART_ER_DMA			8		//DMA transfer error, the DMA transfer was stopped (Tx: Tx_done holds the message)
+#define USART_EV_TX_DONE		9		//USART_send_DMA, the message in Tx_done was sent and its buffer is free
+#define USART_ER_RX_FIFO		10		//USART_FIFO_init, a frame was received with the Rx FIFO full and dropped
+#define USART_ER_TIMEOUT		11		//USART_clk_change_handler, the transmitter did not finish, the send was closed (DMA: Tx_done holds the message)
+
+#define USART_CLK_CHANGE_TIMEOUT	2000000U	//loops USART_clk_change_handler waits for TC, a few frames at 1200 baud
 
 
 /**************************APIs**************************/
@@ -130,6 +177,22 @@ void USART_receive(USART_Handle_t *p_USART_Handle, uint8_t *p_Rx_buffer, uint32_
 uint8_t USART_send_IT(USART_Handle_t *p_USART_Handle, uint8_t *p_Tx_buffer, uint32_t len);
 uint8_t USART_receive_IT(USART_Handle_t *p_USART_Handle, uint8_t *p_Rx_buffer, uint32_t len);
 
+/*
+ * DMA based send and receive
+ */
+void USART_DMA_init(USART_Handle_t *p_USART_Handle, DMA_Handle_t *p_Tx_DMA, DMA_Handle_t *p_Rx_DMA);
+uint8_t USART_receive_DMA(USART_Handle_t *p_USART_Handle, uint8_t *p_Rx_buffer, uint32_t len);
+void USART_stop_receive_DMA(USART_Handle_t *p_USART_Handle);
+uint8_t USART_send_DMA(USART_Handle_t *p_USART_Handle, const uint8_t *p_data, uint32_t len, void *p_tag);
+uint8_t USART_get_Tx_queue_free(USART_Handle_t *p_USART_Handle);
+
+/*
+ * FIFO (ring buffer) based send and receive
+ */
+void USART_FIFO_init(USART_Handle_t *p_USART_Handle, uint8_t *p_Tx_fifo, uint32_t Tx_size, uint8_t *p_Rx_fifo, uint32_t Rx_size);
+uint32_t USART_write(USART_Handle_t *p_USART_Handle, const uint8_t *p_data, uint32_t len);
+uint32_t USART_read(USART_Handle_t *p_USART_Handle, uint8_t *p_data, uint32_t len);
+
 /*
  * IQR configuration and handling
  */
@@ -144,6 +207,7 @@ void USART_periph_control(USART_Handle_t *p_USART_Handle, uint8_t enable);
 uint8_t USART_get_flag_status(USART_reg_t *p_USARTx, uint8_t flag_bit);
 void USART_close_send(USART_Handle_t *p_USART_Handle);
 void USART_close_receive(USART_Handle_t *p_USART_Handle);
+void USART_clk_change_handler(uint8_t phase, void *p_context);
 
 /*
  * user application APIs
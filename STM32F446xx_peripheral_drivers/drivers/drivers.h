@@ -11,5 +11,8 @@
 #include "GPIO_driver.h"
 #include "SPI_driver.h"
 #include "I2C_driver.h"
+#include "DMA_driver.h"
+#include "spi_bus.h"
+#include "i2c_bus.h"
 
 #endif /* DRIVERS_DRIVERS_H_ */
@@ -0,0 +1,266 @@
+/*
+ * i2c_bus.c
+ *
+ *  Created on: Jan 25, 2026
+ *      Author: krisko
+ */
+
+#include "i2c_bus.h"
+
+//private helper functions
+static void I2C_bus_event(uint8_t event, void *p_context);
+static void I2C_bus_start(I2C_bus_t *p_bus);
+static uint8_t I2C_bus_read(I2C_bus_t *p_bus, I2C_bus_xfer_t *p_xfer);
+static void I2C_bus_finish(I2C_bus_t *p_bus, uint8_t status, uint8_t error);
+
+/*
+ * @func:			I2C_bus_init
+ *
+ * @brief:			This function sets up the given I2C peripheral to run queued transactions
+ *
+ * @param[in]:		address of the I2C bus structure
+ * @param[in]:		address of I2C Handle for the peripheral, after I2C_init and I2C_periph_control
+ *
+ * @return:			none
+ *
+ * @note:			the I2C events of the Handle go to the bus from now on, not to I2C_event_callback
+ * 					with I2C_DMA_init the data moves by DMA (a phase over 65535 bytes by interrupts), else by interrupts
+ * 					the application enables the EV and ER IRQs and calls I2C_EV_IRQ_handling/I2C_ER_IRQ_handling,
+ * 					the EV, ER (and stream) IRQs should have the same priority
+ */
+void I2C_bus_init(I2C_bus_t *p_bus, I2C_Handle_t *p_I2C_Handle)
+{
+	p_bus->p_I2C_Handle = p_I2C_Handle;
+	p_bus->p_head = NULL;
+	p_bus->p_tail = NULL;
+	p_bus->running = 0;
+
+	p_I2C_Handle->p_callback = I2C_bus_event;
+	p_I2C_Handle->p_context = p_bus;
+}
+
+/*
+ * @func:			I2C_bus_submit
+ *
+ * @brief:			This function queues a transaction, it starts right away if the bus is idle
+ *
+ * @param[in]:		address of the I2C bus structure
+ * @param[in]:		address of the transaction, target_addr, buffers, lengths and p_callback set
+ *
+ * @return:			1 -> queued, 0 -> rejected (Tx_len and Rx_len both 0)
+ *
+ * @note:			callable from tasks and interrupt handlers, it never waits, transactions run in submit order
+ * 					a register read is one transaction (Tx = register address, Rx = data), the write, repeated
+ * 					start and read run from the interrupts, the next transaction is started before the callback
+ * 					if the I2C Handle is busy with a transfer started outside the bus, the transaction waits at
+ * 					the head of the queue and starts from the event that ends that transfer
+ */
+uint8_t I2C_bus_submit(I2C_bus_t *p_bus, I2C_bus_xfer_t *p_xfer)
+{
+	uint32_t primask;
+
+	//there is no zero length controller transfer, the receive would wait for a byte forever
+	if( (p_xfer->Tx_len == 0) && (p_xfer->Rx_len == 0) )
+	{
+		return 0;
+	}
+
+	p_xfer->status = I2C_BUS_XFER_QUEUED;
+	p_xfer->error = 0;
+	p_xfer->p_next = NULL;
+
+	IRQ_SAVE_DISABLE(primask);
+
+	if(p_bus->p_tail == NULL)
+	{
+		p_bus->p_head = p_xfer;
+	}
+	else
+	{
+		p_bus->p_tail->p_next = p_xfer;
+	}
+	p_bus->p_tail = p_xfer;
+
+	I2C_bus_start(p_bus);
+
+	IRQ_RESTORE(primask);
+
+	return 1;
+}
+
+/*
+ * @func:			I2C_bus_busy
+ *
+ * @brief:			This function tells whether transactions are running or queued on the bus
+ *
+ * @param[in]:		address of the I2C bus structure
+ *
+ * @return:			1 -> busy, 0 -> idle
+ */
+uint8_t I2C_bus_busy(I2C_bus_t *p_bus)
+{
+	return (p_bus->p_head != NULL);
+}
+
+/*
+ * private helper functions
+ */
+
+/*
+ * I2C events of the bus Handle, the write phase ends with I2C_EV_TX_CMPLT (SCL held for the repeated start when a read
+ * follows), the read phase with I2C_EV_RX_CMPLT, any error ends the transaction
+ * with nothing running the event ends a transfer started outside the bus, the head of the queue is tried again
+ */
+static void I2C_bus_event(uint8_t event, void *p_context)
+{
+	I2C_bus_t *p_bus = (I2C_bus_t*)p_context;
+	I2C_Handle_t *p_I2C_Handle = p_bus->p_I2C_Handle;
+	I2C_bus_xfer_t *p_xfer = p_bus->p_head;
+	uint32_t primask;
+	uint8_t read_state;
+
+	if(p_bus->running == 0)
+	{
+		IRQ_SAVE_DISABLE(primask);
+		I2C_bus_start(p_bus);
+		IRQ_RESTORE(primask);
+		return;
+	}
+
+	if(event == I2C_EV_TX_CMPLT)
+	{
+		if(p_xfer->Rx_len > 0)
+		{
+			IRQ_SAVE_DISABLE(primask);
+			read_state = I2C_bus_read(p_bus, p_xfer);
+			IRQ_RESTORE(primask);
+
+			//the Handle closed the write phase just before this event, it should not be busy
+			if(read_state != I2C_STATE_READY)
+			{
+				I2C_generate_stop(p_I2C_Handle);
+				I2C_bus_finish(p_bus, I2C_BUS_XFER_ERR, 0);
+			}
+		}
+		else
+		{
+			I2C_bus_finish(p_bus, I2C_BUS_XFER_DONE, 0);
+		}
+	}
+	else if(event == I2C_EV_RX_CMPLT)
+	{
+		I2C_bus_finish(p_bus, I2C_BUS_XFER_DONE, 0);
+	}
+	else if( (event == I2C_ER_BERR) || (event == I2C_ER_ARLO) || (event == I2C_ER_AF) || (event == I2C_ER_OVR) ||
+			(event == I2C_ER_TIMEOUT) || (event == I2C_ER_DMA) )
+	{
+		//release the bus, after arbitration lost the peripheral is not the controller any more
+		if( (event != I2C_ER_ARLO) && ((p_I2C_Handle->p_I2Cx->SR2 >> I2C_SR2_MSL) & 1) )
+		{
+			I2C_generate_stop(p_I2C_Handle);
+		}
+		if(p_I2C_Handle->TxRxstate == I2C_STATE_BUSY_TX)
+		{
+			I2C_close_send(p_I2C_Handle);
+		}
+		else if(p_I2C_Handle->TxRxstate == I2C_STATE_BUSY_RX)
+		{
+			I2C_close_receive(p_I2C_Handle);
+		}
+		I2C_bus_finish(p_bus, I2C_BUS_XFER_ERR, event);
+	}
+}
+
+/*
+ * removes the running transaction, starts the next one and calls the callback of the finished one
+ */
+static void I2C_bus_finish(I2C_bus_t *p_bus, uint8_t status, uint8_t error)
+{
+	I2C_bus_xfer_t *p_xfer;
+	uint32_t primask;
+
+	IRQ_SAVE_DISABLE(primask);
+
+	p_xfer = p_bus->p_head;
+	p_xfer->error = error;
+	p_xfer->status = status;
+	p_bus->running = 0;
+
+	p_bus->p_head = p_xfer->p_next;
+	if(p_bus->p_head == NULL)
+	{
+		p_bus->p_tail = NULL;
+	}
+
+	I2C_bus_start(p_bus);
+
+	IRQ_RESTORE(primask);
+
+	if(p_xfer->p_callback)
+	{
+		p_xfer->p_callback(p_xfer);
+	}
+}
+
+/*
+ * starts the transaction at the head of the queue if nothing is running, called with interrupts masked
+ * a Handle busy outside the bus leaves the transaction queued, I2C_bus_event tries again
+ */
+static void I2C_bus_start(I2C_bus_t *p_bus)
+{
+	I2C_Handle_t *p_I2C_Handle = p_bus->p_I2C_Handle;
+	I2C_bus_xfer_t *p_xfer = p_bus->p_head;
+	uint8_t RS_enable, state;
+
+	if( (p_bus->running) || (p_xfer == NULL) || (p_I2C_Handle->TxRxstate != I2C_STATE_READY) )
+	{
+		return;
+	}
+
+	//START must not be requested before the STOP of the previous transaction is on the bus (a few us)
+	while( (p_I2C_Handle->p_I2Cx->CR1 >> I2C_CR1_STOP) & 1 );
+
+	p_xfer->status = I2C_BUS_XFER_RUNNING;
+	p_bus->running = 1;
+
+	if(p_xfer->Tx_len > 0)
+	{
+		//keep the bus with a repeated start when a read follows
+		RS_enable = (p_xfer->Rx_len > 0) ? I2C_RS_ENABLE : I2C_RS_DISABLE;
+		if( (p_I2C_Handle->p_Tx_DMA != NULL) && (p_xfer->Tx_len <= 0xFFFFU) )
+		{
+			state = I2C_controller_send_DMA(p_I2C_Handle, p_xfer->p_Tx_buffer, p_xfer->Tx_len, p_xfer->target_addr, RS_enable);
+		}
+		else
+		{
+			state = I2C_controller_send_IT(p_I2C_Handle, p_xfer->p_Tx_buffer, p_xfer->Tx_len, p_xfer->target_addr, RS_enable);
+		}
+	}
+	else
+	{
+		state = I2C_bus_read(p_bus, p_xfer);
+	}
+
+	if(state != I2C_STATE_READY)
+	{
+		p_xfer->status = I2C_BUS_XFER_QUEUED;
+		p_bus->running = 0;
+	}
+}
+
+/*
+ * starts the read phase, returns the Handle state before the call, I2C_STATE_READY -> started
+ */
+static uint8_t I2C_bus_read(I2C_bus_t *p_bus, I2C_bus_xfer_t *p_xfer)
+{
+	I2C_Handle_t *p_I2C_Handle = p_bus->p_I2C_Handle;
+
+	if( (p_I2C_Handle->p_Rx_DMA != NULL) && (p_xfer->Rx_len <= 0xFFFFU) )
+	{
+		return I2C_controller_receive_DMA(p_I2C_Handle, p_xfer->p_Rx_buffer, p_xfer->Rx_len, p_xfer->target_addr, I2C_RS_DISABLE);
+	}
+	else
+	{
+		return I2C_controller_receive_IT(p_I2C_Handle, p_xfer->p_Rx_buffer, p_xfer->Rx_len, p_xfer->target_addr, I2C_RS_DISABLE);
+	}
+}
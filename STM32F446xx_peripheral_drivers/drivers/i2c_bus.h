@@ -0,0 +1,72 @@
+/*
+ * i2c_bus.h
+ *
+ *  Created on: Jan 25, 2026
+ *      Author: krisko
+ */
+
+#ifndef DRIVERS_I2C_BUS_H_
+#define DRIVERS_I2C_BUS_H_
+
+#include "I2C_driver.h"
+
+typedef struct I2C_bus_xfer I2C_bus_xfer_t;
+
+/*
+ * transaction done callback, called from the I2C or DMA interrupt after the next transaction was started
+ */
+typedef void (*I2C_bus_cb_t)(I2C_bus_xfer_t *p_xfer);
+
+/*
+ * transaction: write Tx_len bytes, then (repeated start) read Rx_len bytes, then STOP
+ * owned by the bus from I2C_bus_submit until its callback (or status DONE/ERR)
+ */
+struct I2C_bus_xfer
+{
+	uint8_t			target_addr;		//7 bit address
+	uint8_t			*p_Tx_buffer;		//e.g. the register address, then data to write
+	uint32_t		Tx_len;				//0 -> read only
+	uint8_t			*p_Rx_buffer;
+	uint32_t		Rx_len;				//0 -> write only
+	volatile uint8_t status;			//!< possible values from @I2C_BUS_STATUS, written by the bus
+	uint8_t			error;				//I2C_ER_xxx event that ended the transaction with I2C_BUS_XFER_ERR
+	I2C_bus_cb_t	p_callback;			//NULL -> only status is updated
+	void			*p_context;			//application pointer
+	I2C_bus_xfer_t	*p_next;			//queue link, used by the bus
+};
+
+/*
+ * I2C bus, one per I2C peripheral
+ */
+typedef struct
+{
+	I2C_Handle_t	*p_I2C_Handle;
+	I2C_bus_xfer_t	*p_head;			//running transaction, then the queued ones in submit order
+	I2C_bus_xfer_t	*p_tail;
+	uint8_t			running;
+}I2C_bus_t;
+
+/*
+ * @I2C_BUS_STATUS
+ */
+#define I2C_BUS_XFER_QUEUED		0
+#define I2C_BUS_XFER_RUNNING	1
+#define I2C_BUS_XFER_DONE		2
+#define I2C_BUS_XFER_ERR		3		//error holds the I2C error event (I2C_ER_AF: the target did not ACK), 0 -> the read could not start
+
+
+/**************************APIs**************************/
+
+/*
+ * initialize
+ */
+void I2C_bus_init(I2C_bus_t *p_bus, I2C_Handle_t *p_I2C_Handle);
+
+/*
+ * transactions
+ */
+uint8_t I2C_bus_submit(I2C_bus_t *p_bus, I2C_bus_xfer_t *p_xfer);
+uint8_t I2C_bus_busy(I2C_bus_t *p_bus);
+
+
+#endif /* DRIVERS_I2C_BUS_H_ */
@@ -7,92 +7,540 @@
 
 #include <stdint.h>
 #include "rcc.h"
+
+//cached clock frequencies, recomputed only when the clock tree changes
+static uint32_t sysclk_hz, hclk_hz, pclk1_hz, pclk2_hz;
+static uint8_t clk_cache_valid = 0;
+
+//registered clock change callbacks
+static RCC_clk_change_cb_t clk_change_cb[RCC_MAX_CLK_CHANGE_CB];
+static void *clk_change_ctx[RCC_MAX_CLK_CHANGE_CB];
+
+//private helper functions
+static uint8_t RCC_wait_flag(volatile uint32_t *p_reg, uint8_t flag_bit, uint8_t val);
+static uint32_t RCC_ahb_div(uint8_t HPRE);
+static uint32_t RCC_apb_div(uint8_t PPRE);
+static uint8_t RCC_switch_sysclk(uint8_t clk_src);
+static void RCC_set_flash_latency(uint32_t hclk);
+static uint8_t RCC_overdrive_on(void);
+static uint8_t RCC_overdrive_off(void);
+static uint32_t RCC_src_freq(uint8_t clk_src);
+static void RCC_notify_clk_change(uint8_t phase);
+static uint8_t RCC_clock_tree_setup(RCC_config_t *p_RCC_config, uint32_t hclk);
+
 /*
- * @func:			RCC_get_pclk1
+ * @func:			RCC_clock_config
  *
- * @brief:			This function calculates the clock speed of APB1
+ * @brief:			This function configures the system clock source, the PLL, over-drive mode, flash wait states
+ * 					and the AHB/APB prescalers
  *
- * @return:			APB1 clock speed
+ * @param[in]:		address of the clock configuration structure
  *
- * @note:			only HSI and HSE are considered for system clock source, PLL is not considered
+ * @return:			RCC_CONFIG_OK, RCC_CONFIG_ERR_PARAM if the configuration exceeds the limits of the clock tree
+ * 					or RCC_CONFIG_ERR_TIMEOUT if an oscillator, the PLL or over-drive did not get ready
+ *
+ * @note:			the system clock is moved to HSI while the PLL is reprogrammed, so this function can be called
+ * 					again at runtime to change frequency, registered drivers are notified before and after the change
+ * 					over-drive is switched on for HCLK above 168MHz and off again when a later call goes down to 168MHz
+ * 					or less, a PLL_M that puts the VCO input outside 1 to 2MHz is rejected
+ * 					example for 180MHz from HSI: M = 8, N = 180, P = DIV2, Q = 8, AHB = DIV1, APB1 = DIV4, APB2 = DIV2
  */
-uint32_t RCC_get_pclk1(void)
+uint8_t RCC_clock_config(RCC_config_t *p_RCC_config)
 {
-	static const uint32_t possible_pscals[] = {2,4,8,16,64,128,256,512};
-	uint32_t system_clk, AHB_pscal, APB1_pscal;
+	uint32_t pll_in, vco, sysclk, hclk;
+	uint8_t err;
 
-	//find system clock source speed
-	uint32_t clk_src = (RCC->CFGR >> 2) & 0b11;
-	if(clk_src == 0){	//HSI
-		system_clk = 16000000;
+	/*
+	 * check the configuration before touching any register
+	 */
+	if(p_RCC_config->RCC_sysclk_src == RCC_SYSCLK_SRC_PLL)
+	{
+		if( (p_RCC_config->RCC_PLL_M < 2) || (p_RCC_config->RCC_PLL_M > 63) ||
+			(p_RCC_config->RCC_PLL_N < 50) || (p_RCC_config->RCC_PLL_N > 432) ||
+			(p_RCC_config->RCC_PLL_Q < 2) || (p_RCC_config->RCC_PLL_Q > 15) || (p_RCC_config->RCC_PLL_P > 3) )
+		{
+			return RCC_CONFIG_ERR_PARAM;
+		}
+		pll_in = (p_RCC_config->RCC_PLL_src == RCC_PLL_SRC_HSE) ? HSE_CLOCK : HSI_CLOCK;
+		if( (pll_in < (1000000U * p_RCC_config->RCC_PLL_M)) || (pll_in > (2000000U * p_RCC_config->RCC_PLL_M)) )
+		{
+			return RCC_CONFIG_ERR_PARAM;	//VCO input outside 1 to 2MHz
+		}
+		vco = (pll_in / p_RCC_config->RCC_PLL_M) * p_RCC_config->RCC_PLL_N;
+		if( (vco < 100000000U) || (vco > 432000000U) )
+		{
+			return RCC_CONFIG_ERR_PARAM;
+		}
+		sysclk = vco / ((p_RCC_config->RCC_PLL_P + 1) * 2);
 	}
-	else if (clk_src == 1)	//HSE
+	else if(p_RCC_config->RCC_sysclk_src == RCC_SYSCLK_SRC_HSE)
 	{
-		system_clk = 8000000;
+		sysclk = HSE_CLOCK;
 	}
 	else
 	{
-		// PLL not supported, assume HSI as fallback
-		system_clk = 16000000;
+		sysclk = HSI_CLOCK;
+	}
+
+	hclk = sysclk / RCC_ahb_div(p_RCC_config->RCC_AHB_pscal);
+	if( (sysclk > RCC_MAX_SYSCLK) ||
+		( (hclk / RCC_apb_div(p_RCC_config->RCC_APB1_pscal)) > RCC_MAX_PCLK1) ||
+		( (hclk / RCC_apb_div(p_RCC_config->RCC_APB2_pscal)) > RCC_MAX_PCLK2) )
+	{
+		return RCC_CONFIG_ERR_PARAM;
+	}
+
+	//let registered drivers finish or pause their current transfer
+	RCC_notify_clk_change(RCC_CLK_CHANGE_PRE);
+
+	err = RCC_clock_tree_setup(p_RCC_config, hclk);
+
+	//the clock may have changed even if the setup failed part way, so always re-read it and notify
+	RCC_update_clock_cache();
+	RCC_notify_clk_change(RCC_CLK_CHANGE_POST);
+
+	return err;
+}
+
+/*
+ * @func:			RCC_set_sysclk_src
+ *
+ * @brief:			This function switches the system clock between sources that are already running, e.g. between
+ * 					the PLL for processing bursts and HSI between them, without reprogramming the PLL
+ *
+ * @param[in]:		new system clock source, from @RCC_SYSCLK_SRC
+ *
+ * @return:			RCC_CONFIG_OK, RCC_CONFIG_ERR_PARAM if the source is not running or the kept prescalers would
+ * 					put HCLK/PCLK1/PCLK2 above their limits, or RCC_CONFIG_ERR_TIMEOUT
+ *
+ * @note:			prescalers are kept, so they must be valid for the faster source (see RCC_clock_config)
+ * 					over-drive is switched on before going to a PLL above 168MHz and off after leaving the PLL
+ * 					registered drivers are notified before and after the switch
+ */
+uint8_t RCC_set_sysclk_src(uint8_t clk_src)
+{
+	uint8_t err = RCC_CONFIG_OK;
+	uint32_t new_sysclk, new_hclk;
+
+	//the source must have been started before, by RCC_clock_config or out of reset for HSI
+	if( ( (clk_src == RCC_SYSCLK_SRC_HSI) && !((RCC->CR >> RCC_CR_HSIRDY) & 1) ) ||
+		( (clk_src == RCC_SYSCLK_SRC_HSE) && !((RCC->CR >> RCC_CR_HSERDY) & 1) ) ||
+		( (clk_src == RCC_SYSCLK_SRC_PLL) && !((RCC->CR >> RCC_CR_PLLRDY) & 1) ) ||
+		(clk_src > RCC_SYSCLK_SRC_PLL) )
+	{
+		return RCC_CONFIG_ERR_PARAM;
+	}
+
+	if( ((RCC->CFGR >> RCC_CFGR_SWS) & 0x3) == clk_src )
+		return RCC_CONFIG_OK;
+
+	//the prescalers stay as they are, check what they give with the new source before touching anything
+	new_sysclk = RCC_src_freq(clk_src);
+	new_hclk = new_sysclk / RCC_ahb_div((RCC->CFGR >> RCC_CFGR_HPRE) & 0xF);
+	if( (new_sysclk > RCC_MAX_SYSCLK) ||
+		( (new_hclk / RCC_apb_div((RCC->CFGR >> RCC_CFGR_PPRE1) & 0x7)) > RCC_MAX_PCLK1) ||
+		( (new_hclk / RCC_apb_div((RCC->CFGR >> RCC_CFGR_PPRE2) & 0x7)) > RCC_MAX_PCLK2) )
+	{
+		return RCC_CONFIG_ERR_PARAM;
+	}
+
+	RCC_notify_clk_change(RCC_CLK_CHANGE_PRE);
+
+	//raise wait states before speeding up, lower them only after slowing down
+	if(new_hclk > RCC_get_hclk())
+		RCC_set_flash_latency(new_hclk);
+
+	//over-drive can only be entered from HSI/HSE, which is what runs now since the source changes to the PLL
+	if(new_hclk > RCC_MAX_SYSCLK_NO_OD)
+		err = RCC_overdrive_on();
+
+	if( (err == RCC_CONFIG_OK) && RCC_switch_sysclk(clk_src) )
+		err = RCC_CONFIG_ERR_TIMEOUT;
+
+	//and left once HSI/HSE runs again
+	if( (err == RCC_CONFIG_OK) && (clk_src != RCC_SYSCLK_SRC_PLL) )
+		err = RCC_overdrive_off();
+
+	RCC_update_clock_cache();
+	RCC_set_flash_latency(hclk_hz);
+
+	RCC_notify_clk_change(RCC_CLK_CHANGE_POST);
+
+	return err;
+}
+
+/*
+ * @func:			RCC_register_clk_change
+ *
+ * @brief:			This function registers a callback that is called before and after every clock change
+ *
+ * @param[in]:		callback function, e.g. USART_clk_change_handler or I2C_clk_change_handler
+ * @param[in]:		pointer given back to the callback (the Handle of the peripheral)
+ *
+ * @return:			0 on success, 1 if all RCC_MAX_CLK_CHANGE_CB slots are used
+ *
+ * @note:			callbacks are called from the context that changes the clock, they may busy-wait for a transfer
+ * 					to finish so the clock should not be changed from an interrupt handler
+ */
+uint8_t RCC_register_clk_change(RCC_clk_change_cb_t p_callback, void *p_context)
+{
+	for(uint8_t i = 0; i < RCC_MAX_CLK_CHANGE_CB; i++)
+	{
+		if(clk_change_cb[i] == NULL)
+		{
+			clk_change_ctx[i] = p_context;
+			clk_change_cb[i] = p_callback;
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*
+ * @func:			RCC_unregister_clk_change
+ *
+ * @brief:			This function removes a callback added by RCC_register_clk_change
+ *
+ * @param[in]:		callback function
+ * @param[in]:		pointer given at registration
+ *
+ * @return:			none
+ */
+void RCC_unregister_clk_change(RCC_clk_change_cb_t p_callback, void *p_context)
+{
+	for(uint8_t i = 0; i < RCC_MAX_CLK_CHANGE_CB; i++)
+	{
+		if( (clk_change_cb[i] == p_callback) && (clk_change_ctx[i] == p_context) )
+		{
+			clk_change_cb[i] = NULL;
+			clk_change_ctx[i] = NULL;
+		}
+	}
+}
+
+/*
+ * @func:			RCC_clock_tree_setup
+ *
+ * @brief:			This function does the register work of RCC_clock_config for an already checked configuration
+ *
+ * @param[in]:		address of the clock configuration structure
+ * @param[in]:		resulting AHB clock
+ *
+ * @return:			RCC_CONFIG_OK or RCC_CONFIG_ERR_TIMEOUT
+ */
+static uint8_t RCC_clock_tree_setup(RCC_config_t *p_RCC_config, uint32_t hclk)
+{
+	uint32_t temp;
+
+	/*
+	 * run from HSI while the clock tree is changed
+	 */
+	RCC->CR |= (1 << RCC_CR_HSION);
+	if(RCC_wait_flag(&RCC->CR, RCC_CR_HSIRDY, 1))
+		return RCC_CONFIG_ERR_TIMEOUT;
+	if(RCC_switch_sysclk(RCC_SYSCLK_SRC_HSI))
+		return RCC_CONFIG_ERR_TIMEOUT;
+	clk_cache_valid = 0;
+
+	/*
+	 * leave over-drive while running from HSI if the new HCLK does not need it
+	 */
+	if( (hclk <= RCC_MAX_SYSCLK_NO_OD) && RCC_overdrive_off() )
+		return RCC_CONFIG_ERR_TIMEOUT;
+
+	/*
+	 * start HSE if it is used by the system clock or the PLL
+	 */
+	if( (p_RCC_config->RCC_sysclk_src == RCC_SYSCLK_SRC_HSE) ||
+		( (p_RCC_config->RCC_sysclk_src == RCC_SYSCLK_SRC_PLL) && (p_RCC_config->RCC_PLL_src == RCC_PLL_SRC_HSE) ) )
+	{
+		//HSEBYP can only be written while HSE is off
+		RCC->CR &= ~(1 << RCC_CR_HSEON);
+		if(RCC_wait_flag(&RCC->CR, RCC_CR_HSERDY, 0))
+			return RCC_CONFIG_ERR_TIMEOUT;
+		if(p_RCC_config->RCC_HSE_bypass == ENABLE)
+			RCC->CR |= (1 << RCC_CR_HSEBYP);
+		else
+			RCC->CR &= ~(1 << RCC_CR_HSEBYP);
+
+		RCC->CR |= (1 << RCC_CR_HSEON);
+		if(RCC_wait_flag(&RCC->CR, RCC_CR_HSERDY, 1))
+			return RCC_CONFIG_ERR_TIMEOUT;
+	}
+
+	/*
+	 * configure the PLL and the regulator
+	 */
+	if(p_RCC_config->RCC_sysclk_src == RCC_SYSCLK_SRC_PLL)
+	{
+		//PLL can only be configured when it is off
+		RCC->CR &= ~(1 << RCC_CR_PLLON);
+		if(RCC_wait_flag(&RCC->CR, RCC_CR_PLLRDY, 0))
+			return RCC_CONFIG_ERR_TIMEOUT;
+
+		temp = RCC->PLLCFGR;
+		temp &= ~( (0x3F << RCC_PLLCFGR_PLLM) | (0x1FF << RCC_PLLCFGR_PLLN) | (0x3 << RCC_PLLCFGR_PLLP) |
+				   (1 << RCC_PLLCFGR_PLLSRC) | (0xF << RCC_PLLCFGR_PLLQ) );
+		temp |= (p_RCC_config->RCC_PLL_M << RCC_PLLCFGR_PLLM);
+		temp |= (p_RCC_config->RCC_PLL_N << RCC_PLLCFGR_PLLN);
+		temp |= (p_RCC_config->RCC_PLL_P << RCC_PLLCFGR_PLLP);
+		temp |= (p_RCC_config->RCC_PLL_src << RCC_PLLCFGR_PLLSRC);
+		temp |= (p_RCC_config->RCC_PLL_Q << RCC_PLLCFGR_PLLQ);
+		RCC->PLLCFGR = temp;
+
+		//voltage scale 1 is needed for anything above 144MHz, VOS can only be changed while the PLL is off
+		PWR_PCLK_EN();
+		PWR->CR |= (0x3 << PWR_CR_VOS);
+
+		RCC->CR |= (1 << RCC_CR_PLLON);
+		if(RCC_wait_flag(&RCC->CR, RCC_CR_PLLRDY, 1))
+			return RCC_CONFIG_ERR_TIMEOUT;
+
+		//over-drive has to be enabled after the PLL is locked and before switching to it
+		if( (hclk > RCC_MAX_SYSCLK_NO_OD) && RCC_overdrive_on() )
+			return RCC_CONFIG_ERR_TIMEOUT;
 	}
-	//find AHB prescalar
-	uint32_t HPRE = (RCC->CFGR >> 4) & 0b1111;
-	if(HPRE < 8) 	//vals below 0b1000 are all not divided by
-		AHB_pscal = 1;
-	else			//vals at 0b1000 and above are divided by
-		AHB_pscal = possible_pscals[HPRE - 8];
-
-	//find APB1 prescalar, I2C peripherals all under APB1
-	uint32_t PPRE1 = (RCC->CFGR >> 10) & 0b111;
-	if(PPRE1 < 4)
-		APB1_pscal = 1;
-	else
-		APB1_pscal = possible_pscals[PPRE1 - 4];
 
-	return (system_clk / AHB_pscal) / APB1_pscal;
+	/*
+	 * flash wait states have to be raised before the clock goes up
+	 */
+	RCC_set_flash_latency(hclk);
+
+	//configure AHB and APB prescalers
+	temp = RCC->CFGR;
+	temp &= ~( (0xF << RCC_CFGR_HPRE) | (0x7 << RCC_CFGR_PPRE1) | (0x7 << RCC_CFGR_PPRE2) );
+	temp |= (p_RCC_config->RCC_AHB_pscal << RCC_CFGR_HPRE);
+	temp |= (p_RCC_config->RCC_APB1_pscal << RCC_CFGR_PPRE1);
+	temp |= (p_RCC_config->RCC_APB2_pscal << RCC_CFGR_PPRE2);
+	RCC->CFGR = temp;
+
+	//switch to the new system clock
+	if(RCC_switch_sysclk(p_RCC_config->RCC_sysclk_src))
+		return RCC_CONFIG_ERR_TIMEOUT;
+
+	return RCC_CONFIG_OK;
+}
+
+/*
+ * @func:			RCC_get_sysclk
+ *
+ * @brief:			This function returns the system clock (SYSCLK) frequency
+ *
+ * @return:			system clock speed in Hz
+ */
+uint32_t RCC_get_sysclk(void)
+{
+	if(!clk_cache_valid)
+		RCC_update_clock_cache();
+	return sysclk_hz;
+}
+
+/*
+ * @func:			RCC_get_hclk
+ *
+ * @brief:			This function returns the AHB clock (HCLK) frequency, which also clocks the core and SysTick
+ *
+ * @return:			AHB clock speed in Hz
+ */
+uint32_t RCC_get_hclk(void)
+{
+	if(!clk_cache_valid)
+		RCC_update_clock_cache();
+	return hclk_hz;
 }
 
 /*
  * @func:			RCC_get_pclk1
  *
- * @brief:			This function calculates the clock speed of APB2
+ * @brief:			This function returns the clock speed of APB1
+ *
+ * @return:			APB1 clock speed
+ *
+ * @note:			the value is cached, call RCC_update_clock_cache if RCC registers are changed without RCC_clock_config
+ */
+uint32_t RCC_get_pclk1(void)
+{
+	if(!clk_cache_valid)
+		RCC_update_clock_cache();
+	return pclk1_hz;
+}
+
+/*
+ * @func:			RCC_get_pclk2
+ *
+ * @brief:			This function returns the clock speed of APB2
  *
  * @return:			APB2 clock speed
  *
- * @note:			only HSI and HSE are considered for system clock source, PLL is not considered
+ * @note:			the value is cached, call RCC_update_clock_cache if RCC registers are changed without RCC_clock_config
  */
 uint32_t RCC_get_pclk2(void)
 {
-	static const uint32_t possible_pscals[] = {2,4,8,16,64,128,256,512};
-	uint32_t system_clk, AHB_pscal, APB2_pscal;
+	if(!clk_cache_valid)
+		RCC_update_clock_cache();
+	return pclk2_hz;
+}
+
+/*
+ * @func:			RCC_update_clock_cache
+ *
+ * @brief:			This function reads the clock tree from the RCC registers and caches SYSCLK, HCLK, PCLK1 and PCLK2
+ *
+ * @return:			none
+ */
+void RCC_update_clock_cache(void)
+{
+	uint32_t pll_in, vco, div;
 
 	//find system clock source speed
-	uint32_t clk_src = (RCC->CFGR >> 2) & 0b11;
-	if(clk_src == 0){	//HSI
-		system_clk = 16000000;
+	uint32_t clk_src = (RCC->CFGR >> RCC_CFGR_SWS) & 0b11;
+	if(clk_src == 0)		//HSI
+	{
+		sysclk_hz = HSI_CLOCK;
 	}
-	else if (clk_src == 1)	//HSE
+	else if(clk_src == 1)	//HSE
 	{
-		system_clk = 8000000;
+		sysclk_hz = HSE_CLOCK;
 	}
-	else
+	else					//PLL_P (2) or PLL_R (3)
+	{
+		uint32_t pllcfgr = RCC->PLLCFGR;
+		pll_in = ( (pllcfgr >> RCC_PLLCFGR_PLLSRC) & 1 ) ? HSE_CLOCK : HSI_CLOCK;
+		vco = (pll_in / ((pllcfgr >> RCC_PLLCFGR_PLLM) & 0x3F)) * ((pllcfgr >> RCC_PLLCFGR_PLLN) & 0x1FF);
+		if(clk_src == 2)
+			div = ( ((pllcfgr >> RCC_PLLCFGR_PLLP) & 0x3) + 1 ) * 2;
+		else
+			div = (pllcfgr >> RCC_PLLCFGR_PLLR) & 0x7;
+		//PLLR 0 and 1 are reserved, keep the last good figures instead of dividing by them
+		if(div < 2)
+			return;
+		sysclk_hz = vco / div;
+	}
+
+	hclk_hz = sysclk_hz / RCC_ahb_div((RCC->CFGR >> RCC_CFGR_HPRE) & 0xF);
+	pclk1_hz = hclk_hz / RCC_apb_div((RCC->CFGR >> RCC_CFGR_PPRE1) & 0x7);
+	pclk2_hz = hclk_hz / RCC_apb_div((RCC->CFGR >> RCC_CFGR_PPRE2) & 0x7);
+
+	clk_cache_valid = 1;
+}
+
+/*
+ * private helper functions
+ */
+
+static uint8_t RCC_wait_flag(volatile uint32_t *p_reg, uint8_t flag_bit, uint8_t val)
+{
+	for(uint32_t i = 0; i < RCC_READY_TIMEOUT; i++)
 	{
-		// PLL not supported, assume HSI as fallback
-		system_clk = 16000000;
+		if( ((*p_reg >> flag_bit) & 1) == val )
+			return 0;
 	}
-	//find AHB prescalar
-	uint32_t HPRE = (RCC->CFGR >> 4) & 0b1111;
+	return 1;
+}
+
+static uint32_t RCC_ahb_div(uint8_t HPRE)
+{
+	static const uint32_t possible_pscals[] = {2,4,8,16,64,128,256,512};
 	if(HPRE < 8) 	//vals below 0b1000 are all not divided by
-		AHB_pscal = 1;
-	else			//vals at 0b1000 and above are divided by
-		AHB_pscal = possible_pscals[HPRE - 8];
-
-	//find APB2 prescalar, I2C peripherals all under APB2
-	uint32_t PPRE2 = (RCC->CFGR >> 13) & 0b111;
-	if(PPRE2 < 4)
-		APB2_pscal = 1;
-	else
-		APB2_pscal = possible_pscals[PPRE2 - 4];
+		return 1;
+	return possible_pscals[HPRE - 8];	//vals at 0b1000 and above are divided by
+}
+
+static uint32_t RCC_apb_div(uint8_t PPRE)
+{
+	if(PPRE < 4)
+		return 1;
+	return (1U << (PPRE - 3));	//0b100 = 2, 0b101 = 4, 0b110 = 8, 0b111 = 16
+}
+
+static uint8_t RCC_switch_sysclk(uint8_t clk_src)
+{
+	uint32_t temp = RCC->CFGR;
+	temp &= ~(0x3 << RCC_CFGR_SW);
+	temp |= (clk_src << RCC_CFGR_SW);
+	RCC->CFGR = temp;
 
-	return (system_clk / AHB_pscal) / APB2_pscal;
+	//wait until the hardware reports the new source in SWS
+	for(uint32_t i = 0; i < RCC_READY_TIMEOUT; i++)
+	{
+		if( ((RCC->CFGR >> RCC_CFGR_SWS) & 0x3) == clk_src )
+			return 0;
+	}
+	return 1;
+}
+
+static void RCC_set_flash_latency(uint32_t hclk)
+{
+	uint32_t latency = (hclk - 1) / RCC_FLASH_WS_STEP;
+
+	//the caches can only be reset while they are disabled, only needed the first time they get enabled
+	if( !((FLASH_INTF->ACR >> FLASH_ACR_ICEN) & 1) )
+	{
+		FLASH_INTF->ACR &= ~(1 << FLASH_ACR_DCEN);
+		FLASH_INTF->ACR |= (1 << FLASH_ACR_ICRST) | (1 << FLASH_ACR_DCRST);
+		FLASH_INTF->ACR &= ~( (1 << FLASH_ACR_ICRST) | (1 << FLASH_ACR_DCRST) );
+	}
+
+	//new latency + ART accelerator (prefetch, instruction and data caches)
+	uint32_t temp = FLASH_INTF->ACR;
+	temp &= ~(0xF << FLASH_ACR_LATENCY);
+	temp |= (latency << FLASH_ACR_LATENCY);
+	temp |= (1 << FLASH_ACR_PRFTEN) | (1 << FLASH_ACR_ICEN) | (1 << FLASH_ACR_DCEN);
+	FLASH_INTF->ACR = temp;
+
+	//the new latency must be in effect before the clock changes
+	while( ((FLASH_INTF->ACR >> FLASH_ACR_LATENCY) & 0xF) != latency );
+}
+
+static uint32_t RCC_src_freq(uint8_t clk_src)
+{
+	uint32_t pllcfgr, pll_in;
+
+	if(clk_src == RCC_SYSCLK_SRC_HSI)
+		return HSI_CLOCK;
+	if(clk_src == RCC_SYSCLK_SRC_HSE)
+		return HSE_CLOCK;
+
+	//PLL_P output
+	pllcfgr = RCC->PLLCFGR;
+	pll_in = ( (pllcfgr >> RCC_PLLCFGR_PLLSRC) & 1 ) ? HSE_CLOCK : HSI_CLOCK;
+	return ( (pll_in / ((pllcfgr >> RCC_PLLCFGR_PLLM) & 0x3F)) * ((pllcfgr >> RCC_PLLCFGR_PLLN) & 0x1FF) ) /
+			( ( ((pllcfgr >> RCC_PLLCFGR_PLLP) & 0x3) + 1 ) * 2 );
+}
+
+static void RCC_notify_clk_change(uint8_t phase)
+{
+	for(uint8_t i = 0; i < RCC_MAX_CLK_CHANGE_CB; i++)
+	{
+		if(clk_change_cb[i] != NULL)
+		{
+			clk_change_cb[i](phase, clk_change_ctx[i]);
+		}
+	}
+}
+
+/*
+ * over-drive on/off, only while the system clock is HSI or HSE, returns 1 on a ready flag timeout
+ */
+static uint8_t RCC_overdrive_on(void)
+{
+	PWR_PCLK_EN();
+	PWR->CR |= (1 << PWR_CR_ODEN);
+	if(RCC_wait_flag(&PWR->CSR, PWR_CSR_ODRDY, 1))
+		return 1;
+	PWR->CR |= (1 << PWR_CR_ODSWEN);
+	return RCC_wait_flag(&PWR->CSR, PWR_CSR_ODSWRDY, 1);
+}
+
+static uint8_t RCC_overdrive_off(void)
+{
+	PWR_PCLK_EN();
+	if( !(PWR->CR & (1 << PWR_CR_ODEN)) )
+		return 0;
+	//ODSWEN has to be cleared before ODEN
+	PWR->CR &= ~(1 << PWR_CR_ODSWEN);
+	if(RCC_wait_flag(&PWR->CSR, PWR_CSR_ODSWRDY, 0))
+		return 1;
+	PWR->CR &= ~(1 << PWR_CR_ODEN);
+	return 0;
 }
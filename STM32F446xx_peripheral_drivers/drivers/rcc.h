@@ -10,9 +10,130 @@
 
 #include "STM32F446xx.h"
 
-uint32_t RCC_get_pclk1(void);
+/*
+ * oscillator frequencies
+ */
+#define HSI_CLOCK	16000000U
+#ifndef HSE_CLOCK
+#define HSE_CLOCK	8000000U		//nucleo boards feed HSE with the 8MHz MCO of the ST-LINK
+#endif
+
+/*
+ * clock tree configuration structure
+ */
+typedef struct
+{
+	uint8_t 	RCC_sysclk_src;			//!< possible values from @RCC_SYSCLK_SRC
+	uint8_t 	RCC_PLL_src;			//!< possible values from @RCC_PLL_SRC
+	uint8_t 	RCC_PLL_M;				//PLL input divider (2 to 63), PLL source / M must be 1 to 2MHz
+	uint16_t 	RCC_PLL_N;				//VCO multiplier (50 to 432), VCO output should be 100 to 432MHz
+	uint8_t 	RCC_PLL_P;				//!< possible values from @RCC_PLL_P
+	uint8_t 	RCC_PLL_Q;				//USB/SDIO divider (2 to 15)
+	uint8_t 	RCC_AHB_pscal;			//!< possible values from @RCC_AHB_PSCAL
+	uint8_t 	RCC_APB1_pscal;			//!< possible values from @RCC_APB_PSCAL
+	uint8_t 	RCC_APB2_pscal;			//!< possible values from @RCC_APB_PSCAL
+	uint8_t 	RCC_HSE_bypass;			//ENABLE if HSE is an external clock signal instead of a crystal
+}RCC_config_t;
+
+/*
+ * @RCC_SYSCLK_SRC
+ */
+#define RCC_SYSCLK_SRC_HSI		0
+#define RCC_SYSCLK_SRC_HSE		1
+#define RCC_SYSCLK_SRC_PLL		2
+
+/*
+ * @RCC_PLL_SRC
+ */
+#define RCC_PLL_SRC_HSI			0
+#define RCC_PLL_SRC_HSE			1
+
+/*
+ * @RCC_PLL_P
+ */
+#define RCC_PLL_P_DIV2			0
+#define RCC_PLL_P_DIV4			1
+#define RCC_PLL_P_DIV6			2
+#define RCC_PLL_P_DIV8			3
+
+/*
+ * @RCC_AHB_PSCAL
+ */
+#define RCC_AHB_DIV1			0
+#define RCC_AHB_DIV2			8
+#define RCC_AHB_DIV4			9
+#define RCC_AHB_DIV8			10
+#define RCC_AHB_DIV16			11
+#define RCC_AHB_DIV64			12
+#define RCC_AHB_DIV128			13
+#define RCC_AHB_DIV256			14
+#define RCC_AHB_DIV512			15
+
+/*
+ * @RCC_APB_PSCAL
+ */
+#define RCC_APB_DIV1			0
+#define RCC_APB_DIV2			4
+#define RCC_APB_DIV4			5
+#define RCC_APB_DIV8			6
+#define RCC_APB_DIV16			7
+
+/*
+ * limits of the clock tree (voltage scale 1, 2.7V to 3.6V supply)
+ */
+#define RCC_MAX_SYSCLK			180000000U
+#define RCC_MAX_SYSCLK_NO_OD	168000000U		//HCLK above this needs over-drive mode, at or below it over-drive is left
+#define RCC_MAX_PCLK1			45000000U
+#define RCC_MAX_PCLK2			90000000U
+#define RCC_FLASH_WS_STEP		30000000U		//one flash wait state per 30MHz of HCLK
+
+/*
+ * RCC_clock_config return values
+ */
+#define RCC_CONFIG_OK			0
+#define RCC_CONFIG_ERR_PARAM	1
+#define RCC_CONFIG_ERR_TIMEOUT	2
+
+#define RCC_READY_TIMEOUT		100000U		//loops to wait for an oscillator/PLL/over-drive ready flag
+
+/*
+ * @RCC_CLK_CHANGE_PHASE
+ * clock change notification phases
+ */
+#define RCC_CLK_CHANGE_PRE		0		//clock is about to change, finish or pause clock dependent work
+#define RCC_CLK_CHANGE_POST		1		//clock has changed, recompute dividers from RCC_get_pclk1/2 or RCC_get_hclk
+
+#define RCC_MAX_CLK_CHANGE_CB	8		//max number of registered clock change callbacks
+
+/*
+ * clock change callback, phase is from @RCC_CLK_CHANGE_PHASE and p_context is the pointer given at registration
+ * (usually the Handle of the peripheral)
+ */
+typedef void (*RCC_clk_change_cb_t)(uint8_t phase, void *p_context);
 
+
+/**************************APIs**************************/
+
+/*
+ * clock tree configuration
+ */
+uint8_t RCC_clock_config(RCC_config_t *p_RCC_config);
+uint8_t RCC_set_sysclk_src(uint8_t clk_src);
+
+/*
+ * clock change notification
+ */
+uint8_t RCC_register_clk_change(RCC_clk_change_cb_t p_callback, void *p_context);
+void RCC_unregister_clk_change(RCC_clk_change_cb_t p_callback, void *p_context);
+
+/*
+ * clock frequencies
+ */
+uint32_t RCC_get_sysclk(void);
+uint32_t RCC_get_hclk(void);
+uint32_t RCC_get_pclk1(void);
 uint32_t RCC_get_pclk2(void);
+void RCC_update_clock_cache(void);
 
 
 #endif /* DRIVERS_RCC_H_ */
@@ -0,0 +1,366 @@
+/*
+ * spi_bus.c
+ *
+ *  Created on: Jan 24, 2026
+ *      Author: krisko
+ */
+
+#include "spi_bus.h"
+
+//private helper functions
+static void SPI_bus_event(uint8_t event, void *p_context);
+static void SPI_bus_start(SPI_bus_t *p_bus);
+static void SPI_bus_configure(SPI_bus_t *p_bus, SPI_device_t *p_device);
+static void SPI_bus_CS(SPI_device_t *p_device, uint8_t select);
+static uint8_t SPI_bus_check_len(SPI_bus_t *p_bus, uint32_t len, uint8_t DFF);
+
+/*
+ * @func:			SPI_bus_init
+ *
+ * @brief:			This function sets up the given SPI peripheral as a bus shared by several devices
+ *
+ * @param[in]:		address of the SPI bus structure
+ * @param[in]:		address of SPI Handle structure, p_SPIx set, SPI_DMA_init may be called before or after
+ *
+ * @return:			none
+ *
+ * @note:			the peripheral is set up as full-duplex master with software NSS held high, the devices have
+ * 					their own chip select, speed, DFF, CPOL and CPHA come from the device of each transaction
+ * 					the SPI events of the Handle go to the bus from now on, not to SPI_event_callback
+ * 					with DMA (p_Tx_DMA and p_Rx_DMA set) the data moves by DMA, else by interrupts, the SPI IRQ
+ * 					(and the stream IRQs) should have the same priority
+ */
+void SPI_bus_init(SPI_bus_t *p_bus, SPI_Handle_t *p_SPI_Handle)
+{
+	p_bus->p_SPI_Handle = p_SPI_Handle;
+	p_bus->p_head = NULL;
+	p_bus->p_tail = NULL;
+	p_bus->p_config_device = NULL;
+	p_bus->p_CS_device = NULL;
+	p_bus->running = 0;
+
+	p_SPI_Handle->SPI_config.SPI_device_mode = SPI_DEVICE_MODE_MASTER;
+	p_SPI_Handle->SPI_config.SPI_bus_config = SPI_BUS_CONFIG_FD;
+	p_SPI_Handle->SPI_config.SPI_SSM = SPI_SSM_EN;
+	SPI_init(p_SPI_Handle);
+	SPI_SSI_config(p_SPI_Handle->p_SPIx, ENABLE);
+
+	p_SPI_Handle->p_callback = SPI_bus_event;
+	p_SPI_Handle->p_context = p_bus;
+
+	SPI_periph_control(p_SPI_Handle->p_SPIx, ENABLE);
+}
+
+/*
+ * @func:			SPI_bus_device_init
+ *
+ * @brief:			This function sets up the chip select pin of a device as a deselected (high) output
+ *
+ * @param[in]:		address of the SPI device structure
+ *
+ * @return:			none
+ */
+void SPI_bus_device_init(SPI_device_t *p_device)
+{
+	GPIO_Handle_t CS_pin;
+
+	if(p_device->p_CS_port == NULL)
+	{
+		return;
+	}
+
+	//drive the pin high before it becomes an output, so the device does not see a select
+	GPIO_clock_control(p_device->p_CS_port, ENABLE);
+	SPI_bus_CS(p_device, DISABLE);
+
+	CS_pin.p_GPIOx = p_device->p_CS_port;
+	CS_pin.GPIO_config.GPIO_pin_num = p_device->CS_pin;
+	CS_pin.GPIO_config.GPIO_pin_mode = GPIO_MODE_OUT;
+	CS_pin.GPIO_config.GPIO_pin_speed = GPIO_OUT_SPEED_FAST;
+	CS_pin.GPIO_config.GPIO_pin_pupd = GPIO_PIN_NO_PUPD;
+	CS_pin.GPIO_config.GPIO_pin_out_type = GPIO_OUT_TYPE_PP;
+	CS_pin.GPIO_config.GPIO_pin_alt_fcn_mode = 0;
+	GPIO_init(&CS_pin);
+}
+
+/*
+ * @func:			SPI_bus_submit
+ *
+ * @brief:			This function queues a transaction, it starts right away if the bus is idle
+ *
+ * @param[in]:		address of the SPI bus structure
+ * @param[in]:		address of the transaction, p_device, buffers, len, flags and p_callback set
+ *
+ * @return:			1 -> queued, 0 -> rejected (len or a segment of 0 bytes, not whole frames, or over 65535 frames
+ * 					with DMA), the SPI driver would refuse to start it and the queue would stop
+ *
+ * @note:			callable from tasks and interrupt handlers, it never waits, transactions run in submit order
+ * 					the next transaction is started from the interrupt that ends the current one, before its
+ * 					callback, the SPI peripheral is only set up again when the device settings change
+ * 					for a command followed by data on the same chip select, submit both (the first with
+ * 					SPI_BUS_KEEP_CS) before the first one ends, or use one transaction with segments (p_seg, seg_count)
+ */
+uint8_t SPI_bus_submit(SPI_bus_t *p_bus, SPI_bus_xfer_t *p_xfer)
+{
+	uint32_t primask;
+	uint8_t DFF;
+
+	if(p_xfer->seg_count > 0)
+	{
+		if(p_xfer->p_seg == NULL)
+		{
+			return 0;
+		}
+		for(uint8_t i = 0; i < p_xfer->seg_count; i++)
+		{
+			DFF = (p_xfer->p_seg[i].flags & SPI_SEG_DFF_16) ? SPI_DFF_16BITS :
+					((p_xfer->p_seg[i].flags & SPI_SEG_DFF_8) ? SPI_DFF_8BITS : p_xfer->p_device->SPI_DFF);
+			if(SPI_bus_check_len(p_bus, p_xfer->p_seg[i].len, DFF) == 0)
+			{
+				return 0;
+			}
+		}
+	}
+	else if(SPI_bus_check_len(p_bus, p_xfer->len, p_xfer->p_device->SPI_DFF) == 0)
+	{
+		return 0;
+	}
+
+	p_xfer->status = SPI_BUS_XFER_QUEUED;
+	p_xfer->p_next = NULL;
+
+	IRQ_SAVE_DISABLE(primask);
+
+	if(p_bus->p_tail == NULL)
+	{
+		p_bus->p_head = p_xfer;
+	}
+	else
+	{
+		p_bus->p_tail->p_next = p_xfer;
+	}
+	p_bus->p_tail = p_xfer;
+
+	SPI_bus_start(p_bus);
+
+	IRQ_RESTORE(primask);
+
+	return 1;
+}
+
+/*
+ * @func:			SPI_bus_busy
+ *
+ * @brief:			This function tells whether transactions are running or queued on the bus
+ *
+ * @param[in]:		address of the SPI bus structure
+ *
+ * @return:			1 -> busy, 0 -> idle
+ */
+uint8_t SPI_bus_busy(SPI_bus_t *p_bus)
+{
+	return (p_bus->p_head != NULL);
+}
+
+/*
+ * private helper functions
+ */
+
+/*
+ * SPI events of the bus Handle, SPI_EVENT_RX_CMPLT ends the running transaction (full-duplex, the last frame is in),
+ * SPI_EVENT_TX_CMPLT only matters when a start had to wait for the transmit side to close,
+ * SPI_EVENT_SEG_CMPLT toggles the chip select between scatter-gather segments
+ */
+static void SPI_bus_event(uint8_t event, void *p_context)
+{
+	SPI_bus_t *p_bus = (SPI_bus_t*)p_context;
+	SPI_Handle_t *p_SPI_Handle = p_bus->p_SPI_Handle;
+	SPI_bus_xfer_t *p_xfer;
+	uint32_t primask;
+
+	IRQ_SAVE_DISABLE(primask);
+
+	p_xfer = p_bus->p_head;
+	if( (event == SPI_EVENT_SEG_CMPLT) && (p_bus->running) )
+	{
+		//deselect pulse between two segments, the clock is stopped
+		SPI_bus_CS(p_bus->p_CS_device, DISABLE);
+		for(volatile uint32_t i = 0; i < SPI_BUS_CS_HIGH_LOOPS; i++);
+		SPI_bus_CS(p_bus->p_CS_device, ENABLE);
+		IRQ_RESTORE(primask);
+		return;
+	}
+	if( (event == SPI_EVENT_TX_CMPLT) || (p_bus->running == 0) )
+	{
+		SPI_bus_start(p_bus);
+		IRQ_RESTORE(primask);
+		return;
+	}
+
+	if(event == SPI_EVENT_RX_CMPLT)
+	{
+		p_xfer->status = SPI_BUS_XFER_DONE;
+	}
+	else
+	{
+		//overrun or DMA error, abort both directions
+		SPI_close_transmission(p_SPI_Handle);
+		SPI_close_reception(p_SPI_Handle);
+		SPI_clear_OVR_flag(p_SPI_Handle);
+		p_xfer->status = SPI_BUS_XFER_ERR;
+	}
+	p_bus->running = 0;
+
+	p_bus->p_head = p_xfer->p_next;
+	if(p_bus->p_head == NULL)
+	{
+		p_bus->p_tail = NULL;
+	}
+
+	//deselect, unless the next transaction continues on the same chip select
+	if( !( (p_xfer->flags & SPI_BUS_KEEP_CS) && (p_bus->p_head != NULL) && (p_bus->p_head->p_device == p_xfer->p_device) ) )
+	{
+		SPI_bus_CS(p_bus->p_CS_device, DISABLE);
+		p_bus->p_CS_device = NULL;
+	}
+
+	SPI_bus_start(p_bus);
+
+	IRQ_RESTORE(primask);
+
+	if(p_xfer->p_callback)
+	{
+		p_xfer->p_callback(p_xfer);
+	}
+}
+
+/*
+ * starts the transaction at the head of the queue if nothing is running, called with interrupts masked
+ */
+static void SPI_bus_start(SPI_bus_t *p_bus)
+{
+	SPI_Handle_t *p_SPI_Handle = p_bus->p_SPI_Handle;
+	SPI_bus_xfer_t *p_xfer = p_bus->p_head;
+
+	if( (p_bus->running) || (p_xfer == NULL) )
+	{
+		return;
+	}
+
+	//the transmit side closes on its own interrupt, SPI_EVENT_TX_CMPLT tries again
+	if( (p_SPI_Handle->Tx_state != SPI_STATE_READY) || (p_SPI_Handle->Rx_state != SPI_STATE_READY) )
+	{
+		return;
+	}
+
+	if(p_bus->p_config_device != p_xfer->p_device)
+	{
+		SPI_bus_configure(p_bus, p_xfer->p_device);
+	}
+
+	if(p_bus->p_CS_device != p_xfer->p_device)
+	{
+		SPI_bus_CS(p_bus->p_CS_device, DISABLE);
+		SPI_bus_CS(p_xfer->p_device, ENABLE);
+		p_bus->p_CS_device = p_xfer->p_device;
+	}
+
+	p_xfer->status = SPI_BUS_XFER_RUNNING;
+	p_bus->running = 1;
+
+	if( (p_SPI_Handle->p_Tx_DMA != NULL) && (p_SPI_Handle->p_Rx_DMA != NULL) )
+	{
+		if(p_xfer->seg_count > 0)
+		{
+			SPI_transfer_sg_DMA(p_SPI_Handle, p_xfer->p_seg, p_xfer->seg_count);
+		}
+		else
+		{
+			SPI_transfer_DMA(p_SPI_Handle, p_xfer->p_Tx_buffer, p_xfer->p_Rx_buffer, p_xfer->len);
+		}
+	}
+	else if(p_xfer->seg_count > 0)
+	{
+		SPI_transfer_sg_IT(p_SPI_Handle, p_xfer->p_seg, p_xfer->seg_count);
+	}
+	else
+	{
+		SPI_transfer_IT(p_SPI_Handle, p_xfer->p_Tx_buffer, p_xfer->p_Rx_buffer, p_xfer->len);
+	}
+}
+
+/*
+ * switches the SPI peripheral to the settings of the given device, CR1 is written with SPE cleared
+ */
+static void SPI_bus_configure(SPI_bus_t *p_bus, SPI_device_t *p_device)
+{
+	SPI_Handle_t *p_SPI_Handle = p_bus->p_SPI_Handle;
+	uint8_t DFF_change = (p_SPI_Handle->SPI_config.SPI_DFF != p_device->SPI_DFF);
+
+	//the last frame of the previous transaction has to be off the wire
+	while(SPI_get_flag_status(p_SPI_Handle->p_SPIx, SPI_SR_BSY));
+	SPI_periph_control(p_SPI_Handle->p_SPIx, DISABLE);
+
+	p_SPI_Handle->SPI_config.SPI_sclk_speed = p_device->SPI_sclk_speed;
+	p_SPI_Handle->SPI_config.SPI_DFF = p_device->SPI_DFF;
+	p_SPI_Handle->SPI_config.SPI_CPOL = p_device->SPI_CPOL;
+	p_SPI_Handle->SPI_config.SPI_CPHA = p_device->SPI_CPHA;
+	SPI_init(p_SPI_Handle);
+
+	SPI_periph_control(p_SPI_Handle->p_SPIx, ENABLE);
+
+	//the DMA data size follows DFF
+	if( DFF_change && (p_SPI_Handle->p_Tx_DMA != NULL) && (p_SPI_Handle->p_Rx_DMA != NULL) )
+	{
+		SPI_DMA_init(p_SPI_Handle, p_SPI_Handle->p_Tx_DMA, p_SPI_Handle->p_Rx_DMA);
+	}
+
+	p_bus->p_config_device = p_device;
+}
+
+/*
+ * drives the chip select of the device, ENABLE -> low (selected), BSRR so other pins of the port are not touched
+ */
+static void SPI_bus_CS(SPI_device_t *p_device, uint8_t select)
+{
+	if( (p_device == NULL) || (p_device->p_CS_port == NULL) )
+	{
+		return;
+	}
+
+	if(select == ENABLE)
+	{
+		p_device->p_CS_port->BSRR = (1U << (p_device->CS_pin + 16));
+	}
+	else
+	{
+		p_device->p_CS_port->BSRR = (1U << p_device->CS_pin);
+	}
+}
+
+/*
+ * 1 -> the SPI driver takes a transfer of len bytes: whole frames, at least one, at most 65535 with DMA (NDTR)
+ */
+static uint8_t SPI_bus_check_len(SPI_bus_t *p_bus, uint32_t len, uint8_t DFF)
+{
+	SPI_Handle_t *p_SPI_Handle = p_bus->p_SPI_Handle;
+	uint32_t frames = len;
+
+	if(DFF == SPI_DFF_16BITS)
+	{
+		if(len & 1)
+		{
+			return 0;
+		}
+		frames = len / 2;
+	}
+	if(frames == 0)
+	{
+		return 0;
+	}
+	if( (p_SPI_Handle->p_Tx_DMA != NULL) && (p_SPI_Handle->p_Rx_DMA != NULL) && (frames > 0xFFFFU) )
+	{
+		return 0;
+	}
+	return 1;
+}
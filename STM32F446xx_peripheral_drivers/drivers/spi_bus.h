@@ -0,0 +1,101 @@
+/*
+ * spi_bus.h
+ *
+ *  Created on: Jan 24, 2026
+ *      Author: krisko
+ */
+
+#ifndef DRIVERS_SPI_BUS_H_
+#define DRIVERS_SPI_BUS_H_
+
+#include "SPI_driver.h"
+#include "GPIO_driver.h"
+
+/*
+ * device on a shared SPI bus, the bus switches the SPI peripheral to these settings before a transaction
+ */
+typedef struct
+{
+	GPIO_reg_t	*p_CS_port;			//chip select port, active low, NULL -> no chip select
+	uint8_t		CS_pin;				//!< possible values from @GPIO_PIN_NUMBERS
+	uint8_t		SPI_sclk_speed;		//!< possible values from @SPI_SCLK_SPEEDS
+	uint8_t		SPI_DFF;			//!< possible values from @SPI_DFF
+	uint8_t		SPI_CPOL;			//!< possible values from @SPI_CPOL
+	uint8_t		SPI_CPHA;			//!< possible values from @SPI_CPHA
+}SPI_device_t;
+
+/*
+ * busy loop iterations the chip select stays high for SPI_SEG_CS_TOGGLE (device minimum deselect time)
+ */
+#ifndef SPI_BUS_CS_HIGH_LOOPS
+#define SPI_BUS_CS_HIGH_LOOPS	8U
+#endif
+
+typedef struct SPI_bus_xfer SPI_bus_xfer_t;
+
+/*
+ * transaction done callback, called from the SPI or DMA interrupt after the next transaction was started
+ */
+typedef void (*SPI_bus_cb_t)(SPI_bus_xfer_t *p_xfer);
+
+/*
+ * transaction, owned by the bus from SPI_bus_submit until its callback (or status DONE/ERR)
+ */
+struct SPI_bus_xfer
+{
+	SPI_device_t	*p_device;
+	uint8_t			*p_Tx_buffer;		//NULL -> SPI_FILL_PATTERN is sent
+	uint8_t			*p_Rx_buffer;		//NULL -> the received data is dropped
+	uint32_t		len;				//bytes, up to 65535 frames when the SPI Handle has DMA
+	const SPI_segment_t	*p_seg;			//scatter-gather segments, used instead of the buffers and len
+	uint8_t			seg_count;			//0 -> single buffer transaction
+	uint8_t			flags;				//!< possible values from @SPI_BUS_FLAGS
+	volatile uint8_t status;			//!< possible values from @SPI_BUS_STATUS, written by the bus
+	SPI_bus_cb_t	p_callback;			//NULL -> only status is updated
+	void			*p_context;			//application pointer
+	SPI_bus_xfer_t	*p_next;			//queue link, used by the bus
+};
+
+/*
+ * SPI bus, one per SPI peripheral
+ */
+typedef struct
+{
+	SPI_Handle_t	*p_SPI_Handle;
+	SPI_bus_xfer_t	*p_head;			//running transaction, then the queued ones in submit order
+	SPI_bus_xfer_t	*p_tail;
+	SPI_device_t	*p_config_device;	//device the SPI peripheral is set up for
+	SPI_device_t	*p_CS_device;		//device whose chip select is low
+	uint8_t			running;
+}SPI_bus_t;
+
+/*
+ * @SPI_BUS_FLAGS
+ */
+#define SPI_BUS_KEEP_CS			(1 << 0)	//chip select stays low if the next queued transaction is for the same device
+
+/*
+ * @SPI_BUS_STATUS
+ */
+#define SPI_BUS_XFER_QUEUED		0
+#define SPI_BUS_XFER_RUNNING	1
+#define SPI_BUS_XFER_DONE		2
+#define SPI_BUS_XFER_ERR		3		//SPI_EVENT_OVR_ERR or SPI_EVENT_DMA_ERR, the received data is not valid
+
+
+/**************************APIs**************************/
+
+/*
+ * initialize
+ */
+void SPI_bus_init(SPI_bus_t *p_bus, SPI_Handle_t *p_SPI_Handle);
+void SPI_bus_device_init(SPI_device_t *p_device);
+
+/*
+ * transactions
+ */
+uint8_t SPI_bus_submit(SPI_bus_t *p_bus, SPI_bus_xfer_t *p_xfer);
+uint8_t SPI_bus_busy(SPI_bus_t *p_bus);
+
+
+#endif /* DRIVERS_SPI_BUS_H_ */
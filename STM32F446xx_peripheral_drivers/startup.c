@@ -6,12 +6,20 @@
 
 #define STACK_START SRAM_END
 
+//debug registers used to time the boot from reset to main()
+#define DEMCR       (*(volatile uint32_t*)0xE000EDFCU)
+#define DWT_CTRL    (*(volatile uint32_t*)0xE0001000U)
+#define DWT_CYCCNT  (*(volatile uint32_t*)0xE0001004U)
+
 extern uint32_t _ebss;
 extern uint32_t _edata;
 extern uint32_t _sbss;
 extern uint32_t _sdata; //start of .data in VMA
 extern uint32_t _sidata; //start of .data in LMA
 
+//number of CPU cycles from the first instruction of Reset_Handler to the call of main()
+uint32_t g_boot_cycles;
+
 int main(void);
 void __libc_init_array(void);
 
@@ -228,30 +236,76 @@ uint32_t vectors[] __attribute__ ((section(".isr_vector"))) = {
     (uint32_t) &FMPI2C1_error_IRQHandler,
 };
 
+/*
+ * copy/zero helpers for Reset_Handler
+ * note:
+ * 		the loops are written in assembly so they move 16 bytes per iteration with LDMIA/STMIA bursts no matter
+ * 		what -O level the file is built with (at -O0 the plain C loop reloads the pointers from the stack every word).
+ * 		the tail (less than 16 bytes) is done one word at a time, the sections are always 4-byte aligned by the linker script
+ */
+static inline __attribute__((always_inline)) void copy_words(uint32_t *p_dst, uint32_t *p_src, uint32_t bytes)
+{
+    __asm volatile(
+        "1: subs  %[n], %[n], #16       \n"
+        "   blo   2f                    \n"
+        "   ldmia %[s]!, {r3-r6}        \n"
+        "   stmia %[d]!, {r3-r6}        \n"
+        "   b     1b                    \n"
+        "2: adds  %[n], %[n], #16       \n"
+        "3: subs  %[n], %[n], #4        \n"
+        "   blo   4f                    \n"
+        "   ldr   r3, [%[s]], #4        \n"
+        "   str   r3, [%[d]], #4        \n"
+        "   b     3b                    \n"
+        "4:                             \n"
+        : [s] "+r" (p_src), [d] "+r" (p_dst), [n] "+r" (bytes)
+        :
+        : "r3", "r4", "r5", "r6", "cc", "memory");
+}
+
+static inline __attribute__((always_inline)) void zero_words(uint32_t *p_dst, uint32_t bytes)
+{
+    __asm volatile(
+        "   movs  r3, #0                \n"
+        "   movs  r4, #0                \n"
+        "   movs  r5, #0                \n"
+        "   movs  r6, #0                \n"
+        "1: subs  %[n], %[n], #16       \n"
+        "   blo   2f                    \n"
+        "   stmia %[d]!, {r3-r6}        \n"
+        "   b     1b                    \n"
+        "2: adds  %[n], %[n], #16       \n"
+        "3: subs  %[n], %[n], #4        \n"
+        "   blo   4f                    \n"
+        "   str   r3, [%[d]], #4        \n"
+        "   b     3b                    \n"
+        "4:                             \n"
+        : [d] "+r" (p_dst), [n] "+r" (bytes)
+        :
+        : "r3", "r4", "r5", "r6", "cc", "memory");
+}
+
 void Reset_Handler(void)
 {
-    //copy .data to SRAM
-    uint32_t size = &_edata - &_sdata; // symbols store addresses so need &, there are no "value" at these addresses so excluding the & means we want the value at the address which don't make sense and will cause error
+    //start the cycle counter first so the boot time measurement covers everything below
+    DEMCR |= (1 << 24);     //TRCENA, enables the DWT unit
+    DWT_CYCCNT = 0;
+    DWT_CTRL |= (1 << 0);   //CYCCNTENA
 
-    uint32_t *p_src = (uint32_t*) &_sidata; // the address of the start of .data section in LMA or FLASH
-    uint32_t *p_dst = (uint32_t*) &_sdata; // the address of the start of .data section in VMA or SRAM
+    //copy .data to SRAM
+    // symbols store addresses so need &, there are no "value" at these addresses so excluding the & means we want the value at the address which don't make sense and will cause error
+    copy_words(&_sdata, &_sidata, (uint32_t)&_edata - (uint32_t)&_sdata);
 
-    for(int i = 0; i < size; i++)
-    {
-        *p_dst = *p_src;
-        p_dst++;
-        p_src++;
-    }
     //initialize .bss section to 0 in SRAM
-    size = &_ebss - &_sbss;
-    p_dst = (uint32_t*) &_sbss;
-    for(int i = 0; i < size; i++)
-    {
-        *p_dst = 0;
-        p_dst++;
-    }
+    //note: .noinit is placed outside of _sbss/_ebss so it keeps its content across resets
+    zero_words(&_sbss, (uint32_t)&_ebss - (uint32_t)&_sbss);
+
     //call init from std library 
     __libc_init_array();
+
+    //.bss is cleared by now so it is safe to store the result
+    g_boot_cycles = DWT_CYCCNT;
+
     //call main
     main();
 }
@@ -0,0 +1,188 @@
+/*
+ * port_posix.c
+ *
+ *  Created on: Jan 18, 2026
+ *      Author: krisko
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <ucontext.h>
+#include "main.h"
+#include "port.h"
+#include "scheduler.h"
+#include "kprintf.h"
+#include "sim.h"
+
+/*
+ * POSIX port of the kernel, replaces PendSV/PSP with swapcontext and SysTick with a virtual tick:
+ * the tick and the pended switch run on the context of the task they interrupt, like the exceptions on the target,
+ * swapcontext is only called when update_next_task picks another task or sim_run has to get control back
+ */
+
+volatile uint32_t g_sim_cycles; // low 32 bits of sim_now, the CYCCNT of the simulation
+
+static uint64_t sim_now; // virtual cycles since sim_init
+static uint64_t sim_next_tick;
+static uint32_t sim_cycles_per_tick;
+static uint32_t sim_end_tick; // sim_run returns when g_tick_count gets here
+static uint8_t sim_switch_pending;
+static uint8_t sim_in_task; // 1 while task code runs, 0 in the tick (the "exception") and in sim_run
+
+static ucontext_t sim_main_ctx;
+static ucontext_t sim_task_ctx[MAX_TASKS];
+
+static void sim_advance(uint64_t cycles)
+{
+	sim_now += cycles;
+	g_sim_cycles = (uint32_t)sim_now;
+}
+
+/*
+ * the PendSV of the simulation, the address of the frame stands in for the PSP so the stack check of
+ * save_psp_value still works
+ */
+static void sim_switch(void)
+{
+	uint32_t prev_task = current_task;
+
+	sim_switch_pending = 0;
+	save_psp_value((uintptr_t)__builtin_frame_address(0));
+	update_next_task();
+
+	if(g_tick_count == sim_end_tick)
+	{
+		//back to sim_run, it resumes current_task on the next call
+		sim_in_task = 0;
+		swapcontext(&sim_task_ctx[prev_task], &sim_main_ctx);
+	}
+	else if(current_task != prev_task)
+	{
+		swapcontext(&sim_task_ctx[prev_task], &sim_task_ctx[current_task]);
+	}
+	sim_in_task = 1;
+}
+
+/*
+ * the SysTick of the simulation, taken on the running task at a tick boundary
+ */
+static void sim_tick(void)
+{
+	sim_in_task = 0;
+	sim_next_tick += sim_cycles_per_tick;
+#if KERNEL_CONFIG_STATS
+	kernel_isr_enter();
+#endif
+	kernel_tick();
+#if KERNEL_CONFIG_STATS
+	kernel_isr_exit();
+#endif
+	sim_in_task = 1;
+
+	if(sim_switch_pending)
+	{
+		sim_switch();
+	}
+}
+
+static void sim_task_entry(void)
+{
+	sim_in_task = 1;
+	user_tasks[current_task].task_handler();
+	//tasks never return, same as on the target
+	k_printf("task %u returned\n", (unsigned)current_task);
+	abort();
+}
+
+uintptr_t port_init_task_frame(uint32_t task, uintptr_t stack_top, void (*task_handler)(void))
+{
+	(void)task_handler; // started through sim_task_entry from the TCD
+
+	getcontext(&sim_task_ctx[task]);
+	sim_task_ctx[task].uc_stack.ss_sp = (void*)(stack_top - TASK_STACK_SIZE + STACK_GUARD_SIZE);
+	sim_task_ctx[task].uc_stack.ss_size = TASK_STACK_SIZE - STACK_GUARD_SIZE;
+	sim_task_ctx[task].uc_link = NULL;
+	makecontext(&sim_task_ctx[task], sim_task_entry, 0);
+
+	return stack_top;
+}
+
+/*
+ * from a task (task_delay) the switch happens right away, from the tick it happens when the tick returns,
+ * like a pended PendSV that runs on exception return
+ */
+void port_pend_switch(void)
+{
+	sim_switch_pending = 1;
+	if(sim_in_task)
+	{
+		sim_switch();
+	}
+}
+
+void port_task_switched(uint32_t task)
+{
+	(void)task;
+}
+
+void port_stats_init(void)
+{
+}
+
+void sim_init(uint32_t cpu_hz, uint32_t tick_hz)
+{
+	sim_now = 0;
+	g_sim_cycles = 0;
+	sim_cycles_per_tick = cpu_hz / tick_hz;
+	sim_next_tick = sim_cycles_per_tick;
+}
+
+/*
+ * runs the tasks for the given number of ticks, can be called again to continue after checking the state
+ */
+void sim_run(uint32_t ticks)
+{
+	sim_end_tick = g_tick_count + ticks;
+
+	sim_in_task = 1;
+	swapcontext(&sim_main_ctx, &sim_task_ctx[current_task]);
+	sim_in_task = 0;
+}
+
+/*
+ * the calling task uses the CPU for the given number of cycles, ticks on the way preempt it
+ */
+void sim_work(uint32_t cycles)
+{
+	uint64_t left = cycles;
+
+	while(left >= sim_next_tick - sim_now)
+	{
+		left -= sim_next_tick - sim_now;
+		sim_advance(sim_next_tick - sim_now);
+		sim_tick();
+	}
+	sim_advance(left);
+}
+
+/*
+ * body of the idle task loop, nothing can happen before the next tick so skip to it
+ */
+void sim_idle(void)
+{
+	sim_advance(sim_next_tick - sim_now);
+	sim_tick();
+}
+
+uint64_t sim_get_cycles(void)
+{
+	return sim_now;
+}
+
+/*
+ * output of k_printf
+ */
+int _write(int file, char *ptr, int len)
+{
+	return (int)write(file, ptr, (size_t)len);
+}
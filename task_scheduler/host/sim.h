@@ -0,0 +1,33 @@
+/*
+ * sim.h
+ *
+ *  Created on: Jan 18, 2026
+ *      Author: krisko
+ */
+
+#ifndef HOST_SIM_H_
+#define HOST_SIM_H_
+
+#include <stdint.h>
+
+/*
+ * host simulation of the kernel (port_posix.c), every task runs on its own ucontext and only one context runs at a
+ * time, so the scheduler code runs unchanged:
+ * - time is virtual, it only moves when a task calls sim_work or the idle task calls sim_idle
+ * - the tick is taken when the virtual time reaches the next tick boundary, the running task is preempted there
+ *   exactly like SysTick + PendSV on the target
+ * - a task that neither blocks nor calls sim_work never gives the CPU back
+ */
+
+#define SIM_DEFAULT_CPU_HZ 180000000U
+
+/**************************APIs**************************/
+
+void sim_init(uint32_t cpu_hz, uint32_t tick_hz);
+void sim_run(uint32_t ticks);
+void sim_work(uint32_t cycles);
+void sim_idle(void);
+uint64_t sim_get_cycles(void);
+
+
+#endif /* HOST_SIM_H_ */
@@ -0,0 +1,623 @@
+/*
+ * sim_main.c
+ *
+ *  Created on: Jan 18, 2026
+ *      Author: krisko
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "main.h"
+#include "scheduler.h"
+#include "kprintf.h"
+#include "sim.h"
+
+/*
+ * scenarios for the host simulation, run as "sim <scenario>", the exit code is 0 when the checks pass:
+ * delay -> every task runs once per task_delay period
+ * stats -> kernel_get_stats reports the load each task was given
+ * rr    -> tasks that never block share the CPU equally through tick preemption
+ * stack -> stack high-water marks are found and stay below TASK_STACK_SIZE
+ * many  -> no starvation with MAX_TASKS tasks (build with -DMAX_TASKS=1000, make sim_many)
+ * edf   -> 3 tasks busy 30% of their period plus a background task, no deadline is missed (SCHED_POLICY_EDF,
+ *          make sim_edf)
+ * edf_overload -> busy 50% of their period, misses are detected and no task starves (SCHED_POLICY_EDF)
+ * tt    -> slot tasks run once per frame they are in, the first slot starts exactly at the frame tick and the
+ *          background tasks share the slack (SCHED_POLICY_TT, make sim_tt)
+ * tt_overrun -> a slot longer than its frame is counted as overrun and the next frame still starts on time
+ * budget -> a task that never blocks is held to its 20% budget and the periodic tasks get all their runs
+ *           (KERNEL_CONFIG_BUDGET, make sim_budget)
+ * budget_demote -> the same task demoted instead of suspended, it only gets the time the others leave idle
+ * sporadic -> a sporadic server handles bursts of aperiodic requests without using more than its budget
+ */
+
+#define SIM_TICKS 100000U
+
+static uint8_t task_stacks[MAX_TASKS][TASK_STACK_SIZE] __attribute__((aligned(16)));
+static task_config_t task_config[MAX_TASKS];
+static void (*scenario_task)(void);
+static uint32_t run_count[MAX_TASKS];
+static uint32_t cycles_per_tick;
+static int failures;
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_TT
+static const tt_schedule_t *p_sim_schedule; // set by the setup of the tt scenarios
+#endif
+
+static void check(int ok, const char *what, uint32_t task, uint32_t got, uint32_t expected)
+{
+	if(!ok)
+	{
+		k_printf("FAIL %s: task %lu got %lu expected %lu\n", what, (unsigned long)task, (unsigned long)got,
+				(unsigned long)expected);
+		failures++;
+	}
+}
+
+static void idle_task(void)
+{
+	while(1)
+	{
+#if KERNEL_CONFIG_STACK_CHECK
+		kernel_stack_scan();
+#endif
+		sim_idle();
+	}
+}
+
+static void worker_task(void)
+{
+	scenario_task();
+}
+
+/*
+ * delay: periods 1000, 500, 250 and 2000 ticks, some work in each period
+ */
+static const uint32_t delay_period[4] = { 1000, 500, 250, 2000 };
+
+static void delay_task(void)
+{
+	uint32_t period = delay_period[(current_task - 1) % 4];
+
+	while(1)
+	{
+		run_count[current_task]++;
+		sim_work(cycles_per_tick / 10);
+		task_delay(period);
+	}
+}
+
+static void delay_check(uint32_t ticks)
+{
+	for(uint32_t i = 1; i < MAX_TASKS; i++)
+	{
+		uint32_t expected = ticks / delay_period[(i - 1) % 4];
+		check((run_count[i] >= expected) && (run_count[i] <= expected + 1), "run count", i, run_count[i], expected);
+	}
+}
+
+/*
+ * stats: every tick task n works n * 10% of the tick (task 4 and up 5%), the rest is idle
+ */
+static uint32_t stats_share_permille(uint32_t task)
+{
+	return (task < 4) ? task * 100 : 50;
+}
+
+static void stats_task(void)
+{
+	while(1)
+	{
+		sim_work((cycles_per_tick / 1000) * stats_share_permille(current_task));
+		task_delay(1);
+	}
+}
+
+static void stats_check(uint32_t ticks)
+{
+#if KERNEL_CONFIG_STATS
+	kernel_stats_t stats;
+	uint32_t busy = 0;
+
+	(void)ticks;
+	kernel_get_stats(&stats);
+	for(uint32_t i = 1; i < MAX_TASKS; i++)
+	{
+		uint32_t expected = stats_share_permille(i);
+		busy += expected;
+		check((stats.load_permille[i] + 5 >= expected) && (stats.load_permille[i] <= expected + 5), "load",
+				i, stats.load_permille[i], expected);
+	}
+	check((stats.idle_permille + 5 >= 1000 - busy) && (stats.idle_permille <= 1000 - busy + 5), "idle load",
+			0, stats.idle_permille, 1000 - busy);
+#else
+	(void)ticks;
+#endif
+}
+
+/*
+ * rr: every task is always ready, round-robin at each tick gives each the same number of ticks
+ */
+static void rr_task(void)
+{
+	while(1)
+	{
+		run_count[current_task]++;
+		sim_work(cycles_per_tick / 7);
+	}
+}
+
+static void rr_check(uint32_t ticks)
+{
+	(void)ticks;
+#if KERNEL_CONFIG_STATS
+	kernel_stats_t stats;
+
+	kernel_get_stats(&stats);
+	for(uint32_t i = 1; i < MAX_TASKS; i++)
+	{
+		uint32_t expected = 1000 / (MAX_TASKS - 1);
+		check((stats.load_permille[i] + 2 >= expected) && (stats.load_permille[i] <= expected + 2), "rr load",
+				i, stats.load_permille[i], expected);
+	}
+	check(stats.idle_permille == 0, "idle load", 0, stats.idle_permille, 0);
+#endif
+}
+
+/*
+ * stack: task n recurses n levels with a 256 byte frame, the high-water mark grows with n
+ */
+static uint32_t stack_recurse(uint32_t depth)
+{
+	volatile uint8_t frame[256];
+
+	memset((void*)frame, (int)depth, sizeof(frame));
+	if(depth == 0)
+	{
+		return frame[0];
+	}
+	return stack_recurse(depth - 1) + frame[1];
+}
+
+static void stack_task(void)
+{
+	while(1)
+	{
+		run_count[current_task] += stack_recurse(current_task * 4);
+		task_delay(10);
+	}
+}
+
+static void stack_check(uint32_t ticks)
+{
+	(void)ticks;
+#if KERNEL_CONFIG_STACK_CHECK
+	uint32_t prev = 0;
+
+	for(uint32_t i = 1; i < MAX_TASKS; i++)
+	{
+		uint32_t used = kernel_get_stack_usage(i);
+		check((used > prev) && (used < TASK_STACK_SIZE), "stack usage", i, used, prev);
+		prev = used;
+		k_printf("task %lu stack %lu of %lu bytes\n", (unsigned long)i, (unsigned long)used,
+				(unsigned long)TASK_STACK_SIZE);
+	}
+#endif
+}
+
+/*
+ * many: task n has a period of 10 + n % 50 ticks, every task has to get all of its runs
+ */
+static uint32_t many_period(uint32_t task)
+{
+	return 10 + (task % 50);
+}
+
+static void many_task(void)
+{
+	while(1)
+	{
+		run_count[current_task]++;
+		sim_work(cycles_per_tick / 100);
+		task_delay(many_period(current_task));
+	}
+}
+
+static void many_check(uint32_t ticks)
+{
+	for(uint32_t i = 1; i < MAX_TASKS; i++)
+	{
+		uint32_t expected = ticks / many_period(i);
+		check(run_count[i] + 1 >= expected, "run count", i, run_count[i], expected);
+	}
+}
+
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_EDF
+/*
+ * edf: tasks 1-3 have deadline = period and use 30% of the CPU each, task 4 has no deadline and never blocks
+ */
+static const uint32_t edf_period[4] = { 0, 4, 6, 12 };
+static uint32_t edf_work_permille = 300;
+
+static void edf_task(void)
+{
+	uint32_t period = edf_period[(current_task < 4) ? current_task : 0];
+
+	while(1)
+	{
+		run_count[current_task]++;
+		if(period == 0)
+		{
+			//background, runs in the slack of the deadline tasks
+			sim_work(cycles_per_tick / 7);
+			continue;
+		}
+		sim_work((uint32_t)(((uint64_t)cycles_per_tick * period * edf_work_permille) / 1000));
+		task_delay(period);
+	}
+}
+
+static void edf_deadlines(void)
+{
+	for(uint32_t i = 1; i < 4; i++)
+	{
+		task_config[i].deadline = edf_period[i];
+	}
+}
+
+static void edf_check(uint32_t ticks)
+{
+	for(uint32_t i = 1; i < 4; i++)
+	{
+		//the next release is period ticks after the job ends, so a job takes at most 2 periods
+		uint32_t expected = ticks / (2 * edf_period[i]);
+		check(user_tasks[i].miss_count == 0, "deadline misses", i, user_tasks[i].miss_count, 0);
+		check(run_count[i] >= expected, "run count", i, run_count[i], expected);
+	}
+	check(run_count[4] > 0, "background runs", 4, run_count[4], 1);
+}
+
+static void edf_overload_deadlines(void)
+{
+	edf_deadlines();
+	edf_work_permille = 500;
+}
+
+static void edf_overload_check(uint32_t ticks)
+{
+	uint32_t misses = 0;
+
+	for(uint32_t i = 1; i < 4; i++)
+	{
+		//the fallback moves a late deadline on, so every task keeps getting jobs done
+		uint32_t expected = ticks / (10 * edf_period[i]);
+		misses += user_tasks[i].miss_count;
+		check(run_count[i] >= expected, "run count", i, run_count[i], expected);
+	}
+	check(misses > 0, "deadline misses", 0, misses, 1);
+}
+#endif
+
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_TT
+/*
+ * tt: 5 tick frames, frame 0 runs task 1 (1 tick of work) then task 2 (2 ticks), frame 1 runs task 1 only,
+ * tasks 3 and 4 are background
+ */
+#define TT_FRAME_TICKS 5U
+
+static const uint32_t tt_slots_0[] = { 1, 2 };
+static const uint32_t tt_slots_1[] = { 1 };
+static const uint32_t tt_background[] = { 3, 4 };
+static const tt_frame_t tt_frames[] = {
+	{ tt_slots_0, 2 },
+	{ tt_slots_1, 1 },
+};
+static const tt_schedule_t tt_schedule = {
+	.p_frames = tt_frames,
+	.frame_count = 2,
+	.frame_ticks = TT_FRAME_TICKS,
+	.p_background = tt_background,
+	.background_count = 2,
+};
+
+static uint32_t tt_work_ticks[3] = { 0, 1, 2 };
+static uint64_t tt_max_offset; // latest start of task 1 after its frame tick, in cycles
+static uint32_t tt_slack_ready; // background runs that found a slot task ready, only the table may release them
+
+static void tt_task(void)
+{
+	uint64_t frame_cycles = (uint64_t)cycles_per_tick * TT_FRAME_TICKS;
+	uint64_t offset;
+
+	while(1)
+	{
+		run_count[current_task]++;
+		if(current_task > 2)
+		{
+			if( (user_tasks[1].current_state == TASK_READY_STATE) || (user_tasks[2].current_state == TASK_READY_STATE) )
+			{
+				tt_slack_ready++;
+			}
+			sim_work(cycles_per_tick / 7);
+			continue;
+		}
+		if(current_task == 1)
+		{
+			offset = sim_get_cycles() % frame_cycles;
+			tt_max_offset = (offset > tt_max_offset) ? offset : tt_max_offset;
+		}
+		sim_work(cycles_per_tick * tt_work_ticks[current_task] - cycles_per_tick / 10);
+		task_delay(0);
+	}
+}
+
+static void tt_setup(void)
+{
+	p_sim_schedule = &tt_schedule;
+	//the tick count wraps at the start of frame 1, the slot tasks' block_count (0) must not release task 2 there
+	g_tick_count = 0U - (SIM_TICKS / 2) - TT_FRAME_TICKS;
+}
+
+static void tt_check(uint32_t ticks)
+{
+	check(run_count[1] + 1 >= ticks / TT_FRAME_TICKS, "slot runs", 1, run_count[1], ticks / TT_FRAME_TICKS);
+	check(run_count[2] + 1 >= ticks / (2 * TT_FRAME_TICKS), "slot runs", 2, run_count[2], ticks / (2 * TT_FRAME_TICKS));
+	check(tt_max_offset == 0, "first slot jitter", 1, (uint32_t)tt_max_offset, 0);
+	check(tt_slack_ready == 0, "slot task ready in the slack", 1, tt_slack_ready, 0);
+	check((user_tasks[1].overrun_count + user_tasks[2].overrun_count) == 0, "overruns", 0,
+			user_tasks[1].overrun_count + user_tasks[2].overrun_count, 0);
+	//slack per 10 ticks: 4 in frame 0 minus the slot work, 4 in frame 1, split between the two background tasks
+	check((run_count[3] > 0) && (run_count[4] + run_count[4] / 10 >= run_count[3]) &&
+			(run_count[3] + run_count[3] / 10 >= run_count[4]), "background share", 3, run_count[3], run_count[4]);
+}
+
+static void tt_overrun_setup(void)
+{
+	p_sim_schedule = &tt_schedule;
+	tt_work_ticks[2] = 6;
+}
+
+static void tt_overrun_check(uint32_t ticks)
+{
+	check(user_tasks[2].overrun_count > 0, "overruns", 2, user_tasks[2].overrun_count, 1);
+	check(user_tasks[1].overrun_count == 0, "overruns", 1, user_tasks[1].overrun_count, 0);
+	check(run_count[1] + 1 >= ticks / TT_FRAME_TICKS, "slot runs", 1, run_count[1], ticks / TT_FRAME_TICKS);
+	check(tt_max_offset == 0, "first slot jitter", 1, (uint32_t)tt_max_offset, 0);
+}
+#endif
+
+#if KERNEL_CONFIG_BUDGET
+/*
+ * budget: task 1 never blocks and has 20% of the CPU per 10 ticks, tasks 2-4 work 10% of a tick every 5 ticks
+ * sporadic: task 4 is a sporadic server with 10% per 20 ticks, every 50 ticks task 2 queues 20 requests of half a
+ * tick each (20% demand), task 3 is periodic
+ */
+#define BUDGET_PERIOD 10U
+#define BUDGET_PERMILLE 200U
+#define BUDGET_TASK_PERIOD 5U
+#define SS_PERIOD 20U
+#define SS_PERMILLE 100U
+#define SS_BURST_PERIOD 50U
+#define SS_BURST_REQUESTS 20U
+
+static volatile uint32_t ss_pending; // requests queued for the server
+static uint32_t ss_served;
+
+static void budget_task(void)
+{
+	while(1)
+	{
+		run_count[current_task]++;
+		if(current_task == 1)
+		{
+			sim_work(cycles_per_tick / 7);
+			continue;
+		}
+		sim_work(cycles_per_tick / 10);
+		task_delay(BUDGET_TASK_PERIOD);
+	}
+}
+
+static void budget_setup_mode(uint8_t mode)
+{
+	task_config[1].budget_cycles = (uint32_t)(((uint64_t)cycles_per_tick * BUDGET_PERIOD * BUDGET_PERMILLE) / 1000);
+	task_config[1].budget_period = BUDGET_PERIOD;
+	task_config[1].budget_mode = mode;
+}
+
+static void budget_setup(void)
+{
+	budget_setup_mode(BUDGET_MODE_SUSPEND);
+}
+
+static void budget_demote_setup(void)
+{
+	budget_setup_mode(BUDGET_MODE_DEMOTE);
+}
+
+static void budget_runs_check(uint32_t ticks, uint32_t first)
+{
+	for(uint32_t i = first; i < MAX_TASKS; i++)
+	{
+		uint32_t expected = ticks / BUDGET_TASK_PERIOD;
+		check((run_count[i] >= expected) && (run_count[i] <= expected + 1), "run count", i, run_count[i], expected);
+	}
+}
+
+static void budget_check(uint32_t ticks)
+{
+	budget_runs_check(ticks, 2);
+	//the budget is charged at the tick, so a period can overrun by up to one tick
+	check(user_tasks[1].exhaust_count + 1 >= ticks / BUDGET_PERIOD, "exhausted", 1, user_tasks[1].exhaust_count,
+			ticks / BUDGET_PERIOD);
+#if KERNEL_CONFIG_STATS
+	kernel_stats_t stats;
+
+	kernel_get_stats(&stats);
+	check((stats.load_permille[1] + 10 >= BUDGET_PERMILLE) &&
+			(stats.load_permille[1] <= BUDGET_PERMILLE + 1000 / BUDGET_PERIOD), "budget load", 1,
+			stats.load_permille[1], BUDGET_PERMILLE);
+#endif
+}
+
+static void budget_demote_check(uint32_t ticks)
+{
+	budget_runs_check(ticks, 2);
+	//the idle time a demoted task gets is not charged, at most the overrun of one tick is paid back
+	check(user_tasks[1].budget_left > -(int32_t)cycles_per_tick, "budget left", 1, (uint32_t)-user_tasks[1].budget_left,
+			cycles_per_tick);
+#if KERNEL_CONFIG_STATS
+	kernel_stats_t stats;
+
+	kernel_get_stats(&stats);
+	check(stats.idle_permille <= 5, "idle load", 0, stats.idle_permille, 0);
+#endif
+}
+
+static void sporadic_task(void)
+{
+	uint32_t next_burst = SS_BURST_PERIOD;
+
+	while(1)
+	{
+		run_count[current_task]++;
+		if(current_task == 4)
+		{
+			//server, works off the queue and waits for the next tick when it is empty
+			while(ss_pending)
+			{
+				sim_work(cycles_per_tick / 2);
+				ss_pending--;
+				ss_served++;
+			}
+			task_delay(1);
+		}
+		else if(current_task == 2)
+		{
+			ss_pending += SS_BURST_REQUESTS;
+			task_delay(next_burst - g_tick_count);
+			next_burst += SS_BURST_PERIOD;
+		}
+		else
+		{
+			sim_work(cycles_per_tick / 10);
+			task_delay(BUDGET_TASK_PERIOD);
+		}
+	}
+}
+
+static void sporadic_setup(void)
+{
+	task_config[4].budget_cycles = (uint32_t)(((uint64_t)cycles_per_tick * SS_PERIOD * SS_PERMILLE) / 1000);
+	task_config[4].budget_period = SS_PERIOD;
+	task_config[4].budget_mode = BUDGET_MODE_SPORADIC;
+}
+
+static void sporadic_check(uint32_t ticks)
+{
+	uint32_t expected = ticks / BUDGET_TASK_PERIOD;
+
+	check((run_count[1] >= expected) && (run_count[1] <= expected + 1), "run count", 1, run_count[1], expected);
+	check((run_count[3] >= expected) && (run_count[3] <= expected + 1), "run count", 3, run_count[3], expected);
+	//the server serves its budget per period, plus at most one tick (2 requests) of overrun per activation
+	expected = (ticks / SS_PERIOD) * ((SS_PERIOD * SS_PERMILLE * 2) / 1000);
+	check((ss_served + SS_BURST_REQUESTS >= expected) && (ss_served <= expected + (ticks / SS_PERIOD) * 2),
+			"served", 4, ss_served, expected);
+#if KERNEL_CONFIG_STATS
+	kernel_stats_t stats;
+
+	kernel_get_stats(&stats);
+	check(stats.load_permille[4] <= SS_PERMILLE + 1000 / SS_PERIOD, "server load", 4, stats.load_permille[4],
+			SS_PERMILLE);
+#endif
+}
+#endif
+
+typedef struct
+{
+	const char *name;
+	void (*task)(void);
+	void (*check)(uint32_t ticks);
+	void (*setup)(void); // optional, adjusts task_config before init_task_stack
+}scenario_t;
+
+static const scenario_t scenarios[] = {
+	{ "delay", delay_task, delay_check },
+	{ "stats", stats_task, stats_check },
+	{ "rr", rr_task, rr_check },
+	{ "stack", stack_task, stack_check },
+	{ "many", many_task, many_check },
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_EDF
+	{ "edf", edf_task, edf_check, edf_deadlines },
+	{ "edf_overload", edf_task, edf_overload_check, edf_overload_deadlines },
+#endif
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_TT
+	{ "tt", tt_task, tt_check, tt_setup },
+	{ "tt_overrun", tt_task, tt_overrun_check, tt_overrun_setup },
+#endif
+#if KERNEL_CONFIG_BUDGET
+	{ "budget", budget_task, budget_check, budget_setup },
+	{ "budget_demote", budget_task, budget_demote_check, budget_demote_setup },
+	{ "sporadic", sporadic_task, sporadic_check, sporadic_setup },
+#endif
+};
+
+int main(int argc, char *argv[])
+{
+	const scenario_t *p_scenario = NULL;
+	struct timespec start, end;
+	double seconds;
+
+	for(uint32_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+	{
+		if((argc > 1) && (strcmp(argv[1], scenarios[i].name) == 0))
+		{
+			p_scenario = &scenarios[i];
+		}
+	}
+	if(p_scenario == NULL)
+	{
+		k_printf("usage: %s delay|stats|rr|stack|many|edf|edf_overload|tt|tt_overrun|budget|\n"
+				"budget_demote|sporadic\n", argv[0]);
+		return 2;
+	}
+
+	scenario_task = p_scenario->task;
+	task_config[0].task_handler = idle_task;
+	task_config[0].stack_top = (uintptr_t)&task_stacks[0][TASK_STACK_SIZE];
+	for(uint32_t i = 1; i < MAX_TASKS; i++)
+	{
+		task_config[i].task_handler = worker_task;
+		task_config[i].stack_top = (uintptr_t)&task_stacks[i][TASK_STACK_SIZE];
+	}
+	cycles_per_tick = SIM_DEFAULT_CPU_HZ / TICK_HZ;
+	if(p_scenario->setup)
+	{
+		p_scenario->setup();
+	}
+
+	sim_init(SIM_DEFAULT_CPU_HZ, TICK_HZ);
+	init_task_stack(task_config);
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_TT
+	if(p_sim_schedule == NULL)
+	{
+		k_printf("%s needs a schedule table, only the tt scenarios run in this build\n", p_scenario->name);
+		return 2;
+	}
+	kernel_tt_init(p_sim_schedule);
+#endif
+#if KERNEL_CONFIG_STATS
+	kernel_stats_init();
+#endif
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	sim_run(SIM_TICKS);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	p_scenario->check(SIM_TICKS);
+
+	seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+	printf("%s: %d tasks, %u ticks in %.3f s (%.0f ticks/s), %s\n", p_scenario->name, MAX_TASKS, SIM_TICKS, seconds,
+			SIM_TICKS / seconds, failures ? "FAILED" : "passed");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,463 @@
+/*
+ * kprintf.c
+ *
+ *  Created on: Jan 16, 2026
+ *      Author: krisko
+ */
+
+#include <stdint.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include "kprintf.h"
+
+extern int _write(int file, char *ptr, int len);
+
+//output sink, either a bounded buffer (k_snprintf) or a small buffer flushed to _write (k_printf)
+typedef struct
+{
+	char *p_buf;
+	size_t size; // capacity of p_buf
+	size_t pos; // characters stored in p_buf
+	size_t count; // characters produced in total (the return value)
+	uint8_t flush; // 1 -> write p_buf out with _write when full
+}kout_t;
+
+//conversion flags
+#define FLAG_LEFT 0x01
+#define FLAG_ZERO 0x02
+#define FLAG_PLUS 0x04
+#define FLAG_SPACE 0x08
+#define FLAG_UPPER 0x10
+#define FLAG_ALT 0x20
+
+#if KPRINTF_CONFIG_LONG_LONG
+typedef unsigned long long kuint_t;
+#else
+typedef unsigned long kuint_t;
+#endif
+
+static void kout_flush(kout_t *p_out)
+{
+	if(p_out->flush && p_out->pos)
+	{
+		_write(1, p_out->p_buf, (int)p_out->pos);
+		p_out->pos = 0;
+	}
+}
+
+static void kout_char(kout_t *p_out, char c)
+{
+	if(p_out->flush)
+	{
+		if(p_out->pos == p_out->size)
+		{
+			kout_flush(p_out);
+		}
+		p_out->p_buf[p_out->pos++] = c;
+	}
+	else if( (p_out->pos + 1) < p_out->size )
+	{
+		//keep one byte for the terminating null
+		p_out->p_buf[p_out->pos++] = c;
+	}
+	p_out->count++;
+}
+
+static void kout_pad(kout_t *p_out, char c, int n)
+{
+	while(n-- > 0)
+	{
+		kout_char(p_out, c);
+	}
+}
+
+/*
+ * writes an unsigned value with sign/prefix, precision (minimum digits) and width
+ */
+static void kout_number(kout_t *p_out, kuint_t val, uint8_t base, char sign, uint8_t flags, int width, int prec,
+		const char *prefix)
+{
+	char digits[24]; // 64 bit octal is 22 digits
+	const char *p_hex = (flags & FLAG_UPPER) ? "0123456789ABCDEF" : "0123456789abcdef";
+	int n = 0, len, prefix_len = 0, zeros;
+
+	if( !((prec == 0) && (val == 0)) )
+	{
+		do
+		{
+			digits[n++] = p_hex[val % base];
+			val /= base;
+		} while(val);
+	}
+
+	while(prefix && prefix[prefix_len])
+	{
+		prefix_len++;
+	}
+
+	zeros = (prec > n) ? (prec - n) : 0;
+	len = n + zeros + prefix_len + (sign ? 1 : 0);
+
+	//'0' flag pads with zeros after the sign, ignored with a precision or '-'
+	if( (flags & FLAG_ZERO) && !(flags & FLAG_LEFT) && (prec < 0) && (width > len) )
+	{
+		zeros += width - len;
+		len = width;
+	}
+
+	if(!(flags & FLAG_LEFT))
+	{
+		kout_pad(p_out, ' ', width - len);
+	}
+	if(sign)
+	{
+		kout_char(p_out, sign);
+	}
+	for(int i = 0; i < prefix_len; i++)
+	{
+		kout_char(p_out, prefix[i]);
+	}
+	kout_pad(p_out, '0', zeros);
+	while(n)
+	{
+		kout_char(p_out, digits[--n]);
+	}
+	if(flags & FLAG_LEFT)
+	{
+		kout_pad(p_out, ' ', width - len);
+	}
+}
+
+static void kout_string(kout_t *p_out, const char *s, uint8_t flags, int width, int prec)
+{
+	int len = 0;
+
+	if(s == NULL)
+	{
+		s = "(null)";
+	}
+	while( s[len] && ((prec < 0) || (len < prec)) )
+	{
+		len++;
+	}
+
+	if(!(flags & FLAG_LEFT))
+	{
+		kout_pad(p_out, ' ', width - len);
+	}
+	for(int i = 0; i < len; i++)
+	{
+		kout_char(p_out, s[i]);
+	}
+	if(flags & FLAG_LEFT)
+	{
+		kout_pad(p_out, ' ', width - len);
+	}
+}
+
+#if KPRINTF_CONFIG_FLOAT
+static void kout_float(kout_t *p_out, double val, uint8_t flags, int width, int prec)
+{
+	char sign = 0;
+	unsigned long long ipart, fpart, scale = 1;
+
+	if(prec < 0)
+	{
+		prec = 6;
+	}
+	if(prec > 9)
+	{
+		prec = 9;
+	}
+
+	if(val != val)
+	{
+		kout_string(p_out, "nan", flags, width, -1);
+		return;
+	}
+	if(val < 0)
+	{
+		sign = '-';
+		val = -val;
+	}
+	else if(flags & FLAG_PLUS)
+	{
+		sign = '+';
+	}
+	else if(flags & FLAG_SPACE)
+	{
+		sign = ' ';
+	}
+	if(val > 1.8e19)
+	{
+		kout_string(p_out, sign == '-' ? "-inf" : "inf", flags, width, -1);
+		return;
+	}
+
+	for(int i = 0; i < prec; i++)
+	{
+		scale *= 10;
+	}
+	ipart = (unsigned long long)val;
+	fpart = (unsigned long long)(((val - (double)ipart) * (double)scale) + 0.5);
+	if(fpart >= scale)
+	{
+		ipart++;
+		fpart -= scale;
+	}
+
+	//integer part takes the width left after the point and the fraction
+	int frac_width = prec ? (prec + 1) : 0;
+	if(flags & FLAG_LEFT)
+	{
+		kout_number(p_out, ipart, 10, sign, flags & ~FLAG_LEFT, 0, -1, NULL);
+	}
+	else
+	{
+		kout_number(p_out, ipart, 10, sign, flags, width - frac_width, -1, NULL);
+	}
+	if(prec)
+	{
+		kout_char(p_out, '.');
+		kout_number(p_out, fpart, 10, 0, 0, 0, prec, NULL);
+	}
+	if(flags & FLAG_LEFT)
+	{
+		//count what was written for the integer part to pad the rest
+		unsigned long long t = ipart;
+		int len = (sign ? 1 : 0) + frac_width;
+		do
+		{
+			len++;
+			t /= 10;
+		} while(t);
+		kout_pad(p_out, ' ', width - len);
+	}
+}
+#endif
+
+static void kout_format(kout_t *p_out, const char *fmt, va_list ap)
+{
+	while(*fmt)
+	{
+		if(*fmt != '%')
+		{
+			kout_char(p_out, *fmt++);
+			continue;
+		}
+		fmt++;
+
+		uint8_t flags = 0;
+		int width = 0, prec = -1, length = 0; // length: -2 hh, -1 h, 0 int, 1 l, 2 ll
+
+		//flags
+		for(;; fmt++)
+		{
+			if(*fmt == '-') flags |= FLAG_LEFT;
+			else if(*fmt == '0') flags |= FLAG_ZERO;
+			else if(*fmt == '+') flags |= FLAG_PLUS;
+			else if(*fmt == ' ') flags |= FLAG_SPACE;
+			else if(*fmt == '#') flags |= FLAG_ALT;
+			else break;
+		}
+
+		//width
+		if(*fmt == '*')
+		{
+			width = va_arg(ap, int);
+			if(width < 0)
+			{
+				flags |= FLAG_LEFT;
+				width = -width;
+			}
+			fmt++;
+		}
+		while( (*fmt >= '0') && (*fmt <= '9') )
+		{
+			width = (width * 10) + (*fmt++ - '0');
+		}
+
+		//precision
+		if(*fmt == '.')
+		{
+			fmt++;
+			prec = 0;
+			if(*fmt == '*')
+			{
+				prec = va_arg(ap, int);
+				fmt++;
+			}
+			while( (*fmt >= '0') && (*fmt <= '9') )
+			{
+				prec = (prec * 10) + (*fmt++ - '0');
+			}
+		}
+
+		//length
+		if(*fmt == 'h')
+		{
+			length = (*++fmt == 'h') ? (fmt++, -2) : -1;
+		}
+		else if(*fmt == 'l')
+		{
+			length = (*++fmt == 'l') ? (fmt++, 2) : 1;
+		}
+		else if( (*fmt == 'z') || (*fmt == 't') )
+		{
+			//size_t and ptrdiff_t are 32 bits on the target
+			length = (sizeof(size_t) == sizeof(long)) ? 1 : 0;
+			fmt++;
+		}
+
+		char conv = *fmt;
+		if(conv == '\0')
+		{
+			break;
+		}
+		fmt++;
+
+		switch(conv)
+		{
+			case 'd':
+			case 'i':
+			{
+				long long sval;
+				kuint_t uval;
+				char sign = 0;
+
+				if(length == 2) sval = va_arg(ap, long long);
+				else if(length == 1) sval = va_arg(ap, long);
+				else sval = va_arg(ap, int);
+				if(length == -1) sval = (short)sval;
+				if(length == -2) sval = (signed char)sval;
+
+				if(sval < 0)
+				{
+					sign = '-';
+					uval = (kuint_t)(0 - (unsigned long long)sval);
+				}
+				else
+				{
+					uval = (kuint_t)sval;
+					if(flags & FLAG_PLUS) sign = '+';
+					else if(flags & FLAG_SPACE) sign = ' ';
+				}
+				kout_number(p_out, uval, 10, sign, flags, width, prec, NULL);
+				break;
+			}
+			case 'u':
+			case 'x':
+			case 'X':
+			case 'o':
+			{
+				kuint_t uval;
+
+				if(length == 2) uval = (kuint_t)va_arg(ap, unsigned long long);
+				else if(length == 1) uval = va_arg(ap, unsigned long);
+				else uval = va_arg(ap, unsigned int);
+				if(length == -1) uval = (unsigned short)uval;
+				if(length == -2) uval = (unsigned char)uval;
+
+				const char *prefix = NULL;
+				if(conv == 'X') flags |= FLAG_UPPER;
+				if( (flags & FLAG_ALT) && uval && (conv != 'o') )
+				{
+					prefix = (conv == 'x') ? "0x" : ((conv == 'X') ? "0X" : NULL);
+				}
+				else if( (flags & FLAG_ALT) && (conv == 'o') )
+				{
+					//'#' only has to make the first octal digit a zero, the precision may already do that
+					int n_oct = 0;
+					for(kuint_t v = uval; v; v >>= 3)
+					{
+						n_oct++;
+					}
+					if( (uval && (prec <= n_oct)) || (!uval && (prec == 0)) )
+					{
+						prefix = "0";
+					}
+				}
+				kout_number(p_out, uval, (conv == 'u') ? 10 : ((conv == 'o') ? 8 : 16), 0, flags, width, prec, prefix);
+				break;
+			}
+			case 'p':
+				kout_number(p_out, (kuint_t)(uintptr_t)va_arg(ap, void*), 16, 0, flags, width, prec, "0x");
+				break;
+			case 'c':
+			{
+				char c = (char)va_arg(ap, int);
+				if(!(flags & FLAG_LEFT)) kout_pad(p_out, ' ', width - 1);
+				kout_char(p_out, c);
+				if(flags & FLAG_LEFT) kout_pad(p_out, ' ', width - 1);
+				break;
+			}
+			case 's':
+				kout_string(p_out, va_arg(ap, const char*), flags, width, prec);
+				break;
+			case 'f':
+			case 'F':
+			case 'e':
+			case 'g':
+#if KPRINTF_CONFIG_FLOAT
+				//only fixed point notation, %e and %g are printed like %f
+				kout_float(p_out, va_arg(ap, double), flags, width, prec);
+#else
+				(void)va_arg(ap, double);
+				kout_char(p_out, '?');
+#endif
+				break;
+			case '%':
+				kout_char(p_out, '%');
+				break;
+			default:
+				//unknown conversion, print it as is
+				kout_char(p_out, '%');
+				kout_char(p_out, conv);
+				break;
+		}
+	}
+}
+
+/*
+ * formats into p_buf, at most size - 1 characters plus a null are written
+ * returns the number of characters the full output has (like vsnprintf)
+ */
+int k_vsnprintf(char *p_buf, size_t size, const char *fmt, va_list ap)
+{
+	kout_t out = { .p_buf = p_buf, .size = size, .pos = 0, .count = 0, .flush = 0 };
+
+	kout_format(&out, fmt, ap);
+	if(size)
+	{
+		p_buf[out.pos] = '\0';
+	}
+	return (int)out.count;
+}
+
+int k_snprintf(char *p_buf, size_t size, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	va_start(ap, fmt);
+	n = k_vsnprintf(p_buf, size, fmt, ap);
+	va_end(ap);
+	return n;
+}
+
+/*
+ * formats into a KPRINTF_FLUSH_LEN buffer on the caller's stack and writes it out with _write whenever it fills up,
+ * so the stack cost does not depend on the length of the output
+ */
+int k_printf(const char *fmt, ...)
+{
+	char buf[KPRINTF_FLUSH_LEN];
+	kout_t out = { .p_buf = buf, .size = sizeof(buf), .pos = 0, .count = 0, .flush = 1 };
+	va_list ap;
+
+	va_start(ap, fmt);
+	kout_format(&out, fmt, ap);
+	va_end(ap);
+	kout_flush(&out);
+	return (int)out.count;
+}
@@ -0,0 +1,36 @@
+/*
+ * kprintf.h
+ *
+ *  Created on: Jan 16, 2026
+ *      Author: krisko
+ */
+
+#ifndef KPRINTF_H_
+#define KPRINTF_H_
+
+#include <stdarg.h>
+#include <stddef.h>
+
+/*
+ * small formatted output for the kernel and the tasks
+ * no heap, no global state (reentrant, safe to call from several tasks), output of k_printf goes through _write
+ *
+ * supported: %d %i %u %x %X %o %c %s %p %%, flags '-' '0' '+' ' ' '#', width, precision, '*' and the h hh l ll z t
+ * length modifiers, features that cost code size are selected at compile time
+ */
+
+#ifndef KPRINTF_CONFIG_LONG_LONG
+#define KPRINTF_CONFIG_LONG_LONG 0 // 1 -> %lld/%llu/%llx use 64 bit arithmetic, 0 -> the value is consumed and truncated to 32 bits
+#endif
+
+#ifndef KPRINTF_CONFIG_FLOAT
+#define KPRINTF_CONFIG_FLOAT 0 // 1 -> %f (rounds half up, at most 9 decimals), 0 -> the double is consumed and printed as '?'
+#endif
+
+#define KPRINTF_FLUSH_LEN 32U // k_printf formats into a stack buffer of this size and flushes it with _write
+
+int k_vsnprintf(char *p_buf, size_t size, const char *fmt, va_list ap);
+int k_snprintf(char *p_buf, size_t size, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+int k_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+#endif /* KPRINTF_H_ */
@@ -0,0 +1,138 @@
+/*
+ * log.c
+ *
+ *  Created on: Jan 14, 2026
+ *      Author: krisko
+ */
+
+#include <stdint.h>
+#include "rcc.h"
+#include "main.h"
+#include "log.h"
+#include "kprintf.h"
+#include "port.h"
+
+extern int _write(int file, char *ptr, int len);
+
+static uint32_t log_buf[LOG_BUF_WORDS];
+static volatile uint32_t log_wr; // words reserved so far, only moved with interrupts masked
+static volatile uint32_t log_rd; // words drained so far, only moved by log_drain
+static volatile uint32_t log_dropped; // records lost because the buffer was full, counted with interrupts masked
+static uint32_t log_dropped_reported;
+
+void log_init(void)
+{
+#if LOG_CONFIG_HOST_FORMAT
+	uint32_t *p_DEMCR = (uint32_t*)DEMCR_ADDR;
+	uint32_t *p_ITM_TER = (uint32_t*)0xE0000E00;
+
+	*p_DEMCR |= (1 << 24); // TRCENA
+	*p_ITM_TER |= (1 << LOG_RAW_PORT);
+#endif
+}
+
+/*
+ * called through LOG() from tasks or handlers, reserves the record (or counts the drop) with interrupts masked,
+ * fills it with interrupts enabled and publishes it by writing the header last
+ */
+void log_write(const char *fmt, uint32_t nargs, const uint32_t *p_args)
+{
+	uint32_t primask, wr, len = LOG_HDR_WORDS + nargs;
+
+	primask = port_irq_save();
+	wr = log_wr;
+	if( (wr + len - log_rd) > LOG_BUF_WORDS )
+	{
+		log_dropped++;
+		port_irq_restore(primask);
+		return;
+	}
+	log_wr = wr + len;
+	port_irq_restore(primask);
+
+	log_buf[(wr + 1) & (LOG_BUF_WORDS - 1)] = (uint32_t)fmt;
+	log_buf[(wr + 2) & (LOG_BUF_WORDS - 1)] = PORT_CYCLES();
+	for(uint32_t i = 0; i < nargs; i++)
+	{
+		log_buf[(wr + LOG_HDR_WORDS + i) & (LOG_BUF_WORDS - 1)] = p_args[i];
+	}
+
+	__asm volatile("DMB" : : : "memory");
+	log_buf[wr & (LOG_BUF_WORDS - 1)] = LOG_HDR_VALID | nargs;
+}
+
+#if LOG_CONFIG_HOST_FORMAT
+static void log_itm_word(uint32_t word)
+{
+	volatile uint32_t *p_port = (volatile uint32_t*)(0xE0000000U + (4 * LOG_RAW_PORT));
+
+	while(!(*p_port & 1));
+	*p_port = word;
+}
+#endif
+
+/*
+ * formats and outputs the committed records, stops at a record that is reserved but not yet written
+ * returns the number of records output, call from the idle task (or a low priority task)
+ */
+uint32_t log_drain(void)
+{
+	uint32_t rec[LOG_HDR_WORDS + LOG_MAX_ARGS];
+	uint32_t hdr, nargs, count = 0;
+
+	while(log_rd != log_wr)
+	{
+		hdr = log_buf[log_rd & (LOG_BUF_WORDS - 1)];
+		if( (hdr & LOG_HDR_MASK) != LOG_HDR_VALID )
+		{
+			break;
+		}
+		nargs = hdr & 0xFF;
+
+		//copy the record out and clear it, then hand the space back to the writers
+		for(uint32_t i = 0; i < (LOG_HDR_WORDS + nargs); i++)
+		{
+			rec[i] = log_buf[(log_rd + i) & (LOG_BUF_WORDS - 1)];
+			log_buf[(log_rd + i) & (LOG_BUF_WORDS - 1)] = 0;
+		}
+		__asm volatile("DMB" : : : "memory");
+		log_rd += LOG_HDR_WORDS + nargs;
+
+#if LOG_CONFIG_HOST_FORMAT
+		for(uint32_t i = 0; i < (LOG_HDR_WORDS + nargs); i++)
+		{
+			log_itm_word(rec[i]);
+		}
+#else
+		char line[LOG_LINE_LEN];
+		for(uint32_t i = nargs; i < LOG_MAX_ARGS; i++)
+		{
+			rec[LOG_HDR_WORDS + i] = 0;
+		}
+		int n = k_snprintf(line, sizeof(line), (const char*)rec[1], rec[3], rec[4], rec[5], rec[6]);
+		if(n > 0)
+		{
+			_write(1, line, (n < (int)sizeof(line)) ? n : (int)sizeof(line) - 1);
+		}
+#endif
+		count++;
+	}
+
+	if(log_dropped != log_dropped_reported)
+	{
+		log_dropped_reported = log_dropped;
+#if LOG_CONFIG_HOST_FORMAT
+		//a record with a null format carries the drop count
+		log_itm_word(LOG_HDR_VALID | 1);
+		log_itm_word(0);
+		log_itm_word(PORT_CYCLES());
+		log_itm_word(log_dropped_reported);
+#else
+		char line[32];
+		int n = k_snprintf(line, sizeof(line), "log: %lu dropped\n", log_dropped_reported);
+		_write(1, line, n);
+#endif
+	}
+
+	return count;
+}
@@ -0,0 +1,55 @@
+/*
+ * log.h
+ *
+ *  Created on: Jan 14, 2026
+ *      Author: krisko
+ */
+
+#ifndef LOG_H_
+#define LOG_H_
+
+#include <stdint.h>
+#include "main.h"
+
+/*
+ * deferred formatting logger
+ * LOG() only copies the format string address, a CYCCNT timestamp and up to 4 32 bit arguments into a lock-free
+ * ring buffer, the formatting and the output are done later by log_drain() (idle task) or by the host
+ *
+ * record layout (words): header (LOG_HDR_VALID | nargs), format address, timestamp, args...
+ *
+ * arguments are passed as 32 bit integers: %d %u %x %c %p (cast pointers to uint32_t), no %s of stack buffers
+ * (the string is read when the record is drained) and no floating point
+ */
+
+#define LOG_BUF_WORDS 256U // ring buffer size in words, must be a power of 2 (1 KB)
+#define LOG_MAX_ARGS 4U
+#define LOG_HDR_WORDS 3U
+#define LOG_HDR_VALID 0x4C000000U // 'L' in the top byte marks a committed record
+#define LOG_HDR_MASK 0xFF000000U
+#define LOG_LINE_LEN 96U // longest formatted line, longer ones are cut
+
+//0 -> log_drain formats on the target with k_snprintf and writes the text through _write (ITM port 0 or semihosting)
+//1 -> log_drain streams the raw records to ITM port LOG_RAW_PORT, tools/log_decode.py formats them on the host
+#ifndef LOG_CONFIG_HOST_FORMAT
+#define LOG_CONFIG_HOST_FORMAT 0
+#endif
+#define LOG_RAW_PORT 2U
+
+//count the arguments of LOG (0 to 8, so that 5 to 8 are caught by the _Static_assert in LOG)
+#define LOG_NARGS(...) LOG_NARGS_(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, N, ...) N
+
+#define LOG(fmt, ...) \
+	do \
+	{ \
+		_Static_assert(LOG_NARGS(__VA_ARGS__) <= LOG_MAX_ARGS, "LOG takes at most 4 arguments"); \
+		const uint32_t log_args_[LOG_MAX_ARGS + 1] = {0, ##__VA_ARGS__}; \
+		log_write((fmt), LOG_NARGS(__VA_ARGS__), &log_args_[1]); \
+	} while(0)
+
+void log_init(void);
+void log_write(const char *fmt, uint32_t nargs, const uint32_t *p_args);
+uint32_t log_drain(void);
+
+#endif /* LOG_H_ */
@@ -17,11 +17,15 @@
  */
 
 #include <stdint.h>
+#include "rcc.h"
 #include <stdio.h>
 
 #include "main.h"
 #include "scheduler.h"
 #include "tasks.h"
+#include "kprintf.h"
+#include "trace.h"
+#include "log.h"
 
 #if !defined(__SOFT_FP__) && defined(__ARM_FP)
   #warning "FPU is not initialized, but the project is compiling for an FPU. Please initialize the FPU before use."
@@ -30,31 +34,119 @@
 //semihosting init fcn
 extern void initialise_monitor_handles(void);
 
+#ifndef KERNEL_TARGET_QEMU
+//180MHz from HSI: 16MHz / M(8) * N(180) / P(2), APB1 = 45MHz, APB2 = 90MHz
+static RCC_config_t clk_config = {
+	.RCC_sysclk_src = RCC_SYSCLK_SRC_PLL,
+	.RCC_PLL_src = RCC_PLL_SRC_HSI,
+	.RCC_PLL_M = 8,
+	.RCC_PLL_N = 180,
+	.RCC_PLL_P = RCC_PLL_P_DIV2,
+	.RCC_PLL_Q = 8,
+	.RCC_AHB_pscal = RCC_AHB_DIV1,
+	.RCC_APB1_pscal = RCC_APB_DIV4,
+	.RCC_APB2_pscal = RCC_APB_DIV2,
+};
+#endif
+
+//index 0 is the idle task, it runs whenever every other task is blocked
+//the deadlines (ticks, SCHED_POLICY_EDF only) are the delay periods of the tasks
+static const task_config_t task_config[MAX_TASKS] = {
+	{ idle_task, IDLE_STACK_START, 0 },
+	{ task1_handler, T1_STACK_START, 1000 },
+	{ task2_handler, T2_STACK_START, 500 },
+	{ task3_handler, T3_STACK_START, 250 },
+	{ task4_handler, T4_STACK_START, 2000 },
+};
+
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_TT
+//the same rates as the delays: 250 tick minor frames, task 3 in every frame, task 2 in every 2nd, task 1 in every
+//4th and task 4 once per 2000 tick major frame
+static const uint32_t tt_slots_0[] = { 3, 2, 1, 4 };
+static const uint32_t tt_slots_2[] = { 3, 2 };
+static const uint32_t tt_slots_4[] = { 3, 2, 1 };
+static const uint32_t tt_slots_odd[] = { 3 };
+
+static const tt_frame_t tt_frames[] = {
+	{ tt_slots_0, 4 },
+	{ tt_slots_odd, 1 },
+	{ tt_slots_2, 2 },
+	{ tt_slots_odd, 1 },
+	{ tt_slots_4, 3 },
+	{ tt_slots_odd, 1 },
+	{ tt_slots_2, 2 },
+	{ tt_slots_odd, 1 },
+};
+
+static const tt_schedule_t tt_schedule = {
+	.p_frames = tt_frames,
+	.frame_count = 8,
+	.frame_ticks = 250,
+	.p_background = NULL,
+	.background_count = 0,
+};
+#endif
+
 int main(void)
 {
 
  	enable_processor_faults();
 
+#ifndef KERNEL_TARGET_QEMU
+	//run the core at full speed, stays on HSI (16MHz) if the PLL could not be configured
+	RCC_clock_config(&clk_config);
+#endif
+
 	init_scheduler_stack(SCHEDU_STACK_START);
 
-	init_task_stack();
+	init_task_stack(task_config);
+
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_TT
+	kernel_tt_init(&tt_schedule);
+#endif
+
+#if KERNEL_CONFIG_MPU_GUARD
+	kernel_mpu_init();
+#endif
 
 	initialise_monitor_handles();
 
-	printf("Task schedular\n");
+	k_printf("Task schedular\n");
+	k_printf("boot time: %lu cycles\n", g_boot_cycles);
+
+#if KERNEL_CONFIG_STATS
+	kernel_stats_init();
+#endif
+
+	//after RCC_clock_config so the recorded CYCCNT frequency is the final HCLK
+	trace_init();
+	log_init();
 
 	init_systick_timer(TICK_HZ);
+#ifndef KERNEL_TARGET_QEMU
+	//keep the tick rate when the clock is changed at runtime (RCC_clock_config / RCC_set_sysclk_src)
+	RCC_register_clk_change(systick_clk_change_handler, NULL);
+#endif
 
 	switch_sp_to_psp();
 
-	task1_handler();
+	//task 1, or the first slot of the schedule table in SCHED_POLICY_TT
+	user_tasks[current_task].task_handler();
     /* Loop forever */
 	for(;;);
 }
 
 void idle_task(void)
 {
-	while(1);
+	while(1)
+	{
+		//format and output what the tasks logged
+		log_drain();
+#if KERNEL_CONFIG_STACK_CHECK
+		//update the stack high-water marks while there is nothing else to do
+		kernel_stack_scan();
+#endif
+	}
 }
 
 void task1_handler(void)
@@ -62,7 +154,7 @@ void task1_handler(void)
 	//the tasks never returns(finishes)
 	while(1)
 	{
-		printf("This is task 1\n");
+		LOG("This is task 1\n");
 		task_delay(1000);
 	}
 }
@@ -70,7 +162,7 @@ void task2_handler(void)
 {
 	while(1)
 	{
-		printf("This is task 2 \n");
+		LOG("This is task 2 \n");
 		task_delay(500);
 
 	}
@@ -79,7 +171,7 @@ void task3_handler(void)
 {
 	while(1)
 	{
-		printf("This is task 3\n");
+		LOG("This is task 3\n");
 		task_delay(250);
 
 	}
@@ -88,7 +180,24 @@ void task4_handler(void)
 {
 	while(1)
 	{
-		printf("This is task 4\n");
+		LOG("This is task 4\n");
+#if KERNEL_CONFIG_STATS
+		kernel_stats_t stats;
+		kernel_get_stats(&stats);
+		for(int i = 0; i < MAX_TASKS; i++)
+		{
+			LOG("task %d: %lu.%lu%% %lu switches\n", i, stats.load_permille[i] / 10, stats.load_permille[i] % 10,
+					stats.switch_count[i]);
+		}
+		LOG("isr: %lu.%lu%% idle: %lu.%lu%%\n", stats.isr_permille / 10, stats.isr_permille % 10,
+				stats.idle_permille / 10, stats.idle_permille % 10);
+#endif
+#if KERNEL_CONFIG_STACK_CHECK
+		for(uint32_t i = 0; i < MAX_TASKS; i++)
+		{
+			LOG("task %lu stack: %lu/%u bytes\n", i, kernel_get_stack_usage(i), TASK_STACK_SIZE);
+		}
+#endif
 		task_delay(2000);
 	}
 }
@@ -8,10 +8,14 @@
 #ifndef MAIN_H_
 #define MAIN_H_
 
+#ifndef MAX_TASKS
 #define MAX_TASKS 5
+#endif
 
 /* stack memory calculations */
+#ifndef TASK_STACK_SIZE
 #define TASK_STACK_SIZE 1024U // 1 KB FOR EACH TASK PRIVATE STACK
+#endif
 #define SCHEDU_STACK_SIZE 1024U // 1 KB FOR THE SCHEDULER STACK AS WELL
 
 #define SRAM_START 0x20000000U
@@ -28,8 +32,13 @@
 
 //systick timer macros
 #define TICK_HZ 1000U
-#define HSI_CLOCK 16000000U
-#define SYSTIC_TIMER_CLOCK HSI_CLOCK
+#ifndef KERNEL_TARGET_QEMU
+#define SYSTIC_TIMER_CLOCK RCC_get_hclk() // SysTick runs from the processor clock (HCLK), read from the RCC driver
+#else
+//QEMU netduinoplus2 (STM32F405) has no RCC model, its SysTick processor clock is fixed at 168MHz
+#define QEMU_SYSCLK_HZ 168000000U
+#define SYSTIC_TIMER_CLOCK QEMU_SYSCLK_HZ
+#endif
 
 //dummy stack macros
 #define DUMMY_XPSR 0x01000000U // all we need is the t-bit to be 1
@@ -37,7 +46,83 @@
 #define TASK_READY_STATE 0x00
 #define TASK_BlOCKED_STATE 0xFF
 
+/* kernel configuration, 1 to enable or 0 to compile out (can be overridden with -D) */
+#ifndef KERNEL_CONFIG_STATS
+#define KERNEL_CONFIG_STATS 1 // per task run time and context switch accounting with DWT CYCCNT
+#endif
+
+#ifndef KERNEL_CONFIG_STACK_CHECK
+#define KERNEL_CONFIG_STACK_CHECK 1 // stack painting, high-water marks and overflow check at each context switch
+#endif
+
+#ifndef KERNEL_CONFIG_MPU_GUARD
+#define KERNEL_CONFIG_MPU_GUARD 1 // no-access MPU region at the bottom of the running task's stack
+#endif
+
+#ifndef KERNEL_CONFIG_TRACE
+#define KERNEL_CONFIG_TRACE 1 // binary scheduler event trace in a .noinit ring buffer (trace.h)
+#endif
+
+/* @SCHED_POLICY */
+#define SCHED_POLICY_RR 0 // round-robin over the ready tasks at every tick
+#define SCHED_POLICY_EDF 1 // earliest deadline first, deadline ordered ready list
+#define SCHED_POLICY_TT 2 // time-triggered, a static schedule table (tt_schedule_t) dispatches the tasks
+
+#ifndef KERNEL_CONFIG_SCHED_POLICY
+#define KERNEL_CONFIG_SCHED_POLICY SCHED_POLICY_RR // possible values from @SCHED_POLICY
+#endif
+
+#ifndef KERNEL_CONFIG_BUDGET
+#define KERNEL_CONFIG_BUDGET 0 // per task CPU budgets (task_config_t budget_*) enforced at the tick and the switch
+#endif
+
+#if KERNEL_CONFIG_BUDGET && (KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_TT)
+#error "KERNEL_CONFIG_BUDGET is for SCHED_POLICY_RR and SCHED_POLICY_EDF, the TT table has slot overrun detection"
+#endif
+
+/* @BUDGET_MODE, what happens to a task that used up its budget */
+#define BUDGET_MODE_SUSPEND 0 // does not run until the next periodic replenishment
+#define BUDGET_MODE_DEMOTE 1 // only runs when no task with budget left is ready
+#define BUDGET_MODE_SPORADIC 2 // sporadic server, suspended and each used chunk comes back one period after it started
+#define BUDGET_SS_MAX_REPL 4U // pending replenishments per sporadic server, when full it waits for the oldest
+
+//MPU stack guard
+#if KERNEL_CONFIG_MPU_GUARD
+#define STACK_GUARD_SIZE 32U // smallest MPU region, task stacks are 1 KB aligned so the base is always aligned
+#else
+#define STACK_GUARD_SIZE 0U
+#endif
+#define MPU_GUARD_REGION 7U // highest region number wins where regions overlap
+#define MPU_CTRL_ADDR 0xE000ED94U
+#define MPU_RNR_ADDR 0xE000ED98U
+#define MPU_RBAR_ADDR 0xE000ED9CU
+#define MPU_RASR_ADDR 0xE000EDA0U
+#define CFSR_ADDR 0xE000ED28U
+#define MMFAR_ADDR 0xE000ED34U
+
+//stack painting
+#define STACK_PAINT_PATTERN 0xA5A5A5A5U // written over the whole task stack by init_task_stack
+#define STACK_OVERFLOW_MARGIN 32U // bytes above the stack bottom a saved PSP must stay clear of
+
+//DWT cycle counter, used for the kernel statistics
+#define DEMCR_ADDR 0xE000EDFCU
+#define DWT_CTRL_ADDR 0xE0001000U
+#define DWT_CYCCNT_ADDR 0xE0001004U
+
+#ifndef KERNEL_PORT_POSIX
+//place a variable in .noinit so Reset_Handler does not zero it (DMA/trace buffers, data kept across a reset)
+#define NOINIT __attribute__((section(".noinit")))
+
+//cycles from reset to main(), set by Reset_Handler in startup.c
+extern uint32_t g_boot_cycles;
+
 #define INTERRUPT_DISABLE() do{__asm volatile("MOV R0,#0X1"); __asm volatile("MSR PRIMASK,R0");} while(0)
 #define INTERRUPT_ENABLE() do{__asm volatile("MOV R0,#0X0"); __asm volatile("MSR PRIMASK,R0");} while(0)
+#else
+//host simulation (host/port_posix.c), only one context runs at a time
+#define NOINIT
+#define INTERRUPT_DISABLE() do{} while(0)
+#define INTERRUPT_ENABLE() do{} while(0)
+#endif
 
 #endif /* MAIN_H_ */
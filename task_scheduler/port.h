@@ -0,0 +1,71 @@
+/*
+ * port.h
+ *
+ *  Created on: Jan 18, 2026
+ *      Author: krisko
+ */
+
+#ifndef PORT_H_
+#define PORT_H_
+
+#include <stdint.h>
+
+/*
+ * architecture layer of the kernel, everything scheduler.c needs from the CPU:
+ * port_cm4.c -> Cortex-M4 (PendSV/PSP context switch, SysTick, DWT CYCCNT, MPU)
+ * host/port_posix.c -> Linux simulation (ucontext per task, simulated tick and cycle counter), built with
+ *                      -DKERNEL_PORT_POSIX
+ */
+
+#ifndef KERNEL_PORT_POSIX
+
+/*
+ * masks interrupts and returns the previous PRIMASK for port_irq_restore, nests correctly
+ */
+static inline __attribute__((always_inline)) uint32_t port_irq_save(void)
+{
+	uint32_t primask;
+	__asm volatile("MRS %0, PRIMASK" : "=r"(primask));
+	__asm volatile("CPSID I" : : : "memory");
+	return primask;
+}
+
+static inline __attribute__((always_inline)) void port_irq_restore(uint32_t primask)
+{
+	__asm volatile("MSR PRIMASK, %0" : : "r"(primask) : "memory");
+}
+
+//free running cycle counter used for the statistics and the trace timestamps
+#define PORT_CYCLES() (*(volatile uint32_t*)DWT_CYCCNT_ADDR)
+
+#else
+
+//the simulation runs one context at a time and the tick is only taken between task slices, nothing to mask
+static inline uint32_t port_irq_save(void)
+{
+	return 0;
+}
+
+static inline void port_irq_restore(uint32_t primask)
+{
+	(void)primask;
+}
+
+//simulated cycles, advanced by sim_work and the idle task
+extern volatile uint32_t g_sim_cycles;
+#define PORT_CYCLES() (g_sim_cycles)
+
+#endif
+
+/**************************APIs**************************/
+
+/*
+ * implemented by the port, called by scheduler.c
+ */
+uintptr_t port_init_task_frame(uint32_t task, uintptr_t stack_top, void (*task_handler)(void));
+void port_pend_switch(void);
+void port_task_switched(uint32_t task);
+void port_stats_init(void);
+
+
+#endif /* PORT_H_ */
@@ -0,0 +1,283 @@
+/*
+ * port_cm4.c
+ *
+ *  Created on: Jan 18, 2026
+ *      Author: krisko
+ */
+#include <stdint.h>
+#include "rcc.h"
+#include "main.h"
+#include "port.h"
+#include "scheduler.h"
+#include "kprintf.h"
+#include "trace.h"
+
+/*
+ * Cortex-M4 part of the kernel: stack pointer setup, the first stack frame of a task, SysTick, PendSV, the MPU guard
+ * and the fault handlers, the scheduling logic itself is in scheduler.c
+ */
+
+__attribute__((naked)) void switch_sp_to_psp(void) // need naked bc in c fcn prologue LR is pushed onto stack at MSP
+{													// in epilogue, it POP whatever on the stack at PSP to PC
+
+	/* CUATION! here the BL corrupts the LR value as it stores the address of this fcn to get back from get_psp_value
+	 * so we need to save it first
+	 */
+	__asm volatile("PUSH {LR}");
+	//get value of PSP of the current task
+	__asm volatile("BL get_psp_value"); // calls get_PSP_value and returns with R0 containing the value
+	//initialize PSP
+	__asm volatile("MSR PSP,R0");
+	//POP the original value of LR from stack back to LR
+	__asm volatile("POP {LR}");
+
+	//change SP to PSP
+	__asm volatile("MOV R0,#0x02"); //store the value to config into R0 first, R0 is spare now bc the PSP value is already loaded to PSP
+	__asm volatile("MSR CONTROL,R0 ");
+	__asm volatile("BX LR"); // return
+}
+
+
+static uint32_t systick_tick_hz; //kept to recompute the reload value when HCLK changes
+
+void init_systick_timer(uint32_t tick_hz)
+{
+	uint32_t count_val = (SYSTIC_TIMER_CLOCK / tick_hz) - 1;
+	uint32_t *p_SRVR = (uint32_t*)0xE000E014;
+
+	systick_tick_hz = tick_hz;
+
+	//clear the value of SRVR
+	*p_SRVR &= ~(0x00FFFFFF);
+
+	//load the value into SRVR
+	*p_SRVR |= count_val;
+
+	//do some settings
+	uint32_t *p_SCSR = (uint32_t*)0xE000E010;
+	*p_SCSR |= (1 << 1); // enable the systick exception request
+	*p_SCSR |= (1 << 2); // use processor clock
+
+	*p_SCSR |= 1; // enable the counter
+
+
+}
+
+/*
+ * registered with RCC_register_clk_change so the tick period stays 1/tick_hz when HCLK changes
+ */
+void systick_clk_change_handler(uint8_t phase, void *p_context)
+{
+	uint32_t *p_SRVR = (uint32_t*)0xE000E014;
+	uint32_t *p_SCVR = (uint32_t*)0xE000E018;
+
+	if(phase == RCC_CLK_CHANGE_POST)
+	{
+		*p_SRVR = ((SYSTIC_TIMER_CLOCK / systick_tick_hz) - 1) & 0x00FFFFFF;
+		*p_SCVR = 0; // restart the current period with the new reload value
+	}
+}
+
+__attribute__ ((naked)) void init_scheduler_stack(uint32_t schedu_top_of_stack)
+{
+	//change msp (handler sp) to the correct address of the scheduler stack
+	__asm volatile("MSR MSP,%0" : : "r"(schedu_top_of_stack));
+	__asm volatile("BX LR"); // get back to caller
+}
+
+/*
+ * builds the dummy stack frame a task starts from, returns the PSP value to save in its TCD
+ */
+uintptr_t port_init_task_frame(uint32_t task, uintptr_t stack_top, void (*task_handler)(void))
+{
+	//when it is the first time the tasks are run, there were no past status/context
+	//so can't really retrieve the contaxt as there are nothing on the stack
+	//to solve this, create some dummy variables on the stack:
+	// general registers -> all set to 0
+	// xPSR -> only need t bit to be 1
+	// PC -> the corresponding task handler
+	// LR -> EXC_RETURN, should be 0xFFFFFFFD as we need return to thread with PSP
+	uint32_t *p_PSP = (uint32_t*)stack_top;
+	(void)task;
+
+	//stack model is full descending so decrement first, then store the value
+	p_PSP--;
+	*p_PSP = DUMMY_XPSR;
+
+	//PC, need to point to the task_handler
+	p_PSP--;
+	*p_PSP = (uint32_t) task_handler;
+
+	//LR
+	p_PSP--;
+	*p_PSP = 0xFFFFFFFD;
+
+	//general registers
+	for(int j = 0; j < 13; j++)
+	{
+		p_PSP--;
+		*p_PSP = 0;
+
+	}
+	return (uintptr_t)p_PSP;
+}
+
+void port_pend_switch(void)
+{
+	uint32_t *p_ICSR = (uint32_t*) 0xE000ED04;
+	//pend the pendSV exception
+	*p_ICSR |= (1 << 28);
+}
+
+/*
+ * called at the end of update_next_task with the incoming task
+ */
+void port_task_switched(uint32_t task)
+{
+#if KERNEL_CONFIG_MPU_GUARD
+	//move the guard to the incoming task, RASR (size, no access) is the same for every task so one RBAR write with
+	//VALID set (region number taken from RBAR) is all the switch needs, DSB so it is done before the exception return
+	*(volatile uint32_t*)MPU_RBAR_ADDR = user_tasks[task].stack_limit | (1 << 4) | MPU_GUARD_REGION;
+	__asm volatile("DSB" : : : "memory");
+#else
+	(void)task;
+#endif
+}
+
+void port_stats_init(void)
+{
+	uint32_t *p_DEMCR = (uint32_t*)DEMCR_ADDR;
+	uint32_t *p_DWT_CTRL = (uint32_t*)DWT_CTRL_ADDR;
+
+	//make sure CYCCNT runs, Reset_Handler enables it but a debugger may have reset the DWT
+	*p_DEMCR |= (1 << 24); // TRCENA
+	*p_DWT_CTRL |= 1; // CYCCNTENA
+}
+
+void enable_processor_faults(void)
+{
+	uint32_t *p_SHCSR = (uint32_t*)0xE000ED24;
+	*p_SHCSR |= (1 << 18); // usage fault
+	*p_SHCSR |= (1 << 17); // bus fault
+	*p_SHCSR |= (1 << 16); // mem fault
+}
+
+__attribute__((naked)) void PendSV_Handler(void)
+{
+	//do context switching to switch to the next ready to run task
+
+	/*save the context of current task*/
+	//1. get current running task's PSP value
+	__asm volatile("MRS R0, PSP"); // store the PSP value to R0
+
+	//2. using the PSP value, store SF2( R4 to R11)
+	/* caution:
+	 * - can't just use push b/c the handler always uses MSP, which will only push the values to the MSP stack,
+	 * 	 not the task private stack
+	 * 		-> use STMDB to save the values at the PSP address extracted into R0
+	 * 				->stores into multiple registers and "decrements before" (decrement first then store)
+	 */
+	__asm volatile("STMDB R0!, {R4-R11}"); // ! means that the final address that is stored will be loaded back to R0
+
+	//3. save the current value of PSP
+	__asm volatile("PUSH {LR}"); // push LR onto the stack first, because c fcn calls will corrupt LR
+	__asm volatile("BL save_psp_value");// R0 is passed as parameter by default
+
+	/*retrieve the context of next task*/
+	//1. decide next task to run
+	__asm volatile("BL update_next_task");
+
+	//2. get the task's past PSP value
+	__asm volatile("BL get_psp_value");
+
+	//3. using that PSP value retrieve SF2( R4 to R11), SF1 will be automatically retrieved when exiting handler
+	 __asm volatile("LDMIA R0!, {R4-R11}");//load multiple from memory to register, increment address after each access
+
+	//4. update PSP and exit
+	 __asm volatile("MSR PSP, R0");
+
+	//pop back the LR pushed to stack
+	 __asm volatile("POP {LR}");
+
+	//return
+	 __asm volatile("BX LR");
+}
+
+void SysTick_Handler(void)
+{
+#if KERNEL_CONFIG_STATS
+	kernel_isr_enter();
+#endif
+	TRACE_ISR_ENTER();
+
+	kernel_tick();
+
+	TRACE_ISR_EXIT();
+#if KERNEL_CONFIG_STATS
+	kernel_isr_exit();
+#endif
+}
+
+void HardFault_Handler(void)
+{
+	k_printf("hard fault\n");
+	while(1);
+}
+
+void MemManage_Handler(void)
+{
+#if KERNEL_CONFIG_MPU_GUARD
+	uint32_t cfsr = *(volatile uint32_t*)CFSR_ADDR;
+	uint32_t mmfar = *(volatile uint32_t*)MMFAR_ADDR;
+	uint32_t task = current_task; // stacking errors (MSTKERR) have no valid MMFAR, the running task overflowed
+
+	//MMARVALID, find whose guard was hit
+	if( (cfsr >> 7) & 1 )
+	{
+		for(uint32_t i = 0; i < MAX_TASKS; i++)
+		{
+			if( (mmfar >= user_tasks[i].stack_limit) && (mmfar < (user_tasks[i].stack_limit + STACK_GUARD_SIZE)) )
+			{
+				task = i;
+			}
+		}
+	}
+	k_printf("mem fault: stack overflow in task %lu (CFSR 0x%08lx MMFAR 0x%08lx)\n", task, cfsr, mmfar);
+#else
+	k_printf("mem fault\n");
+#endif
+	while(1);
+}
+
+void BusFault_Handler(void)
+{
+	k_printf("bus fault\n");
+	while(1);
+}
+
+void UsageFault_Handler(void)
+{
+	k_printf("usage fault\n");
+	while(1);
+}
+
+#if KERNEL_CONFIG_MPU_GUARD
+/*
+ * sets up the guard region for the first task, the rest of the memory map stays the default map (PRIVDEFENA)
+ * so the kernel and the tasks keep their normal access
+ */
+void kernel_mpu_init(void)
+{
+	*(volatile uint32_t*)MPU_CTRL_ADDR = 0;
+
+	*(volatile uint32_t*)MPU_RNR_ADDR = MPU_GUARD_REGION;
+	*(volatile uint32_t*)MPU_RBAR_ADDR = user_tasks[current_task].stack_limit;
+	//XN, AP = no access, SIZE = 4 (2^(4+1) = 32 bytes), ENABLE
+	*(volatile uint32_t*)MPU_RASR_ADDR = (1 << 28) | (0 << 24) | (4 << 1) | 1;
+
+	//PRIVDEFENA, ENABLE
+	*(volatile uint32_t*)MPU_CTRL_ADDR = (1 << 2) | 1;
+	__asm volatile("DSB" : : : "memory");
+	__asm volatile("ISB" : : : "memory");
+}
+#endif
@@ -0,0 +1,260 @@
+/*
+ * qemu_main.c
+ *
+ *  Created on: Jan 19, 2026
+ *      Author: krisko
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include "main.h"
+#include "scheduler.h"
+#include "port.h"
+#include "kprintf.h"
+#include "trace.h"
+#include "log.h"
+
+/*
+ * kernel regression and benchmark firmware for QEMU (-M netduinoplus2), run by tools/qemu_run.py
+ * task 4 steps the other tasks through the phases and reports on semihosting:
+ *   TEST <name> PASS|FAIL
+ *   RESULT <name> <value> lower|higher   (which direction is better, for the baseline comparison)
+ * then ends the run with exit(), the exit code is the number of failed tests
+ *
+ * QEMU does not model the DWT, CYCCNT reads 0, so times are measured with the SysTick counter instead, they are
+ * repeatable when QEMU runs with -icount
+ */
+
+#define PHASE_DELAY 1 // tasks 1-3 block with periods 1, 10 and 25 ticks, task 1 measures the wake-up latency
+#define PHASE_RR 2 // tasks 1-3 never block and count loop iterations
+#define PHASE_DONE 3
+
+#define DELAY_PHASE_TICKS 1000U
+#define RR_PHASE_TICKS 1000U
+#define MPU_GUARD_CALLS 1000U // guard moves timed by mpu_guard_cycles, well below one tick in total
+
+#define SYST_RVR (*(volatile uint32_t*)0xE000E014U)
+#define SYST_CVR (*(volatile uint32_t*)0xE000E018U)
+
+//semihosting init fcn
+extern void initialise_monitor_handles(void);
+
+void idle_task(void);
+void task1_handler(void);
+void task2_handler(void);
+void task3_handler(void);
+void task4_handler(void);
+
+static const task_config_t task_config[MAX_TASKS] = {
+	{ idle_task, IDLE_STACK_START, 0 },
+	{ task1_handler, T1_STACK_START, 0 },
+	{ task2_handler, T2_STACK_START, 0 },
+	{ task3_handler, T3_STACK_START, 0 },
+	{ task4_handler, T4_STACK_START, 0 },
+};
+
+static const uint32_t delay_period[4] = { 0, 1, 10, 25 };
+
+static volatile uint32_t phase;
+static volatile uint32_t run_count[MAX_TASKS];
+static volatile uint32_t rr_count[MAX_TASKS];
+static volatile uint32_t lat_min = 0xFFFFFFFFU, lat_max, lat_sum, lat_n;
+static uint32_t failures;
+
+int main(void)
+{
+	enable_processor_faults();
+
+	init_scheduler_stack(SCHEDU_STACK_START);
+
+	init_task_stack(task_config);
+
+#if KERNEL_CONFIG_MPU_GUARD
+	kernel_mpu_init();
+#endif
+
+	initialise_monitor_handles();
+
+	k_printf("kernel regression on qemu\n");
+
+#if KERNEL_CONFIG_STATS
+	kernel_stats_init();
+#endif
+	trace_init();
+	log_init();
+
+	init_systick_timer(TICK_HZ);
+
+	switch_sp_to_psp();
+
+	task1_handler();
+	for(;;);
+}
+
+void idle_task(void)
+{
+	while(1)
+	{
+		log_drain();
+#if KERNEL_CONFIG_STACK_CHECK
+		kernel_stack_scan();
+#endif
+	}
+}
+
+/*
+ * tasks 1-3, blocking in PHASE_DELAY and busy in PHASE_RR
+ */
+static void test_task(void)
+{
+	uint32_t task = current_task;
+	uint32_t elapsed;
+
+	while(phase != PHASE_DONE)
+	{
+		if(phase == PHASE_DELAY)
+		{
+			task_delay(delay_period[task]);
+			if(task == 1)
+			{
+				//SysTick counts down from RVR, so this is the time from the tick to the task running again
+				elapsed = SYST_RVR - SYST_CVR;
+				lat_min = (elapsed < lat_min) ? elapsed : lat_min;
+				lat_max = (elapsed > lat_max) ? elapsed : lat_max;
+				lat_sum += elapsed;
+				lat_n++;
+			}
+			run_count[task]++;
+		}
+		else if(phase == PHASE_RR)
+		{
+			rr_count[task]++;
+		}
+		else
+		{
+			task_delay(1);
+		}
+	}
+	while(1)
+	{
+		task_delay(1000);
+	}
+}
+
+void task1_handler(void)
+{
+	test_task();
+}
+
+void task2_handler(void)
+{
+	test_task();
+}
+
+void task3_handler(void)
+{
+	test_task();
+}
+
+static void check(uint32_t ok, const char *p_name)
+{
+	k_printf("TEST %s %s\n", p_name, ok ? "PASS" : "FAIL");
+	if(!ok)
+	{
+		failures++;
+	}
+}
+
+static void result(const char *p_name, uint32_t value, const char *p_better)
+{
+	k_printf("RESULT %s %lu %s\n", p_name, value, p_better);
+}
+
+/*
+ * SysTick cycles between two CVR reads, CVR counts down and reloads from RVR, so one reload in between is allowed
+ */
+static uint32_t systick_elapsed(uint32_t start, uint32_t end)
+{
+	return (start >= end) ? (start - end) : (start + SYST_RVR + 1 - end);
+}
+
+#if KERNEL_CONFIG_MPU_GUARD
+/*
+ * cost of the guard move of every switch: port_task_switched (call, stack_limit load, RBAR write, DSB) timed over
+ * MPU_GUARD_CALLS calls with interrupts masked, minus the same loop without the call, in cycles per call
+ */
+static uint32_t mpu_guard_cycles(void)
+{
+	uint32_t primask, start, loop, guard;
+
+	primask = port_irq_save();
+	start = SYST_CVR;
+	for(volatile uint32_t i = 0; i < MPU_GUARD_CALLS; i++);
+	loop = systick_elapsed(start, SYST_CVR);
+	start = SYST_CVR;
+	for(volatile uint32_t i = 0; i < MPU_GUARD_CALLS; i++)
+	{
+		//the guard stays on the running task, so the write is the one a switch to it would make
+		port_task_switched(current_task);
+	}
+	guard = systick_elapsed(start, SYST_CVR);
+	port_irq_restore(primask);
+
+	return (guard > loop) ? (guard - loop) / MPU_GUARD_CALLS : 0;
+}
+#endif
+
+void task4_handler(void)
+{
+	uint32_t start, expected, min, max, total;
+
+	//delay: each task has to run once per period, the tick that starts the phase can add one run
+	start = g_tick_count;
+	phase = PHASE_DELAY;
+	task_delay(DELAY_PHASE_TICKS);
+	phase = 0;
+	for(uint32_t i = 1; i < 4; i++)
+	{
+		expected = (g_tick_count - start) / delay_period[i];
+		check((run_count[i] + 1 >= expected) && (run_count[i] <= expected + 1),
+				(i == 1) ? "delay_1" : (i == 2) ? "delay_10" : "delay_25");
+	}
+	result("wakeup_latency_min", lat_min, "lower");
+	result("wakeup_latency_max", lat_max, "lower");
+	result("wakeup_latency_avg", lat_n ? (lat_sum / lat_n) : 0, "lower");
+
+	//rr: equal share within 10%, the iterations per tick show what the tick and the switches leave to the tasks
+	phase = PHASE_RR;
+	task_delay(RR_PHASE_TICKS);
+	phase = PHASE_DONE;
+	min = 0xFFFFFFFFU;
+	max = 0;
+	total = 0;
+	for(uint32_t i = 1; i < 4; i++)
+	{
+		min = (rr_count[i] < min) ? rr_count[i] : min;
+		max = (rr_count[i] > max) ? rr_count[i] : max;
+		total += rr_count[i];
+	}
+	check((max - min) <= (max / 10), "rr_fairness");
+	result("rr_iterations_per_tick", total / RR_PHASE_TICKS, "higher");
+
+#if KERNEL_CONFIG_MPU_GUARD
+	result("mpu_guard_cycles", mpu_guard_cycles(), "lower");
+#endif
+
+#if KERNEL_CONFIG_STACK_CHECK
+	static const char *const stack_names[MAX_TASKS] = { "stack_idle", "stack_task1", "stack_task2", "stack_task3",
+			"stack_task4" };
+	for(uint32_t i = 0; i < MAX_TASKS; i++)
+	{
+		uint32_t used = kernel_get_stack_usage(i);
+		check(used < (TASK_STACK_SIZE - STACK_GUARD_SIZE - STACK_OVERFLOW_MARGIN), stack_names[i]);
+		result(stack_names[i], used, "lower");
+	}
+#endif
+
+	//let the idle task drain anything still logged
+	task_delay(10);
+	k_printf("DONE %lu failed\n", failures);
+	exit((int)failures);
+}
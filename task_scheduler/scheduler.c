@@ -5,152 +5,169 @@
  *      Author: krisko
  */
 #include <stdint.h>
-#include <stdio.h>
 #include "main.h"
+#include "port.h"
 #include "scheduler.h"
-#include "tasks.h"
+#include "kprintf.h"
+#include "trace.h"
 
 uint32_t current_task = 1; //start with TASK1
 TCD_t user_tasks[MAX_TASKS];
 uint32_t g_tick_count = 0;
 
-void save_psp_value(uint32_t current_psp_val)
+#if KERNEL_CONFIG_STATS
+static uint32_t stats_last_cycles; // CYCCNT when the running context was last charged
+static uint32_t stats_isr_nesting;
+static uint64_t stats_isr_cycles;
+static uint64_t stats_prev_run[MAX_TASKS]; // counters at the previous kernel_get_stats call
+static uint32_t stats_prev_switch[MAX_TASKS];
+static uint64_t stats_prev_isr;
+
+static void stats_charge_task(void);
+#endif
+
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_EDF
+static uint32_t edf_head = MAX_TASKS; // ready task with the earliest deadline, MAX_TASKS -> no task ready
+
+static void edf_insert(uint32_t task);
+static void edf_remove(uint32_t task);
+static void edf_check_deadlines(void);
+#endif
+
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_TT
+static const tt_schedule_t *p_tt_schedule;
+static uint32_t tt_frame; // current minor frame
+static uint32_t tt_slot; // current slot in the frame, slot_count -> slack
+static uint32_t tt_frame_tick; // ticks since the frame started
+static uint32_t tt_background; // last background task that ran, index into p_background
+
+static void tt_tick(void);
+#endif
+
+#if KERNEL_CONFIG_BUDGET
+static uint32_t budget_last_cycles; // cycle count when the running task was last charged
+static uint8_t budget_started; // the first charge only sets budget_last_cycles, boot time is not charged
+static uint32_t budget_demoted; // last demoted task that ran
+
+static void budget_charge(void);
+static void budget_replenish(void);
+static void budget_ss_end(uint32_t task);
+static int budget_may_run(uint32_t task);
+static uint32_t budget_demoted_task(void);
+#endif
+
+void save_psp_value(uintptr_t current_psp_val)
 {
 	user_tasks[current_task].psp_val = current_psp_val;
-}
-
-uint32_t get_psp_value(void)
-{
-	return user_tasks[current_task].psp_val;
-}
-
-__attribute__((naked)) void switch_sp_to_psp(void) // need naked bc in c fcn prologue LR is pushed onto stack at MSP
-{													// in epilogue, it POP whatever on the stack at PSP to PC
-
-	/* CUATION! here the BL corrupts the LR value as it stores the address of this fcn to get back from get_psp_value
-	 * so we need to save it first
-	 */
-	__asm volatile("PUSH {LR}");
-	//get value of PSP of the current task
-	__asm volatile("BL get_psp_value"); // calls get_PSP_value and returns with R0 containing the value
-	//initialize PSP
-	__asm volatile("MSR PSP,R0");
-	//POP the original value of LR from stack back to LR
-	__asm volatile("POP {LR}");
-
-	//change SP to PSP
-	__asm volatile("MOV R0,#0x02"); //store the value to config into R0 first, R0 is spare now bc the PSP value is already loaded to PSP
-	__asm volatile("MSR CONTROL,R0 ");
-	__asm volatile("BX LR"); // return
-}
-
-
-void init_systick_timer(uint32_t tick_hz)
-{
-	uint32_t count_val = (SYSTIC_TIMER_CLOCK / tick_hz) - 1;
-	uint32_t *p_SRVR = (uint32_t*)0xE000E014;
-
-	//clear the value of SRVR
-	*p_SRVR &= ~(0x00FFFFFF);
-
-	//load the value into SRVR
-	*p_SRVR |= count_val;
-
-	//do some settings
-	uint32_t *p_SCSR = (uint32_t*)0xE000E010;
-	*p_SCSR |= (1 << 1); // enable the systick exception request
-	*p_SCSR |= (1 << 2); // use processor clock
-
-	*p_SCSR |= 1; // enable the counter
-
 
+#if KERNEL_CONFIG_STACK_CHECK
+	//the saved context must be above the margin and the bottom word must still hold the paint pattern
+	//the MPU guard (if enabled) is below the usable stack and must not be read here
+	if( (current_psp_val < (user_tasks[current_task].stack_limit + STACK_GUARD_SIZE + STACK_OVERFLOW_MARGIN)) ||
+		(*(uint32_t*)(user_tasks[current_task].stack_limit + STACK_GUARD_SIZE) != STACK_PAINT_PATTERN) )
+	{
+		kernel_stack_overflow_hook(current_task);
+	}
+#endif
 }
 
-__attribute__ ((naked)) void init_scheduler_stack(uint32_t schedu_top_of_stack)
+uintptr_t get_psp_value(void)
 {
-	//change msp (handler sp) to the correct address of the scheduler stack
-	__asm volatile("MSR MSP,%0" : : "r"(schedu_top_of_stack));
-	__asm volatile("BX LR"); // get back to caller
+	return user_tasks[current_task].psp_val;
 }
 
-void init_task_stack(void)
+/*
+ * sets up the TCD and the first stack frame of every task from the application's task table
+ */
+void init_task_stack(const task_config_t *p_task_config)
 {
-	//when it is the first time the tasks are run, there were no past status/context
-	//so can't really retrieve the contaxt as there are nothing on the stack
-	//to solve this, create some dummy variables on the stack:
-	// general registers -> all set to 0
-	// xPSR -> only need t bit to be 1
-	// PC -> the corresponding task handler
-	// LR -> EXC_RETURN, should be 0xFFFFFFFD as we need return to thread with PSP
-	user_tasks[0].current_state = TASK_READY_STATE;
-	user_tasks[1].current_state = TASK_READY_STATE;
-	user_tasks[2].current_state = TASK_READY_STATE;
-	user_tasks[3].current_state = TASK_READY_STATE;
-	user_tasks[4].current_state = TASK_READY_STATE;
-
-
-	user_tasks[0].psp_val = IDLE_STACK_START;
-	user_tasks[1].psp_val = T1_STACK_START;
-	user_tasks[2].psp_val = T2_STACK_START;
-	user_tasks[3].psp_val = T3_STACK_START;
-	user_tasks[4].psp_val = T4_STACK_START;
-
-	user_tasks[0].task_handler = idle_task;
-	user_tasks[1].task_handler = task1_handler;
-	user_tasks[2].task_handler = task2_handler;
-	user_tasks[3].task_handler = task3_handler;
-	user_tasks[4].task_handler = task4_handler;
-
-
-
-
-	uint32_t *p_PSP;
 	for(int i = 0; i < MAX_TASKS; i++)
 	{
-		p_PSP = (uint32_t*) user_tasks[i].psp_val;
-
-		//stack model is full descending so decrement first, then store the value
-		p_PSP--;
-		*p_PSP = DUMMY_XPSR;
+		user_tasks[i].current_state = TASK_READY_STATE;
+		user_tasks[i].task_handler = p_task_config[i].task_handler;
+		user_tasks[i].stack_limit = p_task_config[i].stack_top - TASK_STACK_SIZE;
 
-		//PC, need to point to the task_handler
-		p_PSP--;
-		*p_PSP = (uint32_t) user_tasks[i].task_handler;
+#if KERNEL_CONFIG_STACK_CHECK
+		//paint the whole stack, words still holding the pattern later were never used
+		for(uint32_t *p_word = (uint32_t*)user_tasks[i].stack_limit; p_word < (uint32_t*)p_task_config[i].stack_top; p_word++)
+		{
+			*p_word = STACK_PAINT_PATTERN;
+		}
+		user_tasks[i].stack_peak = 0;
+#endif
 
-		//LR
-		p_PSP--;
-		*p_PSP = 0xFFFFFFFD;
+		user_tasks[i].psp_val = port_init_task_frame(i, p_task_config[i].stack_top, p_task_config[i].task_handler);
 
-		//general registers
-		for(int j = 0; j < 13; j++)
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_EDF
+		//every task is released at tick 0, the idle task is never in the ready list
+		user_tasks[i].rel_deadline = p_task_config[i].deadline;
+		user_tasks[i].abs_deadline = p_task_config[i].deadline;
+		user_tasks[i].miss_count = 0;
+		if(i)
 		{
-			p_PSP--;
-			*p_PSP = 0;
-
+			edf_insert(i);
 		}
-		//preserve the value of PSP, as it is modified during the process
-		user_tasks[i].psp_val = (uint32_t)p_PSP;
-
+#endif
+
+#if KERNEL_CONFIG_BUDGET
+		//the first period starts at tick 0 with the full budget
+		user_tasks[i].budget_cycles = i ? p_task_config[i].budget_cycles : 0;
+		user_tasks[i].budget_period = p_task_config[i].budget_period;
+		user_tasks[i].budget_mode = p_task_config[i].budget_mode;
+		user_tasks[i].budget_left = (int32_t)user_tasks[i].budget_cycles;
+		user_tasks[i].replenish_tick = p_task_config[i].budget_period;
+		user_tasks[i].budget_exhausted = 0;
+		user_tasks[i].exhaust_count = 0;
+		user_tasks[i].ss_active = 0;
+		user_tasks[i].ss_repl_count = 0;
+#endif
 	}
 }
 
 void task_delay(uint32_t tick_count)
 {
 	//disable interrupt
-	INTERRUPT_DISABLE();
+	uint32_t primask = port_irq_save();
 	//only block the task if it not the idle task
 	if(current_task)
 	{
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_TT
+		const tt_frame_t *p_frame = &p_tt_schedule->p_frames[tt_frame];
+		if( (tt_slot < p_frame->slot_count) && (p_frame->p_slots[tt_slot] == current_task) )
+		{
+			//slot done, start the next one (or the slack) now, the table decides when this task runs again
+			user_tasks[current_task].current_state = TASK_BlOCKED_STATE;
+			tt_slot++;
+			if(tt_slot < p_frame->slot_count)
+			{
+				user_tasks[p_frame->p_slots[tt_slot]].current_state = TASK_READY_STATE;
+			}
+			TRACE_EVENT(TRACE_EV_BLOCK, current_task, 0);
+			schedule();
+			port_irq_restore(primask);
+			return;
+		}
+#endif
+#if KERNEL_CONFIG_BUDGET
+		//a sporadic server that blocks ends its activation, what it used so far comes back one period later
+		budget_charge();
+		budget_ss_end(current_task);
+#endif
 		//add block count to the task
 		user_tasks[current_task].block_count = g_tick_count + tick_count;
 		//change to blocked state
 		user_tasks[current_task].current_state = TASK_BlOCKED_STATE;
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_EDF
+		//the job is done, its next release is when the delay ends
+		edf_remove(current_task);
+#endif
+		TRACE_EVENT(TRACE_EV_BLOCK, current_task, tick_count);
 		//pend pendSV exception
 		schedule(); // switches to another task to allow other tasks to run
 	}
 
 	//enable interrupt
-	INTERRUPT_ENABLE();
+	port_irq_restore(primask);
 }
 
 void update_global_tick_count(void)
@@ -160,9 +177,8 @@ void update_global_tick_count(void)
 
 void schedule(void)
 {
-	uint32_t *p_ICSR = (uint32_t*) 0xE000ED04;
-	//pend the pendSV exception
-	*p_ICSR |= (1 << 28);
+	//pend the context switch (PendSV on target)
+	port_pend_switch();
 }
 
 void unblock_tasks(void)
@@ -170,12 +186,25 @@ void unblock_tasks(void)
 	//unblock any tasks that are qualified for running
 	for(int i = 1; i < MAX_TASKS; i++)//ignores the idle task
 	{
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_TT
+		//slot tasks are blocked without a block_count, a stale one must not release them outside their slot
+		if(user_tasks[i].tt_slot_task)
+		{
+			continue;
+		}
+#endif
 		if(user_tasks[i].current_state != TASK_READY_STATE)
 		{
 			//blocking period has elapsed
 			if(user_tasks[i].block_count == g_tick_count)
 			{
 				user_tasks[i].current_state = TASK_READY_STATE;
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_EDF
+				//new job, its deadline counts from this tick
+				user_tasks[i].abs_deadline = g_tick_count + user_tasks[i].rel_deadline;
+				edf_insert(i);
+#endif
+				TRACE_EVENT(TRACE_EV_UNBLOCK, i, 0);
 			}
 		}
 	}
@@ -183,6 +212,50 @@ void unblock_tasks(void)
 
 void update_next_task(void)
 {
+#if KERNEL_CONFIG_STATS || KERNEL_CONFIG_TRACE
+	uint32_t prev_task = current_task;
+#endif
+#if KERNEL_CONFIG_STATS
+	//charge the outgoing task up to the switch
+	stats_charge_task();
+#endif
+#if KERNEL_CONFIG_BUDGET
+	budget_charge();
+#endif
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_EDF
+#if KERNEL_CONFIG_BUDGET
+	//earliest deadline with budget left
+	current_task = edf_head;
+	while( (current_task != MAX_TASKS) && !budget_may_run(current_task) )
+	{
+		current_task = user_tasks[current_task].edf_next;
+	}
+	current_task = (current_task != MAX_TASKS) ? current_task : 0;
+#else
+	//the head of the ready list has the earliest deadline, idle when the list is empty
+	current_task = (edf_head != MAX_TASKS) ? edf_head : 0;
+#endif
+#elif KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_TT
+	const tt_frame_t *p_frame = &p_tt_schedule->p_frames[tt_frame];
+	if(tt_slot < p_frame->slot_count)
+	{
+		current_task = p_frame->p_slots[tt_slot];
+	}
+	else
+	{
+		//slack, next ready background task after the last one that ran, idle when there is none
+		current_task = 0;
+		for(uint32_t i = 0; i < p_tt_schedule->background_count; i++)
+		{
+			tt_background = (tt_background + 1) % p_tt_schedule->background_count;
+			if(user_tasks[p_tt_schedule->p_background[tt_background]].current_state == TASK_READY_STATE)
+			{
+				current_task = p_tt_schedule->p_background[tt_background];
+				break;
+			}
+		}
+	}
+#else
 	//finds the next task that is ready to run
 	int state = TASK_BlOCKED_STATE;
 	for (int i = 0; i < MAX_TASKS; i++)
@@ -190,6 +263,13 @@ void update_next_task(void)
 		current_task++;
 		current_task %= MAX_TASKS; // current task will always be 0-3 inclusive and gets back to 0 when it is 4 -> round-robin
 		state = user_tasks[current_task].current_state;
+#if KERNEL_CONFIG_BUDGET
+		//out of budget counts as blocked here, demoted tasks get their turn below
+		if( (state == TASK_READY_STATE) && !budget_may_run(current_task) )
+		{
+			state = TASK_BlOCKED_STATE;
+		}
+#endif
 		//only break if the task is not the idle_task, b/c idle_task's state is always TASK_READY_STATE
 		if( (state == TASK_READY_STATE) && (current_task != 0))
 		{
@@ -201,89 +281,514 @@ void update_next_task(void)
 	{
 		current_task = 0;
 	}
+#endif
+
+#if KERNEL_CONFIG_BUDGET
+	if(current_task == 0)
+	{
+		//nothing with budget left is ready, demoted tasks share what would be idle time
+		current_task = budget_demoted_task();
+	}
+	//a sporadic server activation starts when it gets the CPU with budget left
+	if( (user_tasks[current_task].budget_mode == BUDGET_MODE_SPORADIC) && user_tasks[current_task].budget_cycles &&
+			!user_tasks[current_task].ss_active && budget_may_run(current_task) )
+	{
+		user_tasks[current_task].ss_active = 1;
+		user_tasks[current_task].ss_start = g_tick_count;
+		user_tasks[current_task].ss_consumed = 0;
+	}
+#endif
+
+#if KERNEL_CONFIG_STATS || KERNEL_CONFIG_TRACE
+	if(current_task != prev_task)
+	{
+#if KERNEL_CONFIG_STATS
+		user_tasks[current_task].switch_count++;
+#endif
+		TRACE_EVENT(TRACE_EV_SWITCH_IN, current_task, 0);
+	}
+#endif
+
+	port_task_switched(current_task);
 }
 
-void enable_processor_faults(void)
+void kernel_tick(void)
 {
-	uint32_t *p_SHCSR = (uint32_t*)0xE000ED24;
-	*p_SHCSR |= (1 << 18); // usage fault
-	*p_SHCSR |= (1 << 17); // bus fault
-	*p_SHCSR |= (1 << 16); // mem fault
+	update_global_tick_count();
+#if KERNEL_CONFIG_BUDGET
+	//charge the running task up to this tick before the budgets are replenished
+	budget_charge();
+	budget_replenish();
+#endif
+	//unblock qualified tasks
+	unblock_tasks();
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_EDF
+	edf_check_deadlines();
+#endif
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_TT
+	//the table decides, PendSV only when the frame changes or in the slack
+	tt_tick();
+#else
+	//pendSV
+	schedule();
+#endif
 }
 
-__attribute__((naked)) void PendSV_Handler(void)
+#if KERNEL_CONFIG_STATS
+void kernel_stats_init(void)
 {
-	//do context switching to switch to the next ready to run task
+	port_stats_init();
+	stats_last_cycles = PORT_CYCLES();
+}
 
-	/*save the context of current task*/
-	//1. get current running task's PSP value
-	__asm volatile("MRS R0, PSP"); // store the PSP value to R0
+/*
+ * charge the cycles since the last accounting point to the running task, called with interrupts masked or from
+ * an exception that can not be preempted by another accounting point
+ */
+static void stats_charge_task(void)
+{
+	uint32_t now = PORT_CYCLES();
 
-	//2. using the PSP value, store SF2( R4 to R11)
-	/* caution:
-	 * - can't just use push b/c the handler always uses MSP, which will only push the values to the MSP stack,
-	 * 	 not the task private stack
-	 * 		-> use STMDB to save the values at the PSP address extracted into R0
-	 * 				->stores into multiple registers and "decrements before" (decrement first then store)
-	 */
-	__asm volatile("STMDB R0!, {R4-R11}"); // ! means that the final address that is stored will be loaded back to R0
+	if(stats_isr_nesting == 0)
+	{
+		user_tasks[current_task].run_cycles += (uint32_t)(now - stats_last_cycles);
+		stats_last_cycles = now;
+	}
+}
 
-	//3. save the current value of PSP
-	__asm volatile("PUSH {LR}"); // push LR onto the stack first, because c fcn calls will corrupt LR
-	__asm volatile("BL save_psp_value");// R0 is passed as parameter by default
+/*
+ * wrap an interrupt handler with kernel_isr_enter/exit so its time is not charged to the interrupted task
+ */
+void kernel_isr_enter(void)
+{
+	uint32_t primask = port_irq_save();
 
-	/*retrieve the context of next task*/
-	//1. decide next task to run
-	__asm volatile("BL update_next_task");
+	stats_charge_task();
+	stats_isr_nesting++;
 
-	//2. get the task's past PSP value
-	__asm volatile("BL get_psp_value");
+	port_irq_restore(primask);
+}
 
-	//3. using that PSP value retrieve SF2( R4 to R11), SF1 will be automatically retrieved when exiting handler
-	 __asm volatile("LDMIA R0!, {R4-R11}");//load multiple from memory to register, increment address after each access
+void kernel_isr_exit(void)
+{
+	uint32_t now;
+	uint32_t primask = port_irq_save();
 
-	//4. update PSP and exit
-	 __asm volatile("MSR PSP, R0");
+	//only the outermost handler charges the interrupt time
+	if(--stats_isr_nesting == 0)
+	{
+		now = PORT_CYCLES();
+		stats_isr_cycles += (uint32_t)(now - stats_last_cycles);
+		stats_last_cycles = now;
+	}
 
-	//pop back the LR pushed to stack
-	 __asm volatile("POP {LR}");
+	port_irq_restore(primask);
+}
+
+void kernel_get_stats(kernel_stats_t *p_stats)
+{
+	uint64_t run[MAX_TASKS], isr, total = 0;
+	uint32_t primask = port_irq_save();
+
+	//bring the calling task up to date so the interval ends now
+	stats_charge_task();
+	for(int i = 0; i < MAX_TASKS; i++)
+	{
+		run[i] = user_tasks[i].run_cycles - stats_prev_run[i];
+		stats_prev_run[i] = user_tasks[i].run_cycles;
+		p_stats->switch_count[i] = user_tasks[i].switch_count - stats_prev_switch[i];
+		stats_prev_switch[i] = user_tasks[i].switch_count;
+		total += run[i];
+	}
+	isr = stats_isr_cycles - stats_prev_isr;
+	stats_prev_isr = stats_isr_cycles;
+	port_irq_restore(primask);
 
-	//return
-	 __asm volatile("BX LR");
+	total += isr;
+	p_stats->total_cycles = total;
+	if(total == 0)
+	{
+		total = 1;
+	}
+	for(int i = 0; i < MAX_TASKS; i++)
+	{
+		p_stats->load_permille[i] = (uint32_t)((run[i] * 1000) / total);
+	}
+	p_stats->isr_permille = (uint32_t)((isr * 1000) / total);
+	p_stats->idle_permille = p_stats->load_permille[0];
 }
+#endif
 
-void SysTick_Handler(void)
+#if KERNEL_CONFIG_STACK_CHECK
+/*
+ * returns the peak stack usage of the task in bytes, found by scanning up from the stack bottom for the first
+ * word that no longer holds the paint pattern
+ */
+uint32_t kernel_get_stack_usage(uint32_t task)
 {
+	uint32_t *p_word = (uint32_t*)(user_tasks[task].stack_limit + STACK_GUARD_SIZE);
+	uint32_t *p_top = (uint32_t*)(user_tasks[task].stack_limit + TASK_STACK_SIZE);
+	uint32_t used;
 
-	update_global_tick_count();
-	//unblock qualified tasks
-	unblock_tasks();
-	//pendSV
-	schedule();
+	while( (p_word < p_top) && (*p_word == STACK_PAINT_PATTERN) )
+	{
+		p_word++;
+	}
 
+	used = (uint32_t)((uintptr_t)p_top - (uintptr_t)p_word);
+	if(used > user_tasks[task].stack_peak)
+	{
+		user_tasks[task].stack_peak = used;
+	}
+	return user_tasks[task].stack_peak;
 }
 
-void HardFault_Handler(void)
+/*
+ * background scanner called from the idle task, updates the high-water mark of one task per call
+ */
+void kernel_stack_scan(void)
 {
-	printf("hard fault\n");
-	while(1);
+	static uint32_t scan_task = 0;
+
+	kernel_get_stack_usage(scan_task);
+	scan_task = (scan_task + 1) % MAX_TASKS;
 }
 
-void MemManage_Handler(void)
+/*
+ * called from PendSV when the outgoing task's saved PSP is in the overflow margin or the bottom of its stack was
+ * overwritten, can be overridden by the application
+ */
+__attribute__((weak)) void kernel_stack_overflow_hook(uint32_t task)
 {
-	printf("mem fault\n");
+	k_printf("stack overflow in task %lu\n", (unsigned long)task);
 	while(1);
 }
+#endif
 
-void BusFault_Handler(void)
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_EDF
+/*
+ * 1 if task a has to run before task b, tasks without a deadline go after every task with one,
+ * equal deadlines keep their release order
+ */
+static int edf_before(uint32_t a, uint32_t b)
 {
-	printf("bus fault\n");
-	while(1);
+	if(user_tasks[a].rel_deadline == 0)
+	{
+		return 0;
+	}
+	if(user_tasks[b].rel_deadline == 0)
+	{
+		return 1;
+	}
+	//the tick count wraps, compare the distance
+	return (int32_t)(user_tasks[a].abs_deadline - user_tasks[b].abs_deadline) < 0;
 }
 
-void UsageFault_Handler(void)
+/*
+ * sorted insert into the ready list, called with interrupts masked or from SysTick
+ */
+static void edf_insert(uint32_t task)
 {
-	printf("usage fault\n");
-	while(1);
+	uint32_t *p_link = &edf_head;
+
+	while( (*p_link != MAX_TASKS) && !edf_before(task, *p_link) )
+	{
+		p_link = &user_tasks[*p_link].edf_next;
+	}
+	user_tasks[task].edf_next = *p_link;
+	*p_link = task;
+}
+
+static void edf_remove(uint32_t task)
+{
+	uint32_t *p_link = &edf_head;
+
+	while(*p_link != MAX_TASKS)
+	{
+		if(*p_link == task)
+		{
+			*p_link = user_tasks[task].edf_next;
+			return;
+		}
+		p_link = &user_tasks[*p_link].edf_next;
+	}
+}
+
+/*
+ * a job that is still ready at its deadline tick missed it, the list is sorted so only the head has to be checked
+ * fallback: the late job gets a new deadline one relative deadline from now, so it competes with the other tasks
+ * again instead of holding the head of the list and making them late too (domino effect of EDF under overload)
+ */
+static void edf_check_deadlines(void)
+{
+	uint32_t task;
+
+	while( (edf_head != MAX_TASKS) && user_tasks[edf_head].rel_deadline &&
+			((int32_t)(g_tick_count - user_tasks[edf_head].abs_deadline) >= 0) )
+	{
+		task = edf_head;
+		user_tasks[task].miss_count++;
+		TRACE_EVENT(TRACE_EV_DEADLINE_MISS, task, user_tasks[task].abs_deadline);
+		kernel_deadline_miss_hook(task);
+
+		edf_remove(task);
+		user_tasks[task].abs_deadline = g_tick_count + user_tasks[task].rel_deadline;
+		edf_insert(task);
+	}
+}
+
+/*
+ * called from SysTick for every missed deadline, can be overridden by the application (keep it short, it runs in
+ * the tick), miss_count in the TCD counts the misses
+ */
+__attribute__((weak)) void kernel_deadline_miss_hook(uint32_t task)
+{
+	(void)task;
 }
+#endif
+
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_TT
+/*
+ * starts the schedule with the first slot of frame 0, call after init_task_stack and before the first task runs
+ * (the start code runs user_tasks[current_task])
+ */
+void kernel_tt_init(const tt_schedule_t *p_schedule)
+{
+	p_tt_schedule = p_schedule;
+	tt_frame = 0;
+	tt_slot = 0;
+	tt_frame_tick = 0;
+	tt_background = p_schedule->background_count ? (p_schedule->background_count - 1) : 0;
+
+	//slot tasks only run when the table dispatches them
+	for(uint32_t i = 0; i < MAX_TASKS; i++)
+	{
+		user_tasks[i].tt_slot_task = 0;
+	}
+	for(uint32_t f = 0; f < p_schedule->frame_count; f++)
+	{
+		for(uint32_t i = 0; i < p_schedule->p_frames[f].slot_count; i++)
+		{
+			user_tasks[p_schedule->p_frames[f].p_slots[i]].current_state = TASK_BlOCKED_STATE;
+			user_tasks[p_schedule->p_frames[f].p_slots[i]].tt_slot_task = 1;
+		}
+	}
 
+	//first task to run, the first slot of frame 0 or the first background task in the slack
+	if(p_schedule->p_frames[0].slot_count)
+	{
+		current_task = p_schedule->p_frames[0].p_slots[0];
+		user_tasks[current_task].current_state = TASK_READY_STATE;
+	}
+	else
+	{
+		current_task = p_schedule->background_count ? p_schedule->p_background[0] : 0;
+		tt_background = 0;
+	}
+}
+
+/*
+ * one table index per tick, at a frame boundary the slot that is still running overran, the rest of the frame
+ * is dropped and the next frame starts with its first slot
+ */
+static void tt_tick(void)
+{
+	const tt_frame_t *p_frame = &p_tt_schedule->p_frames[tt_frame];
+
+	if(++tt_frame_tick < p_tt_schedule->frame_ticks)
+	{
+		//background tasks share the slack round-robin at every tick
+		if(tt_slot >= p_frame->slot_count)
+		{
+			schedule();
+		}
+		return;
+	}
+
+	if(tt_slot < p_frame->slot_count)
+	{
+		uint32_t task = p_frame->p_slots[tt_slot];
+		user_tasks[task].overrun_count++;
+		user_tasks[task].current_state = TASK_BlOCKED_STATE;
+		TRACE_EVENT(TRACE_EV_OVERRUN, task, (tt_frame << 8) | tt_slot);
+		kernel_tt_overrun_hook(tt_frame, tt_slot, task);
+	}
+
+	tt_frame_tick = 0;
+	tt_frame = (tt_frame + 1) % p_tt_schedule->frame_count;
+	tt_slot = 0;
+	p_frame = &p_tt_schedule->p_frames[tt_frame];
+	if(p_frame->slot_count)
+	{
+		user_tasks[p_frame->p_slots[0]].current_state = TASK_READY_STATE;
+	}
+	schedule();
+}
+
+/*
+ * called from SysTick when a slot task is still running at the end of its frame, it is preempted and continues
+ * the same job in its next slot, can be overridden by the application (keep it short, it runs in the tick)
+ */
+__attribute__((weak)) void kernel_tt_overrun_hook(uint32_t frame, uint32_t slot, uint32_t task)
+{
+	(void)frame;
+	(void)slot;
+	(void)task;
+}
+#endif
+
+#if KERNEL_CONFIG_BUDGET
+/*
+ * charge the cycles since the last charge to the running task's budget, called at every tick and switch so a task
+ * can overrun its budget by at most one tick before it is taken off the CPU, a periodic budget pays the overrun
+ * back from the next period, a sporadic server gets back all it used (so up to a tick more than its budget per
+ * activation)
+ */
+static void budget_charge(void)
+{
+	uint32_t now = PORT_CYCLES();
+	uint32_t used = now - budget_last_cycles;
+	TCD_t *p_task = &user_tasks[current_task];
+
+	budget_last_cycles = now;
+	if(!budget_started)
+	{
+		budget_started = 1;
+		return;
+	}
+	//an exhausted task that still runs is demoted, it runs in the idle time and that is not charged (budget_left
+	//would only grow more negative and wrap after a few seconds)
+	if( (p_task->budget_cycles == 0) || p_task->budget_exhausted )
+	{
+		return;
+	}
+
+	p_task->budget_left -= (int32_t)used;
+	if(p_task->ss_active)
+	{
+		p_task->ss_consumed += used;
+	}
+	if( (p_task->budget_left <= 0) && !p_task->budget_exhausted )
+	{
+		p_task->budget_exhausted = 1;
+		p_task->exhaust_count++;
+		TRACE_EVENT(TRACE_EV_BUDGET, current_task, 0);
+		budget_ss_end(current_task);
+		kernel_budget_exhausted_hook(current_task);
+	}
+}
+
+/*
+ * periodic budgets are refilled every budget_period ticks, a sporadic server gets back each chunk it used one
+ * period after the activation that used it started
+ */
+static void budget_replenish(void)
+{
+	TCD_t *p_task;
+
+	for(int i = 1; i < MAX_TASKS; i++)
+	{
+		p_task = &user_tasks[i];
+		if(p_task->budget_cycles == 0)
+		{
+			continue;
+		}
+
+		if(p_task->budget_mode == BUDGET_MODE_SPORADIC)
+		{
+			//replenishments are queued in activation order, only the oldest can be due
+			while( p_task->ss_repl_count && (p_task->ss_repl_tick[0] == g_tick_count) )
+			{
+				p_task->budget_left += (int32_t)p_task->ss_repl_amount[0];
+				p_task->ss_repl_count--;
+				for(uint32_t r = 0; r < p_task->ss_repl_count; r++)
+				{
+					p_task->ss_repl_tick[r] = p_task->ss_repl_tick[r + 1];
+					p_task->ss_repl_amount[r] = p_task->ss_repl_amount[r + 1];
+				}
+			}
+			if(p_task->budget_left > (int32_t)p_task->budget_cycles)
+			{
+				p_task->budget_left = (int32_t)p_task->budget_cycles;
+			}
+		}
+		else if(p_task->replenish_tick == g_tick_count)
+		{
+			//an overrun of the last period is paid back from this one
+			p_task->budget_left = (p_task->budget_left < 0) ? (p_task->budget_left + (int32_t)p_task->budget_cycles) :
+					(int32_t)p_task->budget_cycles;
+			p_task->replenish_tick += p_task->budget_period;
+		}
+
+		if(p_task->budget_exhausted && (p_task->budget_left > 0))
+		{
+			p_task->budget_exhausted = 0;
+		}
+	}
+}
+
+/*
+ * ends the sporadic server activation of the task and queues the replenishment of what it used
+ */
+static void budget_ss_end(uint32_t task)
+{
+	TCD_t *p_task = &user_tasks[task];
+	uint32_t r = p_task->ss_repl_count;
+
+	if(!p_task->ss_active)
+	{
+		return;
+	}
+	p_task->ss_active = 0;
+	if(p_task->ss_consumed == 0)
+	{
+		return;
+	}
+
+	p_task->ss_repl_count++;
+	p_task->ss_repl_tick[r] = p_task->ss_start + p_task->budget_period;
+	p_task->ss_repl_amount[r] = p_task->ss_consumed;
+}
+
+/*
+ * 0 when the task used up its budget, a sporadic server that is not active also waits while its replenishment
+ * queue is full (it could not queue what a new activation uses)
+ */
+static int budget_may_run(uint32_t task)
+{
+	const TCD_t *p_task = &user_tasks[task];
+
+	if(p_task->budget_exhausted)
+	{
+		return 0;
+	}
+	return (p_task->budget_mode != BUDGET_MODE_SPORADIC) || p_task->ss_active ||
+			(p_task->ss_repl_count < BUDGET_SS_MAX_REPL);
+}
+
+/*
+ * next ready demoted task after the last one that ran, 0 (idle) when there is none
+ */
+static uint32_t budget_demoted_task(void)
+{
+	for(int i = 0; i < MAX_TASKS; i++)
+	{
+		budget_demoted = (budget_demoted + 1) % MAX_TASKS;
+		if( (budget_demoted != 0) && (user_tasks[budget_demoted].current_state == TASK_READY_STATE) &&
+				(user_tasks[budget_demoted].budget_mode == BUDGET_MODE_DEMOTE) )
+		{
+			return budget_demoted;
+		}
+	}
+	return 0;
+}
+
+/*
+ * called from the tick or the context switch when a task used up its budget, can be overridden by the application
+ * (keep it short), exhaust_count in the TCD counts the overruns
+ */
+__attribute__((weak)) void kernel_budget_exhausted_hook(uint32_t task)
+{
+	(void)task;
+}
+#endif
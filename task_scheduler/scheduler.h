@@ -9,29 +9,147 @@
 #define SCHEDULER_H_
 
 #include <stdio.h>
+#include <stdint.h>
 
 typedef struct
 {
-	uint32_t psp_val;
+	uintptr_t psp_val;
 	uint32_t block_count;
 	uint8_t current_state;
 	void (*task_handler)(void);
+	uintptr_t stack_limit; // lowest address of the task private stack
+#if KERNEL_CONFIG_STACK_CHECK
+	uint32_t stack_peak; // highest stack usage seen so far in bytes
+#endif
+#if KERNEL_CONFIG_STATS
+	uint64_t run_cycles; // cycles the task ran, ISR time excluded
+	uint32_t switch_count; // number of times the task was switched in
+#endif
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_EDF
+	uint32_t rel_deadline; // ticks from release to deadline, 0 -> no deadline (runs after all deadline tasks)
+	uint32_t abs_deadline; // tick count the running job has to finish by
+	uint32_t miss_count; // deadlines missed so far
+	uint32_t edf_next; // next task in the ready list, MAX_TASKS ends the list
+#endif
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_TT
+	uint32_t overrun_count; // slots the task was still running at the end of the minor frame
+	uint8_t tt_slot_task; // 1 -> in a frame of the table, only the table makes it ready (unblock_tasks skips it)
+#endif
+#if KERNEL_CONFIG_BUDGET
+	uint32_t budget_cycles; // cycles per budget_period, 0 -> no budget
+	uint32_t budget_period; // ticks
+	int32_t budget_left; // cycles left in the current period, can go below 0 by up to one tick
+	uint32_t replenish_tick; // tick count of the next periodic replenishment
+	uint32_t exhaust_count; // times the budget ran out
+	uint8_t budget_mode; // @BUDGET_MODE
+	uint8_t budget_exhausted;
+	uint8_t ss_active; // sporadic server is consuming since ss_start
+	uint8_t ss_repl_count;
+	uint32_t ss_start; // tick count the current activation started
+	uint32_t ss_consumed; // cycles used in the current activation
+	uint32_t ss_repl_tick[BUDGET_SS_MAX_REPL]; // pending replenishments, oldest first
+	uint32_t ss_repl_amount[BUDGET_SS_MAX_REPL];
+#endif
 }TCD_t;
 
+/* one entry per task for init_task_stack, index 0 is the idle task */
+typedef struct
+{
+	void (*task_handler)(void);
+	uintptr_t stack_top; // highest address of the task private stack (TASK_STACK_SIZE bytes below it)
+	uint32_t deadline; // relative deadline in ticks for SCHED_POLICY_EDF, 0 -> no deadline, unused otherwise
+	uint32_t budget_cycles; // KERNEL_CONFIG_BUDGET, CPU cycles per budget_period, 0 -> no budget
+	uint32_t budget_period; // ticks
+	uint8_t budget_mode; // possible values from @BUDGET_MODE
+}task_config_t;
+
+#if KERNEL_CONFIG_STATS
+/* statistics over the interval since the previous kernel_get_stats call (or since the scheduler started) */
+typedef struct
+{
+	uint32_t load_permille[MAX_TASKS]; // share of the interval each task ran, in 0.1%
+	uint32_t switch_count[MAX_TASKS]; // context switches into each task
+	uint32_t isr_permille; // share of the interval spent in SysTick and kernel_isr_enter/exit wrapped handlers
+	uint32_t idle_permille; // same as load_permille[0], the idle task
+	uint64_t total_cycles; // length of the interval
+}kernel_stats_t;
+#endif
+
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_TT
+/*
+ * time-triggered schedule, kept in flash:
+ * every minor frame (frame_ticks long) starts at a tick with its first slot, a slot ends when its task calls
+ * task_delay (the argument is ignored for slot tasks) and the next slot of the frame starts right away,
+ * after the last slot the background tasks share the slack round-robin until the next frame
+ */
+typedef struct
+{
+	const uint32_t *p_slots; // tasks in the order they run
+	uint32_t slot_count;
+}tt_frame_t;
+
+typedef struct
+{
+	const tt_frame_t *p_frames; // the minor frames of one major frame
+	uint32_t frame_count;
+	uint32_t frame_ticks; // length of a minor frame in ticks
+	const uint32_t *p_background; // best-effort tasks for the slack, not in any slot (can be NULL)
+	uint32_t background_count;
+}tt_schedule_t;
+#endif
+
 extern TCD_t user_tasks[MAX_TASKS];
 extern uint32_t current_task;
+extern uint32_t g_tick_count;
 
-void init_systick_timer(uint32_t tick_hz);
-__attribute__ ((naked)) void init_scheduler_stack(uint32_t schedu_top_of_stack);
-void init_task_stack(void);
+void init_task_stack(const task_config_t *p_task_config);
 
-void save_psp_value(uint32_t current_psp_val);
-uint32_t get_psp_value(void);
-void switch_sp_to_psp(void);
+void save_psp_value(uintptr_t current_psp_val);
+uintptr_t get_psp_value(void);
 void update_next_task(void);
 void update_global_tick_count(void);
+void kernel_tick(void);
 
+#ifndef KERNEL_PORT_POSIX
+/*
+ * Cortex-M4 port (port_cm4.c)
+ */
+void init_systick_timer(uint32_t tick_hz);
+void systick_clk_change_handler(uint8_t phase, void *p_context);
+__attribute__ ((naked)) void init_scheduler_stack(uint32_t schedu_top_of_stack);
+void switch_sp_to_psp(void);
 void enable_processor_faults(void);
+#endif
+
+#if KERNEL_CONFIG_MPU_GUARD
+void kernel_mpu_init(void);
+#endif
+
+#if KERNEL_CONFIG_STACK_CHECK
+uint32_t kernel_get_stack_usage(uint32_t task);
+void kernel_stack_scan(void);
+void kernel_stack_overflow_hook(uint32_t task);
+#endif
+
+#if KERNEL_CONFIG_STATS
+void kernel_stats_init(void);
+void kernel_get_stats(kernel_stats_t *p_stats);
+void kernel_isr_enter(void);
+void kernel_isr_exit(void);
+#endif
+
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_EDF
+void kernel_deadline_miss_hook(uint32_t task);
+#endif
+
+#if KERNEL_CONFIG_BUDGET
+void kernel_budget_exhausted_hook(uint32_t task);
+#endif
+
+#if KERNEL_CONFIG_SCHED_POLICY == SCHED_POLICY_TT
+void kernel_tt_init(const tt_schedule_t *p_schedule);
+void kernel_tt_overrun_hook(uint32_t frame, uint32_t slot, uint32_t task);
+#endif
 
 void task_delay(uint32_t tick_count);
 void schedule(void);
@@ -35,22 +35,35 @@
 
 /* ITM register addresses */
 #define ITM_STIMULUS_PORT0   	*((volatile uint32_t*) 0xE0000000 )
+#define ITM_STIMULUS_PORT0_8 	*((volatile uint8_t*) 0xE0000000 )
 #define ITM_TRACE_EN          	*((volatile uint32_t*) 0xE0000E00 )
 
-void ITM_SendChar(uint8_t ch)
-{
+static uint8_t itm_enabled = 0;
 
+static void ITM_enable(void)
+{
 	//Enable TRCENA
 	DEMCR |= ( 1 << 24);
 
 	//enable stimulus port 0
 	ITM_TRACE_EN |= ( 1 << 0);
 
+	itm_enabled = 1;
+}
+
+void ITM_SendChar(uint8_t ch)
+{
+	//only enable once, not for every character
+	if(!itm_enabled)
+	{
+		ITM_enable();
+	}
+
 	// read FIFO status in bit [0]:
 	while(!(ITM_STIMULUS_PORT0 & 1));
 
 	//Write to ITM stimulus port0
-	ITM_STIMULUS_PORT0 = ch;
+	ITM_STIMULUS_PORT0_8 = ch;
 }
 
 /* Variables */
@@ -104,7 +117,19 @@ __attribute__((weak)) int _write(int file, char *ptr, int len)
   (void)file;
   int DataIdx;
 
-  for (DataIdx = 0; DataIdx < len; DataIdx++)
+  if(!itm_enabled)
+  {
+	  ITM_enable();
+  }
+
+  //4 characters per stimulus port write, the SWO viewer unpacks them in order
+  for (DataIdx = 0; (DataIdx + 4) <= len; DataIdx += 4)
+  {
+	  while(!(ITM_STIMULUS_PORT0 & 1));
+	  ITM_STIMULUS_PORT0 = (uint8_t)ptr[0] | ((uint8_t)ptr[1] << 8) | ((uint8_t)ptr[2] << 16) | ((uint32_t)(uint8_t)ptr[3] << 24);
+	  ptr += 4;
+  }
+  for (; DataIdx < len; DataIdx++)
   {
 	  ITM_SendChar(*ptr++);
 //    __io_putchar(*ptr++);
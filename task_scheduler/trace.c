@@ -0,0 +1,34 @@
+/*
+ * trace.c
+ *
+ *  Created on: Jan 12, 2026
+ *      Author: krisko
+ */
+
+#include <stdint.h>
+#include "rcc.h"
+#include "main.h"
+#include "trace.h"
+
+#if KERNEL_CONFIG_TRACE
+//not cleared by Reset_Handler, the trace of a run that ended in a reset is still there until trace_init is called
+trace_buffer_t g_trace NOINIT;
+#endif
+
+void trace_init(void)
+{
+#if KERNEL_CONFIG_TRACE
+#if TRACE_CONFIG_ITM
+	uint32_t *p_DEMCR = (uint32_t*)DEMCR_ADDR;
+	uint32_t *p_ITM_TER = (uint32_t*)0xE0000E00;
+
+	*p_DEMCR |= (1 << 24); // TRCENA
+	*p_ITM_TER |= (1 << TRACE_ITM_PORT);
+#endif
+	g_trace.head = 0;
+	g_trace.len = TRACE_BUF_LEN;
+	//the core clock the timestamps count, fixed under KERNEL_TARGET_QEMU where there is no RCC to read
+	g_trace.cpu_hz = SYSTIC_TIMER_CLOCK;
+	g_trace.magic = TRACE_MAGIC;
+#endif
+}
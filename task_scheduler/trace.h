@@ -0,0 +1,115 @@
+/*
+ * trace.h
+ *
+ *  Created on: Jan 12, 2026
+ *      Author: krisko
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+#include "main.h"
+#include "port.h"
+
+/*
+ * binary event trace, 8 byte records in a .noinit ring buffer:
+ * word 0 -> CYCCNT timestamp
+ * word 1 -> event [7:0], task [15:8], object [31:16]
+ * decoded on the host by tools/trace_decode.py
+ */
+
+#define TRACE_MAGIC 0x31435254U // "TRC1", lets the decoder find and check the buffer
+#define TRACE_BUF_LEN 512U // records, must be a power of 2 (4 KB)
+
+//set to 1 to also stream every record to ITM stimulus port TRACE_ITM_PORT as two 32 bit writes
+#ifndef TRACE_CONFIG_ITM
+#define TRACE_CONFIG_ITM 0
+#endif
+#define TRACE_ITM_PORT 1U
+
+/* event types */
+#define TRACE_EV_SWITCH_IN 0x01 // task starts running
+#define TRACE_EV_BLOCK 0x02 // task blocks, object = delay in ticks (low 16 bits)
+#define TRACE_EV_UNBLOCK 0x03 // task becomes ready
+#define TRACE_EV_ISR_ENTER 0x04 // object = exception number (IPSR)
+#define TRACE_EV_ISR_EXIT 0x05 // object = exception number (IPSR)
+#define TRACE_EV_SEM_TAKE 0x06 // object = semaphore id
+#define TRACE_EV_SEM_GIVE 0x07
+#define TRACE_EV_QUEUE_SEND 0x08 // object = queue id
+#define TRACE_EV_QUEUE_RECV 0x09
+#define TRACE_EV_DEADLINE_MISS 0x0A // SCHED_POLICY_EDF, object = missed deadline tick (low 16 bits)
+#define TRACE_EV_OVERRUN 0x0B // SCHED_POLICY_TT, object = frame << 8 | slot
+#define TRACE_EV_BUDGET 0x0C // KERNEL_CONFIG_BUDGET, the task used up its budget
+#define TRACE_EV_USER 0x80 // 0x80 to 0xFF free for the application
+
+typedef struct
+{
+	uint32_t timestamp;
+	uint32_t info;
+}trace_record_t;
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t head; // total records written, the next record goes to head % TRACE_BUF_LEN
+	uint32_t len;
+	uint32_t cpu_hz; // CYCCNT frequency when the trace was started
+	trace_record_t rec[TRACE_BUF_LEN];
+}trace_buffer_t;
+
+extern trace_buffer_t g_trace;
+
+void trace_init(void);
+
+#if KERNEL_CONFIG_TRACE
+
+/*
+ * records one event, interrupts are masked only around the slot reservation and the two stores
+ */
+static inline __attribute__((always_inline)) void trace_record(uint8_t event, uint8_t task, uint16_t object)
+{
+	uint32_t primask, info, idx;
+	trace_record_t *p_rec;
+
+	info = (uint32_t)event | ((uint32_t)task << 8) | ((uint32_t)object << 16);
+
+	primask = port_irq_save();
+
+	idx = g_trace.head;
+	g_trace.head = idx + 1;
+	p_rec = &g_trace.rec[idx & (TRACE_BUF_LEN - 1)];
+	p_rec->timestamp = PORT_CYCLES();
+	p_rec->info = info;
+
+#if TRACE_CONFIG_ITM
+	volatile uint32_t *p_port = (volatile uint32_t*)(0xE0000000U + (4 * TRACE_ITM_PORT));
+	while(!(*p_port & 1));
+	*p_port = p_rec->timestamp;
+	while(!(*p_port & 1));
+	*p_port = info;
+#endif
+
+	port_irq_restore(primask);
+}
+
+static inline __attribute__((always_inline)) uint16_t trace_ipsr(void)
+{
+	uint32_t ipsr;
+	__asm volatile("MRS %0, IPSR" : "=r"(ipsr));
+	return (uint16_t)(ipsr & 0x1FF);
+}
+
+#define TRACE_EVENT(event, task, object) trace_record((event), (uint8_t)(task), (uint16_t)(object))
+#define TRACE_ISR_ENTER() trace_record(TRACE_EV_ISR_ENTER, 0, trace_ipsr())
+#define TRACE_ISR_EXIT() trace_record(TRACE_EV_ISR_EXIT, 0, trace_ipsr())
+
+#else
+
+#define TRACE_EVENT(event, task, object) do{} while(0)
+#define TRACE_ISR_ENTER() do{} while(0)
+#define TRACE_ISR_EXIT() do{} while(0)
+
+#endif
+
+#endif /* TRACE_H_ */
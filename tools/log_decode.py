@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""
+Format the raw log records of a LOG_CONFIG_HOST_FORMAT = 1 build (task_scheduler/log.h)
+
+The target only sends the address of the format string, a CYCCNT timestamp and
+the 32 bit arguments on ITM port LOG_RAW_PORT, the format strings are read
+from the ELF file that was flashed.
+
+usage: log_decode.py final.elf swo.bin [--port 2] [--hz 180000000]
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+from trace_decode import itm_words
+
+LOG_HDR_VALID = 0x4C000000
+LOG_HDR_MASK = 0xFF000000
+LOG_HDR_WORDS = 3
+
+CONVERSION = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(hh|h|ll|l|z|t)?([diouxXcps%])")
+
+
+class Elf32:
+    """just enough of ELF32 little endian to read strings by address"""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[4] != 1:
+            sys.exit("%s is not an ELF32 file" % path)
+        shoff, = struct.unpack_from("<I", self.data, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", self.data, 0x2E)
+        self.sections = []
+        for n in range(shnum):
+            _, sh_type, _, addr, offset, size = struct.unpack_from("<IIIIII", self.data, shoff + n * shentsize)
+            if sh_type == 1 and addr:  # PROGBITS loaded to an address
+                self.sections.append((addr, offset, size))
+
+    def string(self, addr):
+        for base, offset, size in self.sections:
+            if base <= addr < base + size:
+                start = offset + (addr - base)
+                end = self.data.index(b"\0", start)
+                return self.data[start:end].decode("utf-8", "replace")
+        return None
+
+
+def c_format(fmt, args):
+    """applies a printf format string to 32 bit integer arguments"""
+    args = list(args)
+
+    def convert(m):
+        flags, _, conv = m.groups()
+        if conv == "%":
+            return "%"
+        val = args.pop(0) if args else 0
+        if conv in "di":
+            val = val - (1 << 32) if val & 0x80000000 else val
+            conv = "d"
+        elif conv == "c":
+            return chr(val & 0xFF)
+        elif conv == "p":
+            return "0x%08x" % val
+        elif conv == "s":
+            return "<str@0x%08x>" % val
+        elif conv == "u":
+            conv = "d"
+        return ("%" + flags + conv) % val
+
+    return CONVERSION.sub(convert, fmt)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf", help="firmware ELF with the format strings")
+    parser.add_argument("capture", help="ITM/SWO capture")
+    parser.add_argument("--port", type=int, default=2, help="ITM stimulus port (LOG_RAW_PORT)")
+    parser.add_argument("--hz", type=int, default=180000000, help="CYCCNT frequency for the timestamps")
+    args = parser.parse_args()
+
+    elf = Elf32(args.elf)
+    with open(args.capture, "rb") as f:
+        words = itm_words(f.read(), args.port)
+
+    i = 0
+    while i + LOG_HDR_WORDS <= len(words):
+        hdr = words[i]
+        if (hdr & LOG_HDR_MASK) != LOG_HDR_VALID:
+            i += 1  # resynchronize after lost packets
+            continue
+        nargs = hdr & 0xFF
+        fmt_addr, timestamp = words[i + 1], words[i + 2]
+        rec_args = words[i + LOG_HDR_WORDS:i + LOG_HDR_WORDS + nargs]
+        i += LOG_HDR_WORDS + nargs
+
+        stamp = "[%12.3f us] " % (timestamp * 1e6 / args.hz)
+        if fmt_addr == 0:
+            print(stamp + "log: %d dropped" % (rec_args[0] if rec_args else 0))
+            continue
+        fmt = elf.string(fmt_addr)
+        if fmt is None:
+            print(stamp + "<unknown format 0x%08x> %s" % (fmt_addr, rec_args))
+            continue
+        sys.stdout.write(stamp + c_format(fmt, rec_args))
+        if not fmt.endswith("\n"):
+            sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""
+Boot the kernel regression firmware (task_scheduler/qemu) headless on QEMU,
+check its TEST lines and compare its RESULT lines against a stored baseline.
+
+The firmware prints on semihosting
+    TEST <name> PASS|FAIL
+    RESULT <name> <value> lower|higher
+and exits through semihosting. QEMU runs with -icount so the SysTick based
+measurements repeat from run to run.
+
+usage: qemu_run.py final_qemu.elf [--baseline tools/qemu_baseline.json]
+                   [--update-baseline] [--tolerance 5]
+
+exit code: 0 all tests passed and no result regressed, 1 otherwise
+(a missing baseline, or a result the baseline has no value for, is a failure)
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+
+DEFAULT_BASELINE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "qemu_baseline.json")
+
+
+def run_qemu(args):
+    """returns (output lines, QEMU exit code)"""
+    cmd = [args.qemu, "-M", args.machine, "-nographic", "-monitor", "none", "-serial", "null",
+           "-semihosting-config", "enable=on,target=native",
+           "-icount", "shift=%d,sleep=off" % args.icount,
+           "-kernel", args.elf]
+    try:
+        proc = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, timeout=args.timeout)
+    except FileNotFoundError:
+        sys.exit("%s not found, install QEMU (qemu-system-arm) or pass --qemu" % args.qemu)
+    except subprocess.TimeoutExpired as e:
+        output = (e.stdout or b"").decode(errors="replace")
+        sys.stdout.write(output)
+        sys.exit("timeout after %d s, the firmware did not exit" % args.timeout)
+    return proc.stdout.decode(errors="replace").splitlines(), proc.returncode
+
+
+def parse(lines):
+    """returns (tests {name: passed}, results {name: (value, better)}, done)"""
+    tests, results, done = {}, {}, False
+    for line in lines:
+        fields = line.split()
+        if len(fields) == 3 and fields[0] == "TEST":
+            tests[fields[1]] = fields[2] == "PASS"
+        elif len(fields) == 4 and fields[0] == "RESULT":
+            results[fields[1]] = (int(fields[2]), fields[3])
+        elif fields and fields[0] == "DONE":
+            done = True
+    return tests, results, done
+
+
+def compare(results, baseline, tolerance):
+    """prints one line per result, returns the names that got worse by more than tolerance percent"""
+    regressed = []
+    print("%-28s %12s %12s %8s" % ("result", "baseline", "now", "change"))
+    for name, (value, better) in sorted(results.items()):
+        if name not in baseline:
+            print("%-28s %12s %12d %8s" % (name, "-", value, "new"))
+            continue
+        base = baseline[name]["value"]
+        if base is None:
+            # listed but never recorded, the baseline has to be filled in with --update-baseline
+            print("%-28s %12s %12d %8s" % (name, "unset", value, "  NO BASELINE"))
+            regressed.append(name)
+            continue
+        change = 0.0 if base == 0 else 100.0 * (value - base) / base
+        worse = change > tolerance if better == "lower" else change < -tolerance
+        if base == 0 and value != 0 and better == "lower":
+            worse = True
+        print("%-28s %12d %12d %+7.1f%%%s" % (name, base, value, change, "  REGRESSION" if worse else ""))
+        if worse:
+            regressed.append(name)
+    for name in sorted(set(baseline) - set(results)):
+        base = baseline[name]["value"]
+        print("%-28s %12s %12s %8s" % (name, "unset" if base is None else base, "-", "missing"))
+    return regressed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf", help="firmware built by make -C task_scheduler/qemu")
+    parser.add_argument("--qemu", default="qemu-system-arm")
+    parser.add_argument("--machine", default="netduinoplus2")
+    parser.add_argument("--icount", type=int, default=3, help="-icount shift, 2^shift ns per instruction")
+    parser.add_argument("--timeout", type=int, default=120, help="seconds before the run is killed")
+    parser.add_argument("--baseline", default=DEFAULT_BASELINE)
+    parser.add_argument("--update-baseline", action="store_true", help="store this run's results as the baseline")
+    parser.add_argument("--tolerance", type=float, default=5.0, help="allowed change in percent")
+    parser.add_argument("-v", "--verbose", action="store_true", help="print the firmware output")
+    args = parser.parse_args()
+
+    lines, code = run_qemu(args)
+    if args.verbose:
+        print("\n".join(lines))
+    tests, results, done = parse(lines)
+
+    failed = [name for name, passed in sorted(tests.items()) if not passed]
+    for name, passed in sorted(tests.items()):
+        print("%-28s %s" % (name, "PASS" if passed else "FAIL"))
+    if not done:
+        print("\n".join(lines[-20:]))
+        sys.exit("firmware stopped before DONE (QEMU exit code %d)" % code)
+
+    ok = not failed and code == 0
+
+    if args.update_baseline:
+        if not ok:
+            sys.exit("not updating the baseline from a failing run")
+        with open(args.baseline, "w") as f:
+            json.dump({"machine": args.machine, "icount": args.icount,
+                       "results": {name: {"value": value, "better": better}
+                                   for name, (value, better) in sorted(results.items())}}, f, indent=2)
+            f.write("\n")
+        print("baseline written to %s" % args.baseline)
+        return 0
+
+    if not os.path.exists(args.baseline):
+        for name, (value, better) in sorted(results.items()):
+            print("%-28s %12d (%s is better)" % (name, value, better))
+        sys.exit("no baseline at %s, run with --update-baseline to create it" % args.baseline)
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+    if baseline.get("machine") != args.machine or baseline.get("icount") != args.icount:
+        print("warning: baseline is from %s icount %s" % (baseline.get("machine"), baseline.get("icount")))
+    regressed = compare(results, baseline["results"], args.tolerance)
+    ok = ok and not regressed
+
+    print("PASSED" if ok else "FAILED")
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
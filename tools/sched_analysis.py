@@ -0,0 +1,352 @@
+#!/usr/bin/env python3
+"""
+Schedulability check of a task set for the kernel: response-time analysis
+and a discrete-event simulation of the tick, the time slice and PendSV.
+
+The task set is JSON, per task the fields of TCD_t that matter for timing
+plus the timing parameters:
+
+{
+  "cpu_hz": 180000000,             HCLK, CYCCNT frequency
+  "tick_hz": 1000,                 TICK_HZ
+  "policy": "rr",                  "rr" (SCHED_POLICY_RR), "edf" (SCHED_POLICY_EDF) or "fp"
+  "timeslice_ticks": 1,            ticks a task runs before round-robin moves on
+  "source": "...",                 where the cycle figures come from, printed with the report
+  "overheads": {                   cycles, measured on the target:
+    "tick_cycles": 0,              SysTick_Handler, the ISR track of the event trace
+    "pendsv_cycles": 0             PendSV_Handler, save + update_next_task + restore
+  },
+  "tasks": [
+    {
+      "name": "task1",
+      "period": 1000,              ticks, the task_delay() argument
+      "wcet": 20000,               cycles per job, run_cycles / switch count of kernel_get_stats
+      "priority": 1,               "fp" only, higher runs first
+      "deadline": 1000,            ticks after the release, default period
+      "offset": 0,                 ticks before the first release, default 0
+      "critical": 0,               cycles at the start of a job with interrupts masked, default 0
+      "blocking": 0                extra cycles a job can be blocked (resources), analysis only
+    }
+  ]
+}
+
+"release" (top level) selects how jobs are released:
+  "delay"    the task calls task_delay(period) at the end of each job, so the
+             next release is period ticks after the tick the job finished in
+  "periodic" releases every period ticks from offset (a delay-until)
+
+Response-time analysis (fp: classic RTA with blocking; rr: bound where each
+other task can run one time slice before every slice of the task; edf:
+density test, the bound is the deadline itself) adds the tick and PendSV
+overheads. The simulation runs for --ticks (default the
+hyperperiod, at most 100000 ticks) and reports the worst response time seen.
+
+usage: sched_analysis.py taskset.json [--policy rr|edf|fp] [--ticks N] [--json]
+
+exit code: 0 all deadlines hold in the analysis and the simulation, 1 otherwise
+"""
+
+import argparse
+import json
+import math
+import sys
+
+MAX_TICKS = 100000
+
+
+class Task:
+    def __init__(self, index, d):
+        self.index = index
+        self.name = d.get("name", "task%d" % index)
+        self.period = int(d["period"])
+        self.wcet = int(d["wcet"])
+        self.priority = int(d.get("priority", 0))
+        self.deadline = int(d.get("deadline", self.period))
+        self.offset = int(d.get("offset", 0))
+        self.critical = int(d.get("critical", 0))
+        self.blocking = int(d.get("blocking", 0))
+        if self.period <= 0 or self.wcet <= 0:
+            sys.exit("%s: period and wcet must be > 0" % self.name)
+        if self.critical > self.wcet:
+            sys.exit("%s: critical is longer than wcet" % self.name)
+
+
+class TaskSet:
+    def __init__(self, d, policy=None):
+        self.cpu_hz = int(d.get("cpu_hz", 180000000))
+        self.tick_hz = int(d.get("tick_hz", 1000))
+        self.policy = policy or d.get("policy", "rr")
+        self.release = d.get("release", "delay")
+        self.timeslice = int(d.get("timeslice_ticks", 1))
+        self.source = d.get("source", "")
+        ovh = d.get("overheads", {})
+        self.tick_cycles = int(ovh.get("tick_cycles", 0))
+        self.pendsv_cycles = int(ovh.get("pendsv_cycles", 0))
+        self.tasks = [Task(i + 1, t) for i, t in enumerate(d["tasks"])]
+        self.cycles_per_tick = self.cpu_hz // self.tick_hz
+        if self.policy not in ("rr", "edf", "fp"):
+            sys.exit("policy must be rr, edf or fp")
+        if self.release not in ("delay", "periodic"):
+            sys.exit("release must be delay or periodic")
+
+    def us(self, cycles):
+        return cycles * 1e6 / self.cpu_hz
+
+
+def utilization(ts):
+    per_tick = (ts.tick_cycles + ts.pendsv_cycles) / ts.cycles_per_tick
+    tasks = sum((t.wcet + ts.pendsv_cycles) / (t.period * ts.cycles_per_tick) for t in ts.tasks)
+    return tasks, per_tick
+
+
+def response_time_analysis(ts):
+    """returns {task name: worst-case response time in cycles, or None if it does not converge below the deadline}"""
+    tick = ts.cycles_per_tick
+    tick_cost = ts.tick_cycles + ts.pendsv_cycles  # the tick pends PendSV every time
+    slice_cycles = ts.timeslice * tick
+    results = {}
+
+    if ts.policy == "edf":
+        # sum of C / min(D, T) <= 1 is sufficient for EDF, blocking as in the stack resource policy
+        density = tick_cost / tick
+        for task in ts.tasks:
+            lower = [t for t in ts.tasks if t.deadline > task.deadline]
+            b = max([t.critical for t in lower] + [0]) + task.blocking
+            density += (task.wcet + ts.pendsv_cycles + b) / (min(task.deadline, task.period) * tick)
+        for task in ts.tasks:
+            results[task.name] = task.deadline * tick if density <= 1.0 else None
+        return results
+
+    for task in ts.tasks:
+        c = task.wcet + ts.pendsv_cycles  # the switch away when the job blocks
+        deadline = task.deadline * tick
+        if ts.policy == "fp":
+            others = [t for t in ts.tasks if t.priority > task.priority]
+            lower = [t for t in ts.tasks if t.priority <= task.priority and t is not task]
+        else:
+            others = [t for t in ts.tasks if t is not task]
+            lower = others
+        b = max([t.critical for t in lower] + [0]) + task.blocking
+        slice_eff = slice_cycles - tick_cost * ts.timeslice
+        if ts.policy == "rr" and slice_eff <= 0:
+            results[task.name] = None
+            continue
+
+        r = c + b
+        while True:
+            interference = 0
+            for other in others:
+                demand = math.ceil(r / (other.period * tick)) * (other.wcet + ts.pendsv_cycles)
+                if ts.policy == "rr":
+                    # one slice of every other task before each slice of this one, the +1 covers a slice cut short
+                    slices = math.ceil(c / slice_eff) + 1
+                    demand = min(demand, slices * slice_cycles)
+                interference += demand
+            r_next = c + b + interference + math.ceil(r / tick) * tick_cost
+            if r_next == r:
+                break
+            r = r_next
+            if r > deadline and r > 100 * tick * max(t.period for t in ts.tasks):
+                break
+        results[task.name] = r
+    return results
+
+
+def simulate(ts, ticks):
+    """
+    cycle level simulation of the kernel, returns per task {jobs, misses, max_rt, sum_rt} and the overhead cycles
+    tasks are indexed from 1, 0 is the idle task like user_tasks[]
+    """
+    n = len(ts.tasks)
+    tasks = [None] + ts.tasks
+    tick = ts.cycles_per_tick
+
+    ready = [False] * (n + 1)
+    remaining = [0] * (n + 1)
+    crit_left = [0] * (n + 1)
+    release_time = [0] * (n + 1)
+    next_release = [0] * (n + 1)  # tick count at which the task becomes ready
+    stats = {t.name: {"jobs": 0, "misses": 0, "max_rt": 0, "sum_rt": 0} for t in ts.tasks}
+    for t in ts.tasks:
+        next_release[t.index] = t.offset
+
+    now = 0
+    tick_count = 0
+    current = 0
+    slice_left = ts.timeslice
+    overhead = 0
+    idle = 0
+
+    def release(tc, at):
+        for t in ts.tasks:
+            i = t.index
+            if not ready[i] and next_release[i] == tc:
+                ready[i] = True
+                remaining[i] = t.wcet
+                crit_left[i] = t.critical
+                release_time[i] = at
+
+    def pick():
+        if ts.policy == "fp":
+            best = 0
+            # highest priority, round-robin among equals starting after the current task
+            for k in range(1, n + 1):
+                i = (current + k - 1) % n + 1
+                if ready[i] and (best == 0 or tasks[i].priority > tasks[best].priority):
+                    best = i
+            return best
+        if ts.policy == "edf":
+            # earliest absolute deadline, equal deadlines in ready list (release) order is approximated by index
+            best = 0
+            for k in range(1, n + 1):
+                i = (current + k - 1) % n + 1
+                if ready[i] and (best == 0 or release_time[i] + tasks[i].deadline * tick <
+                                 release_time[best] + tasks[best].deadline * tick):
+                    best = i
+            return best
+        # update_next_task: next ready task after the current one, idle when none
+        for k in range(1, n + 1):
+            i = (current + k - 1) % n + 1
+            if ready[i]:
+                return i
+        return 0
+
+    release(0, 0)
+    current = pick()
+    next_tick = tick
+
+    while tick_count < ticks:
+        if current and ready[current]:
+            if crit_left[current]:
+                # interrupts masked, the tick waits until the critical section ends
+                run = crit_left[current]
+                crit_left[current] = 0
+            else:
+                run = min(remaining[current], next_tick - now) if next_tick > now else 0
+            now += run
+            remaining[current] -= run
+            if remaining[current] == 0:
+                t = tasks[current]
+                rt = now - release_time[current]
+                s = stats[t.name]
+                s["jobs"] += 1
+                s["sum_rt"] += rt
+                s["max_rt"] = max(s["max_rt"], rt)
+                if rt > t.deadline * tick:
+                    s["misses"] += 1
+                ready[current] = False
+                if ts.release == "delay":
+                    next_release[current] = tick_count + t.period
+                else:
+                    next_release[current] += t.period
+                    if next_release[current] <= tick_count:
+                        # overran into its next period, that release is late even if this job met its deadline
+                        if rt <= t.deadline * tick:
+                            s["misses"] += 1
+                        next_release[current] = tick_count + 1
+                # task_delay pends PendSV
+                now += ts.pendsv_cycles
+                overhead += ts.pendsv_cycles
+                current = pick()
+                slice_left = ts.timeslice
+                continue
+        else:
+            # idle until the next tick
+            if next_tick > now:
+                idle += next_tick - now
+                now = next_tick
+
+        if now >= next_tick:
+            # SysTick: tick count, unblock, pend PendSV, then the switch
+            tick_start = next_tick
+            next_tick += tick
+            now += ts.tick_cycles + ts.pendsv_cycles
+            overhead += ts.tick_cycles + ts.pendsv_cycles
+            tick_count += 1
+            release(tick_count, tick_start)
+            slice_left -= 1
+            if ts.policy == "rr":
+                if slice_left <= 0 or not (current and ready[current]):
+                    current = pick()
+                    slice_left = ts.timeslice
+            else:
+                current = pick()
+
+    for t in ts.tasks:
+        # a job still running at the end counts if it is already late
+        i = t.index
+        if ready[i] and now - release_time[i] > t.deadline * tick:
+            stats[t.name]["misses"] += 1
+            stats[t.name]["max_rt"] = max(stats[t.name]["max_rt"], now - release_time[i])
+    return stats, overhead, idle, now
+
+
+def hyperperiod(ts):
+    h = 1
+    for t in ts.tasks:
+        h = h * t.period // math.gcd(h, t.period)
+        if h > MAX_TICKS:
+            return MAX_TICKS
+    return max(h + max(t.offset for t in ts.tasks), 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("taskset", help="task set JSON")
+    parser.add_argument("--policy", choices=("rr", "edf", "fp"), help="override the policy of the task set")
+    parser.add_argument("--ticks", type=int, default=0, help="simulated ticks, default the hyperperiod")
+    parser.add_argument("--json", action="store_true", help="print the results as JSON")
+    args = parser.parse_args()
+
+    with open(args.taskset) as f:
+        ts = TaskSet(json.load(f), args.policy)
+
+    ticks = args.ticks or hyperperiod(ts)
+    rta = response_time_analysis(ts)
+    sim, overhead, idle, total = simulate(ts, ticks)
+    u_tasks, u_kernel = utilization(ts)
+
+    ok = True
+    report = {"policy": ts.policy, "release": ts.release, "ticks": ticks, "source": ts.source,
+              "utilization_tasks": u_tasks, "utilization_kernel": u_kernel, "tasks": {}}
+    for t in ts.tasks:
+        r = rta[t.name]
+        s = sim[t.name]
+        rta_ok = r is not None and r <= t.deadline * ts.cycles_per_tick
+        ok = ok and rta_ok and s["misses"] == 0
+        report["tasks"][t.name] = {
+            "deadline_cycles": t.deadline * ts.cycles_per_tick,
+            "rta_cycles": r,
+            "rta_ok": rta_ok,
+            "sim_jobs": s["jobs"],
+            "sim_max_cycles": s["max_rt"],
+            "sim_avg_cycles": s["sum_rt"] // s["jobs"] if s["jobs"] else 0,
+            "sim_misses": s["misses"],
+        }
+    report["schedulable"] = ok
+
+    if args.json:
+        print(json.dumps(report, indent=2))
+        return 0 if ok else 1
+
+    print("policy %s, release %s, %d ticks simulated" % (ts.policy, ts.release, ticks))
+    if ts.source:
+        print("figures: %s" % ts.source)
+    print("utilization: tasks %.1f%%, tick + PendSV %.1f%%, simulated overhead %.1f%%, idle %.1f%%" % (
+        100 * u_tasks, 100 * u_kernel, 100.0 * overhead / total, 100.0 * idle / total))
+    print("%-12s %10s %12s %12s %12s %6s %7s" % ("task", "deadline", "RTA", "sim max", "sim avg", "jobs",
+                                                 "misses"))
+    for t in ts.tasks:
+        e = report["tasks"][t.name]
+        rta_us = "diverges" if e["rta_cycles"] is None else "%.1fus" % ts.us(e["rta_cycles"])
+        if not e["rta_ok"]:
+            rta_us += "!"
+        print("%-12s %8.1fus %12s %10.1fus %10.1fus %6d %7d" % (
+            t.name, ts.us(e["deadline_cycles"]), rta_us, ts.us(e["sim_max_cycles"]),
+            ts.us(e["sim_avg_cycles"]), e["sim_jobs"], e["sim_misses"]))
+    print("schedulable" if ok else "NOT schedulable (! = analysis bound above the deadline)")
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
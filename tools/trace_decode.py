@@ -0,0 +1,194 @@
+#!/usr/bin/env python3
+"""
+Convert a kernel event trace (task_scheduler/trace.h) to Chrome trace JSON,
+which opens in chrome://tracing or https://ui.perfetto.dev
+
+Input is either
+  - a raw dump of g_trace, e.g. from gdb:
+        dump binary memory trace.bin &g_trace ((char*)&g_trace + sizeof(g_trace))
+  - an ITM/SWO capture (--itm) of a build with TRACE_CONFIG_ITM = 1, records
+    are taken from stimulus port TRACE_ITM_PORT
+
+usage: trace_decode.py trace.bin -o trace.json [--itm] [--hz 180000000]
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+TRACE_MAGIC = 0x31435254
+HEADER = struct.Struct("<IIII")  # magic, head, len, cpu_hz
+RECORD = struct.Struct("<II")  # timestamp, info
+
+EV_SWITCH_IN = 0x01
+EV_BLOCK = 0x02
+EV_UNBLOCK = 0x03
+EV_ISR_ENTER = 0x04
+EV_ISR_EXIT = 0x05
+EV_SEM_TAKE = 0x06
+EV_SEM_GIVE = 0x07
+EV_QUEUE_SEND = 0x08
+EV_QUEUE_RECV = 0x09
+EV_DEADLINE_MISS = 0x0A
+EV_OVERRUN = 0x0B
+EV_BUDGET = 0x0C
+EV_USER = 0x80
+
+INSTANT_NAMES = {
+    EV_BLOCK: "block",
+    EV_UNBLOCK: "unblock",
+    EV_SEM_TAKE: "sem take",
+    EV_SEM_GIVE: "sem give",
+    EV_QUEUE_SEND: "queue send",
+    EV_QUEUE_RECV: "queue recv",
+    EV_DEADLINE_MISS: "deadline miss",
+    EV_OVERRUN: "slot overrun",
+    EV_BUDGET: "budget exhausted",
+}
+
+EXCEPTION_NAMES = {15: "SysTick", 14: "PendSV", 11: "SVCall"}
+
+PID = 1
+ISR_TID = 100  # ISRs are drawn on their own track below the tasks
+
+
+def task_name(task):
+    return "idle" if task == 0 else "task %d" % task
+
+
+def records_from_dump(data):
+    """returns (records, cpu_hz) from a raw g_trace dump, oldest record first"""
+    if len(data) < HEADER.size:
+        sys.exit("dump is smaller than the trace header")
+    magic, head, length, cpu_hz = HEADER.unpack_from(data, 0)
+    if magic != TRACE_MAGIC:
+        sys.exit("bad magic 0x%08x, not a g_trace dump or trace_init was not called" % magic)
+    if length == 0 or (length & (length - 1)):
+        sys.exit("bad buffer length %d" % length)
+
+    count = min(head, length)
+    records = []
+    for n in range(head - count, head):
+        off = HEADER.size + (n % length) * RECORD.size
+        if off + RECORD.size > len(data):
+            sys.exit("dump is truncated, dump sizeof(g_trace) bytes")
+        records.append(RECORD.unpack_from(data, off))
+    return records, cpu_hz
+
+
+def itm_words(data, port):
+    """returns the 32 bit software source packets written to the given ITM stimulus port"""
+    words = []
+    i = 0
+    while i < len(data):
+        h = data[i]
+        i += 1
+        if h == 0x00:
+            continue  # part of a synchronization packet
+        if h == 0x70:
+            print("warning: ITM overflow, records were lost", file=sys.stderr)
+            continue
+        size_code = h & 0x3
+        if size_code == 0:
+            # protocol packets (timestamps, extension), skip the continuation bytes
+            if h & 0x80:
+                while i < len(data) and (data[i] & 0x80):
+                    i += 1
+                i += 1
+            continue
+        size = {1: 1, 2: 2, 3: 4}[size_code]
+        payload = data[i:i + size]
+        i += size
+        if h & 0x4:
+            continue  # hardware source packet (DWT)
+        if (h >> 3) != port or size != 4 or len(payload) != 4:
+            continue
+        words.append(struct.unpack("<I", payload)[0])
+    return words
+
+
+def records_from_itm(data, port):
+    """returns records from the 32 bit writes of the given ITM port, two words per record"""
+    words = itm_words(data, port)
+    if len(words) % 2:
+        words = words[:-1]
+    return [(words[n], words[n + 1]) for n in range(0, len(words), 2)]
+
+
+def to_chrome(records, cpu_hz):
+    events = []
+    for tid in range(0, 16):
+        events.append({"ph": "M", "pid": PID, "tid": tid, "name": "thread_name",
+                       "args": {"name": task_name(tid)}})
+    events.append({"ph": "M", "pid": PID, "tid": ISR_TID, "name": "thread_name",
+                   "args": {"name": "ISR"}})
+
+    if not records:
+        return events
+
+    # unwrap the 32 bit CYCCNT timestamps
+    base = records[0][0]
+    last = base
+    high = 0
+    us_per_cycle = 1e6 / cpu_hz
+
+    running = None  # (task, start_us)
+    isr_stack = []  # (exception, start_us)
+
+    for timestamp, info in records:
+        if timestamp < last:
+            high += 1 << 32
+        last = timestamp
+        ts = ((timestamp + high) - base) * us_per_cycle
+
+        event = info & 0xFF
+        task = (info >> 8) & 0xFF
+        obj = (info >> 16) & 0xFFFF
+
+        if event == EV_SWITCH_IN:
+            if running is not None:
+                events.append({"ph": "X", "pid": PID, "tid": running[0], "name": task_name(running[0]),
+                               "ts": running[1], "dur": ts - running[1]})
+            running = (task, ts)
+        elif event == EV_ISR_ENTER:
+            isr_stack.append((obj, ts))
+        elif event == EV_ISR_EXIT:
+            if isr_stack:
+                exc, start = isr_stack.pop()
+                name = EXCEPTION_NAMES.get(exc, "IRQ %d" % (exc - 16))
+                events.append({"ph": "X", "pid": PID, "tid": ISR_TID, "name": name, "ts": start, "dur": ts - start})
+        else:
+            name = INSTANT_NAMES.get(event, "user 0x%02x" % event if event >= EV_USER else "event 0x%02x" % event)
+            events.append({"ph": "i", "s": "t", "pid": PID, "tid": task, "name": name, "ts": ts,
+                           "args": {"object": obj}})
+
+    return events
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", help="g_trace memory dump or ITM capture")
+    parser.add_argument("-o", "--output", default="trace.json")
+    parser.add_argument("--itm", action="store_true", help="input is an ITM/SWO capture")
+    parser.add_argument("--port", type=int, default=1, help="ITM stimulus port (TRACE_ITM_PORT)")
+    parser.add_argument("--hz", type=int, default=0, help="CYCCNT frequency, default from the dump or 180MHz")
+    args = parser.parse_args()
+
+    with open(args.input, "rb") as f:
+        data = f.read()
+
+    if args.itm:
+        records, cpu_hz = records_from_itm(data, args.port), 180000000
+    else:
+        records, cpu_hz = records_from_dump(data)
+    if args.hz:
+        cpu_hz = args.hz
+
+    with open(args.output, "w") as f:
+        json.dump({"traceEvents": to_chrome(records, cpu_hz), "displayTimeUnit": "ns"}, f)
+    print("%d records -> %s" % (len(records), args.output))
+
+
+if __name__ == "__main__":
+    main()